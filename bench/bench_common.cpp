@@ -0,0 +1,526 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <sstream>
+
+#include "bench_common.hpp"
+
+namespace {
+
+std::atomic<size_t> allocations(0);
+
+void* counted_malloc(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+const char* const LIBRARIES[] = {
+    "/usr/lib/x86_64-linux-gnu/libc.so.6",
+    "/usr/lib/x86_64-linux-gnu/libstdc++.so.6.0.30",
+    "/usr/lib/x86_64-linux-gnu/libm.so.6",
+    "/usr/lib/x86_64-linux-gnu/libgcc_s.so.1",
+    "/usr/lib/x86_64-linux-gnu/ld-linux-x86-64.so.2",
+    "/usr/lib/locale/C.utf8/LC_CTYPE",
+    "/usr/bin/bench",
+};
+
+const char* const SPECIAL_REGIONS[] = {
+    "[heap]", "[stack]", "[vvar]", "[vdso]", "",
+};
+
+const char* const PERMISSIONS[] = {
+    "r--p", "r-xp", "r--p", "rw-p",
+};
+
+std::string hex(unsigned long long value, int width)
+{
+    std::ostringstream out;
+    out << std::hex << std::uppercase;
+    out.width(width);
+    out.fill('0');
+    out << value;
+    return out.str();
+}
+
+std::string lower_hex(unsigned long long value, int width)
+{
+    std::ostringstream out;
+    out << std::hex;
+    out.width(width);
+    out.fill('0');
+    out << value;
+    return out.str();
+}
+
+std::string maps_line(size_t i)
+{
+    static const unsigned long long BASE = 0x7f3a5c000000ULL;
+    static const unsigned long long SIZE = 0x2000;
+
+    std::ostringstream out;
+    unsigned long long start = BASE + i * SIZE;
+    out << lower_hex(start, 12) << '-' << lower_hex(start + SIZE, 12) << ' '
+        << PERMISSIONS[i % 4] << ' ' << lower_hex((i % 4) * SIZE, 8);
+
+    // Every library is mapped several times, with a few anonymous and
+    // special regions in between
+    const char* path;
+    if (i % 5 == 4)
+    {
+        path = SPECIAL_REGIONS[(i / 5) % 5];
+        out << " 00:00 0";
+    }
+    else
+    {
+        path = LIBRARIES[(i / 5) % 7];
+        out << " fe:00 " << 467394 + (i / 5) % 7;
+    }
+
+    if (*path)
+    {
+        out << "                     " << path;
+    }
+    return out.str();
+}
+
+} // anonymous namespace
+
+void* operator new(size_t size)
+{
+    void* p = counted_malloc(size);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_malloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_malloc(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    free(p);
+}
+
+allocation_counter::allocation_counter()
+    : _start(allocations.load(std::memory_order_relaxed))
+{}
+
+size_t allocation_counter::count() const
+{
+    return allocations.load(std::memory_order_relaxed) - _start;
+}
+
+void report_per_line(benchmark::State& state, size_t lines,
+                     const allocation_counter& allocations)
+{
+    auto total_lines = static_cast<double>(state.iterations() * lines);
+    if (total_lines == 0)
+    {
+        return;
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(total_lines));
+
+    // An inverted rate is the time per line, e.g. "250ns"
+    state.counters["time/line"] = benchmark::Counter(
+        total_lines,
+        benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    state.counters["allocs/line"] =
+        static_cast<double>(allocations.count()) / total_lines;
+}
+
+std::vector<std::string> make_maps_lines(size_t count)
+{
+    std::vector<std::string> lines;
+    lines.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        lines.push_back(maps_line(i));
+    }
+    return lines;
+}
+
+std::vector<std::string> make_smaps_lines(size_t regions)
+{
+    static const char* const KEYS[] = {
+        "Size",           "KernelPageSize",  "MMUPageSize",    "Rss",
+        "Pss",            "Pss_Dirty",       "Shared_Clean",   "Shared_Dirty",
+        "Private_Clean",  "Private_Dirty",   "Referenced",     "Anonymous",
+        "KSM",            "LazyFree",        "AnonHugePages",  "ShmemPmdMapped",
+        "FilePmdMapped",  "Shared_Hugetlb",  "Private_Hugetlb", "Swap",
+        "SwapPss",        "Locked",
+    };
+
+    std::vector<std::string> lines;
+    for (size_t i = 0; i < regions; ++i)
+    {
+        lines.push_back(maps_line(i));
+        for (const char* key : KEYS)
+        {
+            std::ostringstream out;
+            out << key << ':';
+            out.width(static_cast<std::streamsize>(24 - strlen(key)));
+            out << (i * 4) % 1024 << " kB";
+            lines.push_back(out.str());
+        }
+        lines.push_back("THPeligible:           0");
+        lines.push_back("ProtectionKey:         0");
+        lines.push_back("VmFlags: rd mr mw me sd ");
+    }
+    return lines;
+}
+
+std::vector<std::string> make_net_socket_lines(size_t count, bool ipv6)
+{
+    std::vector<std::string> lines;
+    lines.reserve(count + 1);
+
+    if (ipv6)
+    {
+        lines.push_back("  sl  local_address                         "
+                        "remote_address                        st tx_queue "
+                        "rx_queue tr tm->when retrnsmt   uid  timeout inode");
+    }
+    else
+    {
+        lines.push_back("  sl  local_address rem_address   st tx_queue "
+                        "rx_queue tr tm->when retrnsmt   uid  timeout inode");
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::string local;
+        std::string remote;
+        if (ipv6)
+        {
+            local  = "0000000000000000FFFF00000100007F";
+            remote = "00000000000000000000000000000000";
+        }
+        else
+        {
+            local  = "0100007F";
+            remote = "00000000";
+        }
+
+        std::ostringstream out;
+        out.width(4);
+        out << i << ": " << local << ':' << hex(1024 + i % 60000, 4) << ' '
+            << remote << ':' << hex(i % 2 ? 443 : 0, 4) << ' '
+            << (i % 2 ? "01" : "0A")
+            << " 00000000:00000000 00:00000000 00000000  1000        0 "
+            << 25264 + i << " 1 " << lower_hex(0xffff8db2fd23a400ULL + i, 16)
+            << " 20 4 28 10 -1";
+        lines.push_back(out.str());
+    }
+    return lines;
+}
+
+std::vector<std::string> make_unix_socket_lines(size_t count)
+{
+    std::vector<std::string> lines;
+    lines.reserve(count + 1);
+    lines.push_back("Num       RefCount Protocol Flags    Type St Inode Path");
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::ostringstream out;
+        out << lower_hex(0x8195f08aULL + i * 0x40, 16)
+            << ": 00000003 00000000 00000000 0001 03 " << 68661 + i;
+        if (i % 3 == 0)
+        {
+            out << " /run/systemd/journal/stdout";
+        }
+        lines.push_back(out.str());
+    }
+    return lines;
+}
+
+std::vector<std::string> make_netlink_socket_lines(size_t count)
+{
+    std::vector<std::string> lines;
+    lines.reserve(count + 1);
+    lines.push_back("sk               Eth Pid        Groups   Rmem     Wmem     "
+                    "Dump  Locks    Drops    Inode");
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::ostringstream out;
+        out << lower_hex(0x417fc013ULL + i * 0x40, 16) << ' ';
+        out.width(3);
+        out << std::left << i % 16 << ' ';
+        out.width(10);
+        out << 1000 + i << " 00000000 0        0        0     2        0"
+            << "        " << 589 + i;
+        lines.push_back(out.str());
+    }
+    return lines;
+}
+
+std::vector<std::string> make_mountinfo_lines(size_t count)
+{
+    std::vector<std::string> lines;
+    lines.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::ostringstream out;
+        out << 23 + i << " 28 0:" << 22 + i << " / /run/user/"
+            << 1000 + i
+            << " rw,nosuid,nodev,relatime shared:" << i
+            << " - tmpfs tmpfs rw,size=615812k,nr_inodes=153953,mode=700";
+        lines.push_back(out.str());
+    }
+    return lines;
+}
+
+std::vector<std::string> make_proc_stat_lines(size_t cpus)
+{
+    std::vector<std::string> lines;
+    lines.push_back("cpu  117400 0 15036 169814 344 0 4 3384 0 0");
+    for (size_t i = 0; i < cpus; ++i)
+    {
+        std::ostringstream out;
+        out << "cpu" << i << ' ' << 117400 + i << " 0 15036 169814 344 0 4 "
+            << 3384 + i << " 0 0";
+        lines.push_back(out.str());
+    }
+
+    std::ostringstream intr;
+    intr << "intr 454928";
+    for (size_t i = 0; i < 256; ++i)
+    {
+        intr << ' ' << (i % 7 ? 0 : i * 13);
+    }
+    lines.push_back(intr.str());
+
+    lines.push_back("ctxt 808058");
+    lines.push_back("btime 1792206390");
+    lines.push_back("processes 36306");
+    lines.push_back("procs_running 1");
+    lines.push_back("procs_blocked 0");
+    lines.push_back("softirq 184373 0 80208 1 5130 0 0 1 0 4 99029");
+    return lines;
+}
+
+std::string join_lines(const std::vector<std::string>& lines)
+{
+    std::string out;
+    for (const auto& line : lines)
+    {
+        out += line;
+        out += '\n';
+    }
+    return out;
+}
+
+size_t count_lines(const std::string& content)
+{
+    return static_cast<size_t>(
+        std::count(content.begin(), content.end(), '\n'));
+}
+
+const temp_dir& fake_procfs()
+{
+    static const temp_dir root;
+    static bool built = false;
+    if (built)
+    {
+        return root;
+    }
+
+    for (size_t i = 0; i < FAKE_PROCFS_PROCESSES; ++i)
+    {
+        auto pid = std::to_string(FAKE_PROCFS_BIG_PID + i) + '/';
+
+        auto stat = STAT_SAMPLE;
+        stat.replace(0, stat.find(' '), std::to_string(FAKE_PROCFS_BIG_PID + i));
+
+        root.create_file(pid + "stat", stat);
+        root.create_file(pid + "status", STATUS_SAMPLE);
+        root.create_file(pid + "io", IO_SAMPLE);
+        root.create_file(pid + "statm", STATM_SAMPLE);
+        root.create_file(pid + "cmdline",
+                         std::string("/usr/bin/bench\0--worker\0", 24));
+    }
+
+    auto big = std::to_string(FAKE_PROCFS_BIG_PID) + '/';
+    root.create_file(big + "maps", join_lines(make_maps_lines(FAKE_MAPS_LINES)));
+    root.create_file(big + "smaps",
+                     join_lines(make_smaps_lines(FAKE_SMAPS_REGIONS)));
+    root.create_file(big + "net/tcp6", join_lines(make_net_socket_lines(
+                                           FAKE_TCP6_SOCKETS, true)));
+    root.create_file(big + "net/unix",
+                     join_lines(make_unix_socket_lines(FAKE_UNIX_SOCKETS)));
+
+    root.create_file("stat", join_lines(make_proc_stat_lines(64)));
+    root.create_file("meminfo", MEMINFO_SAMPLE);
+
+    built = true;
+    return root;
+}
+
+const std::string STAT_SAMPLE =
+    "3756 (bench worker) S 3751 3756 3751 0 -1 4194304 84 0 0 0 1234 567 0 0 "
+    "20 0 1 0 302683 2703360 327 18446744073709551615 94508373979136 "
+    "94508373999017 140725661407504 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 0 "
+    "94508374015024 94508374016640 94508540506112 140725661414720 "
+    "140725661414740 140725661414740 140725661417451 0\n";
+
+const std::string STATUS_SAMPLE =
+    "Name:\tbench\n"
+    "Umask:\t0022\n"
+    "State:\tS (sleeping)\n"
+    "Tgid:\t3755\n"
+    "Ngid:\t0\n"
+    "Pid:\t3755\n"
+    "PPid:\t3751\n"
+    "TracerPid:\t0\n"
+    "Uid:\t1000\t1000\t1000\t1000\n"
+    "Gid:\t1000\t1000\t1000\t1000\n"
+    "FDSize:\t64\n"
+    "Groups:\t4 24 27 30 46 100 1000 \n"
+    "NStgid:\t3755\n"
+    "NSpid:\t3755\n"
+    "NSpgid:\t3755\n"
+    "NSsid:\t3751\n"
+    "VmPeak:\t    2640 kB\n"
+    "VmSize:\t    2640 kB\n"
+    "VmLck:\t       0 kB\n"
+    "VmPin:\t       0 kB\n"
+    "VmHWM:\t    1420 kB\n"
+    "VmRSS:\t    1420 kB\n"
+    "RssAnon:\t     104 kB\n"
+    "RssFile:\t    1316 kB\n"
+    "RssShmem:\t       0 kB\n"
+    "VmData:\t     360 kB\n"
+    "VmStk:\t     132 kB\n"
+    "VmExe:\t      20 kB\n"
+    "VmLib:\t    1528 kB\n"
+    "VmPTE:\t      44 kB\n"
+    "VmSwap:\t       0 kB\n"
+    "HugetlbPages:\t       0 kB\n"
+    "CoreDumping:\t0\n"
+    "THP_enabled:\t1\n"
+    "Threads:\t1\n"
+    "SigQ:\t0/24002\n"
+    "SigPnd:\t0000000000000000\n"
+    "ShdPnd:\t0000000000000000\n"
+    "SigBlk:\t0000000000000000\n"
+    "SigIgn:\t0000000000000000\n"
+    "SigCgt:\t0000000000000000\n"
+    "CapInh:\t0000000000000000\n"
+    "CapPrm:\t0000000000000000\n"
+    "CapEff:\t0000000000000000\n"
+    "CapBnd:\t000001ffffffffff\n"
+    "CapAmb:\t0000000000000000\n"
+    "NoNewPrivs:\t0\n"
+    "Seccomp:\t0\n"
+    "Seccomp_filters:\t0\n"
+    "Speculation_Store_Bypass:\tthread vulnerable\n"
+    "SpeculationIndirectBranch:\tconditional enabled\n"
+    "Cpus_allowed:\tff\n"
+    "Cpus_allowed_list:\t0-7\n"
+    "Mems_allowed:\t00000000,00000001\n"
+    "Mems_allowed_list:\t0\n"
+    "voluntary_ctxt_switches:\t12\n"
+    "nonvoluntary_ctxt_switches:\t3\n";
+
+const std::string IO_SAMPLE =
+    "rchar: 3980\n"
+    "wchar: 0\n"
+    "syscr: 8\n"
+    "syscw: 0\n"
+    "read_bytes: 0\n"
+    "write_bytes: 0\n"
+    "cancelled_write_bytes: 0\n";
+
+const std::string STATM_SAMPLE = "660 325 300 5 0 123 0\n";
+
+const std::string MEMINFO_SAMPLE =
+    "MemTotal:        6158152 kB\n"
+    "MemFree:         4802992 kB\n"
+    "MemAvailable:    5643040 kB\n"
+    "Buffers:           58996 kB\n"
+    "Cached:           986960 kB\n"
+    "SwapCached:            0 kB\n"
+    "Active:           398844 kB\n"
+    "Inactive:         863396 kB\n"
+    "Active(anon):         20 kB\n"
+    "Inactive(anon):   225552 kB\n"
+    "Active(file):     398824 kB\n"
+    "Inactive(file):   637844 kB\n"
+    "Unevictable:       13628 kB\n"
+    "Mlocked:           13628 kB\n"
+    "SwapTotal:             0 kB\n"
+    "SwapFree:              0 kB\n"
+    "Dirty:               216 kB\n"
+    "Writeback:             0 kB\n"
+    "AnonPages:        229876 kB\n"
+    "Mapped:           143524 kB\n"
+    "Shmem:              9288 kB\n"
+    "KReclaimable:      24164 kB\n"
+    "Slab:              41832 kB\n"
+    "SReclaimable:      24164 kB\n"
+    "SUnreclaim:        17668 kB\n"
+    "KernelStack:        1200 kB\n"
+    "PageTables:         2176 kB\n"
+    "CommitLimit:     3079076 kB\n"
+    "Committed_AS:     348736 kB\n"
+    "VmallocTotal:   34359738367 kB\n"
+    "VmallocUsed:       15928 kB\n"
+    "VmallocChunk:          0 kB\n"
+    "Percpu:              296 kB\n"
+    "AnonHugePages:         0 kB\n"
+    "HugePages_Total:       0\n"
+    "HugePages_Free:        0\n"
+    "Hugepagesize:       2048 kB\n"
+    "DirectMap4k:       26624 kB\n"
+    "DirectMap2M:     2070528 kB\n";
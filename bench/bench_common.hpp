@@ -0,0 +1,98 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PFS_BENCH_COMMON_HPP
+#define PFS_BENCH_COMMON_HPP
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "test_utils.hpp"
+
+// Counts the allocations made through the global 'operator new' since
+// construction.
+class allocation_counter
+{
+public:
+    allocation_counter();
+
+    size_t count() const;
+
+private:
+    size_t _start;
+};
+
+// Report 'time/line' and 'allocs/line' for a benchmark that handled 'lines'
+// lines on every iteration
+void report_per_line(benchmark::State& state, size_t lines,
+                     const allocation_counter& allocations);
+
+// Parse every line on every iteration, so the cost of the line parser alone
+// is measured
+template <typename Parser>
+void bench_lines(benchmark::State& state, const std::vector<std::string>& lines,
+                 Parser parser)
+{
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        for (const auto& line : lines)
+        {
+            benchmark::DoNotOptimize(parser(line));
+        }
+    }
+    report_per_line(state, lines.size(), allocations);
+}
+
+// Synthetic, yet realistic, contents of procfs files.
+// Generated lines are deterministic, so results are comparable across runs.
+std::vector<std::string> make_maps_lines(size_t count);
+std::vector<std::string> make_smaps_lines(size_t regions);
+std::vector<std::string> make_net_socket_lines(size_t count, bool ipv6);
+std::vector<std::string> make_unix_socket_lines(size_t count);
+std::vector<std::string> make_netlink_socket_lines(size_t count);
+std::vector<std::string> make_mountinfo_lines(size_t count);
+std::vector<std::string> make_proc_stat_lines(size_t cpus);
+
+std::string join_lines(const std::vector<std::string>& lines);
+size_t count_lines(const std::string& content);
+
+// A fake procfs root with 'count' processes, each with 'stat', 'status',
+// 'io', 'statm' and 'cmdline' files.
+// Built once, on first use, and removed when the program exits.
+const temp_dir& fake_procfs();
+
+static const size_t FAKE_PROCFS_PROCESSES = 5000;
+
+// The PID of the process in the fake procfs root that holds the large 'maps',
+// 'smaps' and 'net' files
+static const int FAKE_PROCFS_BIG_PID = 1;
+
+static const size_t FAKE_MAPS_LINES     = 10000;
+static const size_t FAKE_SMAPS_REGIONS  = 1000;
+static const size_t FAKE_TCP6_SOCKETS   = 100000;
+static const size_t FAKE_UNIX_SOCKETS   = 10000;
+
+// Single file samples, as found on a typical machine
+extern const std::string STAT_SAMPLE;
+extern const std::string STATUS_SAMPLE;
+extern const std::string IO_SAMPLE;
+extern const std::string STATM_SAMPLE;
+extern const std::string MEMINFO_SAMPLE;
+
+#endif // PFS_BENCH_COMMON_HPP
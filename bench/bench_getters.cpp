@@ -0,0 +1,631 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <set>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "bench_common.hpp"
+
+#include "pfs/procfs.hpp"
+
+// Getters running against the fake procfs root, so the numbers reflect
+// realistic file sizes regardless of the machine running the benchmark.
+
+namespace {
+
+pfs::procfs fake()
+{
+    return pfs::procfs(fake_procfs().get_root());
+}
+
+void BM_get_maps(benchmark::State& state)
+{
+    auto task = fake().get_task(FAKE_PROCFS_BIG_PID);
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(task.get_maps());
+    }
+    report_per_line(state, FAKE_MAPS_LINES, allocations);
+}
+
+// Same as above, but pathnames are interned in a pool shared by all the runs
+void BM_get_maps_pooled(benchmark::State& state)
+{
+    auto task = fake().get_task(FAKE_PROCFS_BIG_PID);
+    pfs::string_pool pool;
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(task.get_maps(&pool));
+    }
+    report_per_line(state, FAKE_MAPS_LINES, allocations);
+}
+
+// Look up addresses spread over all the regions
+void BM_maps_index_find(benchmark::State& state)
+{
+    auto index  = fake().get_task(FAKE_PROCFS_BIG_PID).get_maps_index();
+    auto& first = index.regions().front();
+    auto& last  = index.regions().back();
+
+    // Not a multiple of the region size, to hit different regions
+    uint64_t step = (last.end_address - first.start_address) / 4099 + 1;
+
+    uint64_t address = first.start_address;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(index.find(address));
+        address += step;
+        if (address >= last.end_address)
+        {
+            address = first.start_address;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Refresh an index whose maps didn't change
+void BM_maps_index_refresh(benchmark::State& state)
+{
+    auto task  = fake().get_task(FAKE_PROCFS_BIG_PID);
+    auto index = task.get_maps_index();
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(task.refresh_maps_index(index));
+    }
+    report_per_line(state, FAKE_MAPS_LINES, allocations);
+}
+
+// Read many small items from the memory of the current process
+static const size_t MEM_ITEMS     = 1000;
+static const size_t MEM_ITEM_SIZE = 64;
+
+void BM_mem_read(benchmark::State& state)
+{
+    std::vector<uint8_t> source(MEM_ITEMS * MEM_ITEM_SIZE * 2);
+    auto mem = pfs::procfs().get_task().get_mem();
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < MEM_ITEMS; ++i)
+        {
+            auto item   = &source[i * 2 * MEM_ITEM_SIZE];
+            auto offset = static_cast<loff_t>(reinterpret_cast<size_t>(item));
+            benchmark::DoNotOptimize(mem.read(offset, MEM_ITEM_SIZE));
+        }
+    }
+    report_per_line(state, MEM_ITEMS, allocations);
+}
+
+void BM_mem_read_batch(benchmark::State& state)
+{
+    std::vector<uint8_t> source(MEM_ITEMS * MEM_ITEM_SIZE * 2);
+    std::vector<uint8_t> target(MEM_ITEMS * MEM_ITEM_SIZE);
+
+    // Every other item, so items aren't adjacent
+    std::vector<pfs::mem::read_request> requests;
+    for (size_t i = 0; i < MEM_ITEMS; ++i)
+    {
+        auto item = &source[i * 2 * MEM_ITEM_SIZE];
+        requests.push_back({reinterpret_cast<size_t>(item),
+                            &target[i * MEM_ITEM_SIZE], MEM_ITEM_SIZE});
+    }
+
+    auto task = pfs::procfs().get_task();
+    auto mem  = state.range(0) ? task.pin().get_mem() : task.get_mem();
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(mem.read_batch(requests));
+    }
+    report_per_line(state, MEM_ITEMS, allocations);
+}
+
+// A large reservation, of which only every 64th page was touched
+class sparse_region
+{
+public:
+    static const size_t PAGES = 64 * 1024;
+
+    sparse_region()
+    {
+        const size_t page_size = pfs::pagemap::page_size();
+
+        void* pages = mmap(nullptr, PAGES * page_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (pages == MAP_FAILED)
+        {
+            throw std::runtime_error("Couldn't map sparse region");
+        }
+
+        region.start_address = reinterpret_cast<size_t>(pages);
+        region.end_address   = region.start_address + PAGES * page_size;
+
+        for (size_t i = 0; i < PAGES; i += 64)
+        {
+            static_cast<uint8_t*>(pages)[i * page_size] = 1;
+        }
+    }
+
+    ~sparse_region()
+    {
+        munmap(reinterpret_cast<void*>(region.start_address),
+               region.end_address - region.start_address);
+    }
+
+    pfs::mem_region region;
+};
+
+void BM_mem_read_region(benchmark::State& state)
+{
+    sparse_region sparse;
+    auto mem = pfs::procfs().get_task().get_mem();
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(mem.read(sparse.region));
+    }
+    state.SetItemsProcessed(state.iterations() * sparse_region::PAGES);
+}
+
+void BM_mem_read_sparse(benchmark::State& state)
+{
+    sparse_region sparse;
+    auto task    = pfs::procfs().get_task();
+    auto mem     = task.get_mem();
+    auto pagemap = task.get_pagemap();
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(mem.read_sparse(sparse.region, pagemap));
+    }
+    state.SetItemsProcessed(state.iterations() * sparse_region::PAGES);
+}
+
+// Scan 64MiB, split into 16 regions, for a few patterns
+void BM_mem_scan(benchmark::State& state)
+{
+    static const size_t REGIONS     = 16;
+    static const size_t REGION_SIZE = 4 * 1024 * 1024;
+
+    std::vector<uint8_t> memory(REGIONS * REGION_SIZE);
+    for (size_t i = 0; i < memory.size(); ++i)
+    {
+        memory[i] = static_cast<uint8_t>((i * 2654435761u) >> 24);
+    }
+
+    std::vector<pfs::mem_region> regions(REGIONS);
+    for (size_t i = 0; i < REGIONS; ++i)
+    {
+        regions[i].start_address =
+            reinterpret_cast<size_t>(&memory[i * REGION_SIZE]);
+        regions[i].end_address   = regions[i].start_address + REGION_SIZE;
+        regions[i].perm.can_read = true;
+    }
+
+    std::vector<std::string> patterns = {std::string("MZ\x90\x00", 4),
+                                         "\x7f" "ELF", "-----BEGIN",
+                                         "password="};
+
+    auto mem = pfs::procfs().get_task().get_mem();
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(mem.scan(regions, patterns, state.range(0)));
+    }
+    state.SetBytesProcessed(state.iterations() * memory.size());
+}
+
+void BM_get_smaps(benchmark::State& state)
+{
+    auto task = fake().get_task(FAKE_PROCFS_BIG_PID);
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(task.get_smaps());
+    }
+    report_per_line(state, make_smaps_lines(1).size() * FAKE_SMAPS_REGIONS,
+                    allocations);
+}
+
+// Aggregate smaps without collecting the regions
+void BM_sum_smaps(benchmark::State& state)
+{
+    auto task = fake().get_task(FAKE_PROCFS_BIG_PID);
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(task.sum_smaps());
+    }
+    report_per_line(state, make_smaps_lines(1).size() * FAKE_SMAPS_REGIONS,
+                    allocations);
+}
+
+void BM_get_tcp6(benchmark::State& state)
+{
+    auto net = fake().get_net(FAKE_PROCFS_BIG_PID);
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(net.get_tcp6());
+    }
+    report_per_line(state, FAKE_TCP6_SOCKETS, allocations);
+}
+
+// Count sockets per state without collecting them
+void BM_for_each_tcp6(benchmark::State& state)
+{
+    auto net = fake().get_net(FAKE_PROCFS_BIG_PID);
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        std::array<size_t, 16> states{};
+        net.for_each_tcp6([&states](const pfs::net_socket& socket) {
+            ++states[static_cast<size_t>(socket.socket_net_state)];
+        });
+        benchmark::DoNotOptimize(states);
+    }
+    report_per_line(state, FAKE_TCP6_SOCKETS, allocations);
+}
+
+// Find who's listening on a given port, rejecting lines before parsing them
+void BM_find_listening_tcp6(benchmark::State& state)
+{
+    auto net = fake().get_net(FAKE_PROCFS_BIG_PID);
+
+    auto line_filter = [](pfs::impl::string_view line) {
+        if (pfs::net::peek_state(line) != pfs::net_socket::net_state::listen ||
+            pfs::net::peek_local_port(line) != 2048)
+        {
+            return pfs::filter::action::drop;
+        }
+        return pfs::filter::action::keep_and_stop;
+    };
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(net.get_tcp6(nullptr, line_filter));
+    }
+    report_per_line(state, FAKE_TCP6_SOCKETS, allocations);
+}
+
+// Real listening sockets, for comparing the socket backends of a live net
+class loopback_listeners
+{
+public:
+    static const size_t SOCKETS = 512;
+
+    loopback_listeners()
+    {
+        for (size_t i = 0; i < SOCKETS; ++i)
+        {
+            sockaddr_in addr{};
+            addr.sin_family      = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t addr_len   = sizeof(addr);
+
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (fd < 0 ||
+                bind(fd, reinterpret_cast<sockaddr*>(&addr), addr_len) != 0 ||
+                listen(fd, 1) != 0 ||
+                getsockname(fd, reinterpret_cast<sockaddr*>(&addr),
+                            &addr_len) != 0)
+            {
+                throw std::runtime_error("Couldn't create listener");
+            }
+
+            fds.push_back(fd);
+            last_port = ntohs(addr.sin_port);
+        }
+    }
+
+    ~loopback_listeners()
+    {
+        for (int fd : fds)
+        {
+            close(fd);
+        }
+    }
+
+    std::vector<int> fds;
+    uint16_t last_port = 0;
+};
+
+pfs::net live_net(const benchmark::State& state)
+{
+    auto net = pfs::procfs().get_net();
+    net.set_socket_backend(state.range(0) == 0
+                               ? pfs::net::socket_backend::procfs
+                               : pfs::net::socket_backend::netlink);
+    return net;
+}
+
+void BM_get_tcp_live(benchmark::State& state)
+{
+    loopback_listeners listeners;
+    auto net = live_net(state);
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(net.get_tcp());
+    }
+    report_per_line(state, loopback_listeners::SOCKETS, allocations);
+}
+
+// Find who's listening on a given port, letting the backend do the matching
+void BM_find_listening_tcp_live(benchmark::State& state)
+{
+    loopback_listeners listeners;
+    auto net = live_net(state);
+
+    pfs::net_socket_query query;
+    query.states =
+        pfs::net_socket_query::state_bit(pfs::net_socket::net_state::listen);
+    query.local_port = listeners.last_port;
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(net.get_tcp(query));
+    }
+    report_per_line(state, loopback_listeners::SOCKETS, allocations);
+}
+
+// The per-task way of mapping sockets to processes: stat every fd
+void BM_get_fds_inodes_live(benchmark::State& state)
+{
+    loopback_listeners listeners;
+    pfs::procfs procfs;
+
+    for (auto _ : state)
+    {
+        size_t inodes = 0;
+        for (const auto& task : procfs.get_processes())
+        {
+            try
+            {
+                inodes += task.get_fds_inodes().size();
+            }
+            catch (const std::system_error&)
+            {
+                // Task is gone, or its fds can't be accessed
+            }
+        }
+        benchmark::DoNotOptimize(inodes);
+    }
+}
+
+void BM_get_socket_owners_live(benchmark::State& state)
+{
+    loopback_listeners listeners;
+    pfs::procfs procfs;
+    auto threads = static_cast<size_t>(state.range(0));
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(procfs.get_socket_owners(threads));
+    }
+}
+
+void BM_refresh_socket_owners_live(benchmark::State& state)
+{
+    loopback_listeners listeners;
+    pfs::procfs procfs;
+    auto index = procfs.get_socket_owners();
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(procfs.refresh_socket_owners(index));
+    }
+}
+
+void BM_get_unix(benchmark::State& state)
+{
+    auto net = fake().get_net(FAKE_PROCFS_BIG_PID);
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(net.get_unix());
+    }
+    report_per_line(state, FAKE_UNIX_SOCKETS, allocations);
+}
+
+void BM_get_meminfo(benchmark::State& state)
+{
+    auto procfs = fake();
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(procfs.get_meminfo());
+    }
+    report_per_line(state, count_lines(MEMINFO_SAMPLE), allocations);
+}
+
+// Lines are processes here
+void BM_get_processes(benchmark::State& state)
+{
+    auto procfs  = fake();
+    auto threads = static_cast<size_t>(state.range(0));
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(procfs.get_processes(nullptr, threads));
+    }
+    report_per_line(state, FAKE_PROCFS_PROCESSES, allocations);
+}
+
+void BM_list_processes(benchmark::State& state)
+{
+    auto procfs = fake();
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(procfs.list_processes());
+    }
+    report_per_line(state, FAKE_PROCFS_PROCESSES, allocations);
+}
+
+void BM_get_stat_all(benchmark::State& state)
+{
+    auto procfs    = fake();
+    auto processes = procfs.get_processes();
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        for (const auto& task : processes)
+        {
+            benchmark::DoNotOptimize(task.get_stat());
+        }
+    }
+    report_per_line(state, FAKE_PROCFS_PROCESSES, allocations);
+}
+
+void BM_get_status_all(benchmark::State& state)
+{
+    auto procfs    = fake();
+    auto processes = procfs.get_processes();
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        for (const auto& task : processes)
+        {
+            benchmark::DoNotOptimize(task.get_status());
+        }
+    }
+    report_per_line(state, FAKE_PROCFS_PROCESSES, allocations);
+}
+
+// Only the keys a typical top-like tool needs
+void BM_get_status_keys_all(benchmark::State& state)
+{
+    auto procfs    = fake();
+    auto processes = procfs.get_processes();
+
+    const std::set<std::string> keys = {"VmRSS", "Threads"};
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        for (const auto& task : processes)
+        {
+            benchmark::DoNotOptimize(task.get_status(keys));
+        }
+    }
+    report_per_line(state, FAKE_PROCFS_PROCESSES, allocations);
+}
+
+void BM_fake_snapshot(benchmark::State& state)
+{
+    auto procfs  = fake();
+    auto threads = static_cast<size_t>(state.range(0));
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(
+            procfs.snapshot(pfs::task_fields::all, threads));
+    }
+    report_per_line(state, FAKE_PROCFS_PROCESSES, allocations);
+}
+
+} // anonymous namespace
+
+BENCHMARK(BM_get_maps)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_get_maps_pooled)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_maps_index_find);
+BENCHMARK(BM_maps_index_refresh)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_mem_read)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_mem_read_batch)
+    ->ArgName("pinned")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_mem_read_region)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_mem_read_sparse)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_mem_scan)
+    ->ArgName("threads")
+    ->Arg(1)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_get_smaps)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_sum_smaps)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_get_tcp6)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_for_each_tcp6)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_find_listening_tcp6)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_get_tcp_live)
+    ->ArgName("netlink")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_find_listening_tcp_live)
+    ->ArgName("netlink")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_get_fds_inodes_live)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_get_socket_owners_live)
+    ->ArgName("threads")
+    ->Arg(1)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_refresh_socket_owners_live)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_get_unix)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_get_meminfo)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_get_processes)
+    ->ArgName("threads")
+    ->Arg(1)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_list_processes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_get_stat_all)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_get_status_all)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_get_status_keys_all)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_fake_snapshot)
+    ->ArgName("threads")
+    ->Arg(1)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
@@ -0,0 +1,292 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bench_common.hpp"
+
+#include "pfs/parsers/block_stat.hpp"
+#include "pfs/parsers/buddyinfo.hpp"
+#include "pfs/parsers/cgroup.hpp"
+#include "pfs/parsers/cgroup_controller.hpp"
+#include "pfs/parsers/common.hpp"
+#include "pfs/parsers/filesystems.hpp"
+#include "pfs/parsers/loadavg.hpp"
+#include "pfs/parsers/maps.hpp"
+#include "pfs/parsers/meminfo.hpp"
+#include "pfs/parsers/modules.hpp"
+#include "pfs/parsers/mountinfo.hpp"
+#include "pfs/parsers/net_arp.hpp"
+#include "pfs/parsers/net_device.hpp"
+#include "pfs/parsers/net_route.hpp"
+#include "pfs/parsers/net_socket.hpp"
+#include "pfs/parsers/netlink_socket.hpp"
+#include "pfs/parsers/proc_stat.hpp"
+#include "pfs/parsers/smaps.hpp"
+#include "pfs/parsers/syscall.hpp"
+#include "pfs/parsers/task_io.hpp"
+#include "pfs/parsers/task_stat.hpp"
+#include "pfs/parsers/task_status.hpp"
+#include "pfs/parsers/unix_socket.hpp"
+#include "pfs/parsers/uptime.hpp"
+
+using namespace pfs::impl::parsers;
+
+namespace {
+
+// The number of lines every line parser benchmark parses per iteration
+static const size_t LINES = 1000;
+
+std::vector<std::string> repeat(const std::string& line)
+{
+    return std::vector<std::string>(LINES, line);
+}
+
+// Skip the header line that the file parsers skip as well
+std::vector<std::string> without_header(std::vector<std::string> lines)
+{
+    lines.erase(lines.begin());
+    return lines;
+}
+
+// Parse a whole file on every iteration, including reading it
+template <typename Parse>
+void bench_file(benchmark::State& state, const std::string& relative_path,
+                Parse parse)
+{
+    const auto& root = fake_procfs();
+    auto path        = root.get_root() + '/' + relative_path;
+
+    std::ifstream in(path);
+    std::string content((std::istreambuf_iterator<char>(in)),
+                        std::istreambuf_iterator<char>());
+
+    allocation_counter allocations;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(parse(path));
+    }
+    report_per_line(state, count_lines(content), allocations);
+}
+
+void BM_parse_block_stat_line(benchmark::State& state)
+{
+    bench_lines(state,
+                repeat("12735     9101   833156     2926    58398   181703  "
+                       "4538620698    38810        0    25238    47489     "
+                       "3213        0 102155080      337    23765     5414"),
+                parse_block_stat_line);
+}
+
+void BM_parse_buddyinfo_line(benchmark::State& state)
+{
+    bench_lines(state,
+                repeat("Node 0, zone   Normal  14081   4794   3336    950    "
+                       "279    143    150     83     39     18     58 "),
+                parse_buddyinfo_line);
+}
+
+void BM_parse_cgroup_line(benchmark::State& state)
+{
+    bench_lines(state,
+                repeat("0::/user.slice/user-1000.slice/session-2.scope"),
+                parse_cgroup_line);
+}
+
+void BM_parse_cgroup_controller_line(benchmark::State& state)
+{
+    bench_lines(state, repeat("cpuset\t3\t1\t1"),
+                parse_cgroup_controller_line);
+}
+
+void BM_parse_id_map_line(benchmark::State& state)
+{
+    bench_lines(state, repeat("         0     100000      65536"),
+                parse_id_map_line);
+}
+
+void BM_parse_filesystems_line(benchmark::State& state)
+{
+    bench_lines(state, repeat("nodev\tcgroup2"), parse_filesystems_line);
+}
+
+void BM_parse_loadavg_line(benchmark::State& state)
+{
+    bench_lines(state, repeat("0.27 0.54 0.55 1/76 3715"),
+                parse_loadavg_line);
+}
+
+void BM_parse_maps_line(benchmark::State& state)
+{
+    bench_lines(state, make_maps_lines(LINES),
+                [](const std::string& line) { return parse_maps_line(line); });
+}
+
+void BM_parse_meminfo_line(benchmark::State& state)
+{
+    bench_lines(state, repeat("MemAvailable:    5643040 kB"),
+                parse_meminfo_line);
+}
+
+void BM_parse_modules_line(benchmark::State& state)
+{
+    bench_lines(state,
+                repeat("nf_conntrack 139264 3 xt_conntrack,nf_nat,"
+                       "xt_MASQUERADE, Live 0xffffffffc0a3b000"),
+                parse_modules_line);
+}
+
+void BM_parse_mountinfo_line(benchmark::State& state)
+{
+    bench_lines(state, make_mountinfo_lines(LINES), parse_mountinfo_line);
+}
+
+void BM_parse_net_arp_line(benchmark::State& state)
+{
+    bench_lines(state,
+                repeat("192.0.2.1        0x1         0x2         "
+                       "02:fc:00:00:00:05     *        eth0"),
+                parse_net_arp_line);
+}
+
+void BM_parse_net_device_line(benchmark::State& state)
+{
+    bench_lines(state,
+                repeat("  eth0: 335754274   58179    1    2    3     4"
+                       "          5         6  9805218   48519   11   12"
+                       "   13    14      15         16"),
+                parse_net_device_line);
+}
+
+void BM_parse_net_route_line(benchmark::State& state)
+{
+    bench_lines(state,
+                repeat("eth0\t000200C0\t00000000\t0001\t0\t0\t0\t00FFFFFF\t0"
+                       "\t0\t0"),
+                parse_net_route_line);
+}
+
+void BM_parse_net_socket_line(benchmark::State& state)
+{
+    bench_lines(state, without_header(make_net_socket_lines(LINES, false)),
+                parse_net_socket_line);
+}
+
+void BM_parse_net_socket6_line(benchmark::State& state)
+{
+    bench_lines(state, without_header(make_net_socket_lines(LINES, true)),
+                parse_net_socket_line);
+}
+
+void BM_parse_netlink_socket_line(benchmark::State& state)
+{
+    bench_lines(state, without_header(make_netlink_socket_lines(LINES)),
+                parse_netlink_socket_line);
+}
+
+void BM_parse_syscall_line(benchmark::State& state)
+{
+    bench_lines(state,
+                repeat("0 0x3 0x7ffdd9006170 0x2000 0x7f73fe5efb60 0x0 0x0 "
+                       "0x7ffdd90060a8 0x7f73fe6d829d"),
+                parse_syscall_line);
+}
+
+void BM_parse_task_stat_line(benchmark::State& state)
+{
+    auto line = STAT_SAMPLE;
+    line.pop_back();
+
+    std::vector<std::string> lines = repeat(line);
+    bench_lines(state, lines, [](const std::string& line) {
+        return parse_task_stat_line(line);
+    });
+}
+
+void BM_parse_unix_socket_line(benchmark::State& state)
+{
+    bench_lines(state, without_header(make_unix_socket_lines(LINES)),
+                parse_unix_socket_line);
+}
+
+void BM_parse_uptime_line(benchmark::State& state)
+{
+    bench_lines(state, repeat("3003.62 1660.51"), parse_uptime_line);
+}
+
+void BM_parse_proc_stat(benchmark::State& state)
+{
+    bench_file(state, "stat", [](const std::string& path) {
+        return proc_stat_parser().parse(path);
+    });
+}
+
+void BM_parse_task_status(benchmark::State& state)
+{
+    auto path = std::to_string(FAKE_PROCFS_BIG_PID) + "/status";
+    bench_file(state, path, [](const std::string& path) {
+        return task_status_parser().parse(path);
+    });
+}
+
+void BM_parse_task_io(benchmark::State& state)
+{
+    auto path = std::to_string(FAKE_PROCFS_BIG_PID) + "/io";
+    bench_file(state, path, [](const std::string& path) {
+        return task_io_parser().parse(path);
+    });
+}
+
+void BM_parse_smaps(benchmark::State& state)
+{
+    auto path = std::to_string(FAKE_PROCFS_BIG_PID) + "/smaps";
+    bench_file(state, path, [](const std::string& path) {
+        return parse_smaps(path);
+    });
+}
+
+} // anonymous namespace
+
+BENCHMARK(BM_parse_block_stat_line);
+BENCHMARK(BM_parse_buddyinfo_line);
+BENCHMARK(BM_parse_cgroup_line);
+BENCHMARK(BM_parse_cgroup_controller_line);
+BENCHMARK(BM_parse_id_map_line);
+BENCHMARK(BM_parse_filesystems_line);
+BENCHMARK(BM_parse_loadavg_line);
+BENCHMARK(BM_parse_maps_line);
+BENCHMARK(BM_parse_meminfo_line);
+BENCHMARK(BM_parse_modules_line);
+BENCHMARK(BM_parse_mountinfo_line);
+BENCHMARK(BM_parse_net_arp_line);
+BENCHMARK(BM_parse_net_device_line);
+BENCHMARK(BM_parse_net_route_line);
+BENCHMARK(BM_parse_net_socket_line);
+BENCHMARK(BM_parse_net_socket6_line);
+BENCHMARK(BM_parse_netlink_socket_line);
+BENCHMARK(BM_parse_syscall_line);
+BENCHMARK(BM_parse_task_stat_line);
+BENCHMARK(BM_parse_unix_socket_line);
+BENCHMARK(BM_parse_uptime_line);
+BENCHMARK(BM_parse_proc_stat);
+BENCHMARK(BM_parse_task_status);
+BENCHMARK(BM_parse_task_io);
+BENCHMARK(BM_parse_smaps)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,105 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include <system_error>
+
+#include <benchmark/benchmark.h>
+
+#include "pfs/process_events.hpp"
+#include "pfs/procfs.hpp"
+
+namespace {
+
+// Collect the same data as a full 'snapshot', one getter at a time
+void BM_getters(benchmark::State& state)
+{
+    pfs::procfs procfs;
+    for (auto _ : state)
+    {
+        size_t tasks = 0;
+        for (const auto& task : procfs.get_processes())
+        {
+            try
+            {
+                benchmark::DoNotOptimize(task.get_stat());
+                benchmark::DoNotOptimize(task.get_status());
+                benchmark::DoNotOptimize(task.get_io());
+                benchmark::DoNotOptimize(task.get_statm());
+                benchmark::DoNotOptimize(task.get_cmdline());
+                ++tasks;
+            }
+            catch (const std::system_error&)
+            {
+                // Task died or access is denied, skip it
+            }
+        }
+        state.counters["tasks"] = static_cast<double>(tasks);
+    }
+}
+
+void BM_snapshot(benchmark::State& state)
+{
+    pfs::procfs procfs;
+    for (auto _ : state)
+    {
+        auto threads  = static_cast<size_t>(state.range(0));
+        auto snapshot = procfs.snapshot(pfs::task_fields::all, threads);
+        benchmark::DoNotOptimize(snapshot);
+        state.counters["tasks"] = static_cast<double>(snapshot.size());
+    }
+}
+
+// What learning about process churn costs without events: a full rescan
+void BM_process_events_reconcile(benchmark::State& state)
+{
+    pfs::process_events events;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(events.reconcile());
+    }
+    state.counters["tasks"] = static_cast<double>(events.size());
+}
+
+// And with events, which costs in proportion to the churn
+void BM_process_events_poll(benchmark::State& state)
+{
+    pfs::process_events events;
+    if (!events.subscribe())
+    {
+        state.SkipWithError("Proc connector unavailable");
+        return;
+    }
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(events.poll());
+    }
+    state.counters["tasks"] = static_cast<double>(events.size());
+}
+
+} // anonymous namespace
+
+BENCHMARK(BM_getters)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_process_events_reconcile)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_process_events_poll)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_snapshot)
+    ->ArgName("threads")
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
@@ -0,0 +1,214 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <dirent.h>
+
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bench_common.hpp"
+#include "pfs/utils.hpp"
+
+using namespace pfs;
+using namespace pfs::impl::utils;
+
+namespace {
+
+// Typical tokens found in procfs files: small counters, large counters,
+// kernel addresses and inodes.
+const std::vector<std::string> decimal_tokens = {
+    "0", "1", "42", "4096", "123456", "18446744073709551615", "3735928559",
+    "987654321",
+};
+
+const std::vector<std::string> hex_tokens = {
+    "0", "1f", "0100007F", "ffff8db2fd23a400", "deadbeef", "00000000",
+    "FE800000", "0000FFFF",
+};
+
+const std::string ipv6_address = "FE800000000000000B9DB3FFFE5A0C2A";
+
+// The implementation 'stot' had before the fast path was introduced
+void legacy_stot(const std::string& str, unsigned long long& out, base b)
+{
+    size_t idx;
+    out = std::stoull(str, &idx, static_cast<int>(b));
+}
+
+void bench_stoull(benchmark::State& state, const std::vector<std::string>& tokens,
+                  base b)
+{
+    unsigned long long out = 0;
+    for (auto _ : state)
+    {
+        for (const auto& token : tokens)
+        {
+            legacy_stot(token, out, b);
+            benchmark::DoNotOptimize(out);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * tokens.size());
+}
+
+void bench_stot(benchmark::State& state, const std::vector<std::string>& tokens,
+                base b)
+{
+    unsigned long long out = 0;
+    for (auto _ : state)
+    {
+        for (const auto& token : tokens)
+        {
+            stot(token, out, b);
+            benchmark::DoNotOptimize(out);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * tokens.size());
+}
+
+void bench_from_chars(benchmark::State& state,
+                      const std::vector<std::string>& tokens, base b)
+{
+    unsigned long long out = 0;
+    for (auto _ : state)
+    {
+        for (const auto& token : tokens)
+        {
+            auto result = from_chars(token.data(), token.data() + token.size(),
+                                     out, b);
+            benchmark::DoNotOptimize(result);
+            benchmark::DoNotOptimize(out);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * tokens.size());
+}
+
+void BM_legacy_parse_ipv6_address(benchmark::State& state)
+{
+    static const size_t CHUNK_SIZE = 8;
+
+    ipv6 addr;
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < addr.size(); ++i)
+        {
+            std::string chunk = ipv6_address.substr(i * CHUNK_SIZE, CHUNK_SIZE);
+            addr[i] = static_cast<uint32_t>(std::stoul(chunk, nullptr, 16));
+        }
+        benchmark::DoNotOptimize(addr);
+    }
+}
+
+void BM_parse_ipv6_address(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        auto addr = parse_ipv6_address(ipv6_address);
+        benchmark::DoNotOptimize(addr);
+    }
+}
+
+// The implementation 'enumerate_numeric_files' had before getdents64:
+// readdir, and an exception for every non-numeric name
+std::set<int> legacy_enumerate_numeric_files(const std::string& dir)
+{
+    std::set<int> files;
+
+    DIR* dp = opendir(dir.c_str());
+    if (!dp)
+    {
+        throw std::runtime_error("Couldn't open dir");
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dp)))
+    {
+        if (entry->d_name[0] == '.')
+        {
+            continue;
+        }
+
+        try
+        {
+            files.insert(std::stoi(entry->d_name));
+        }
+        catch (const std::logic_error&)
+        {
+            // Not a numeric file name
+        }
+    }
+
+    closedir(dp);
+    return files;
+}
+
+// The directory is built lazily, so the fake procfs isn't created unless the
+// benchmarks that need it run
+using dir_getter = const std::string& (*)();
+
+void bench_legacy_enumerate_numeric_files(benchmark::State& state,
+                                          dir_getter get_dir)
+{
+    const auto& dir = get_dir();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(legacy_enumerate_numeric_files(dir));
+    }
+}
+
+void bench_enumerate_numeric_files(benchmark::State& state,
+                                   dir_getter get_dir)
+{
+    const auto& dir = get_dir();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(enumerate_numeric_files(dir));
+    }
+}
+
+const std::string& live_procfs_root()
+{
+    static const std::string root("/proc/");
+    return root;
+}
+
+const std::string& fake_procfs_root()
+{
+    return fake_procfs().get_root();
+}
+
+} // anonymous namespace
+
+BENCHMARK_CAPTURE(bench_stoull, decimal, decimal_tokens, base::decimal);
+BENCHMARK_CAPTURE(bench_stot, decimal, decimal_tokens, base::decimal);
+BENCHMARK_CAPTURE(bench_from_chars, decimal, decimal_tokens, base::decimal);
+
+BENCHMARK_CAPTURE(bench_stoull, hex, hex_tokens, base::hex);
+BENCHMARK_CAPTURE(bench_stot, hex, hex_tokens, base::hex);
+BENCHMARK_CAPTURE(bench_from_chars, hex, hex_tokens, base::hex);
+
+BENCHMARK(BM_legacy_parse_ipv6_address);
+BENCHMARK(BM_parse_ipv6_address);
+
+BENCHMARK_CAPTURE(bench_legacy_enumerate_numeric_files, live,
+                  live_procfs_root);
+BENCHMARK_CAPTURE(bench_enumerate_numeric_files, live, live_procfs_root);
+BENCHMARK_CAPTURE(bench_legacy_enumerate_numeric_files, fake,
+                  fake_procfs_root);
+BENCHMARK_CAPTURE(bench_enumerate_numeric_files, fake, fake_procfs_root);
@@ -19,6 +19,7 @@
 
 #include <sys/stat.h>
 
+#include <memory>
 #include <string>
 
 #include "types.hpp"
@@ -48,14 +49,22 @@ public: // Getters
 
 private:
     friend class task;
-    fd(const std::string& fds_root, int num);
+    // For fds of a pinned task, 'pinned_dirfd' is the task's directory,
+    // which the fd accesses its link through
+    fd(const std::string& fds_root, int num,
+       std::shared_ptr<const int> pinned_dirfd = nullptr);
 
 private:
     static std::string build_link_path(const std::string& fds_root, int num);
 
+    // The dirfd and path to use when accessing the link
+    int dirfd() const;
+    std::string link_path() const;
+
 private:
     const int _num;
     const std::string _link;
+    const std::shared_ptr<const int> _pinned_dirfd;
 };
 
 } // namespace pfs
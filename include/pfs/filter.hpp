@@ -23,8 +23,20 @@ namespace filter {
 enum class action {
     drop,
     keep,
+    stop,          // Drop the entry, and don't look at any further entries
+    keep_and_stop, // Keep the entry, and don't look at any further entries
 };
 
+inline bool is_kept(action act)
+{
+    return act == action::keep || act == action::keep_and_stop;
+}
+
+inline bool is_last(action act)
+{
+    return act == action::stop || act == action::keep_and_stop;
+}
+
 } // namespace filter
 } // namespace pfs
 
@@ -23,6 +23,7 @@
 #include <string>
 #include <vector>
 
+#include "pagemap.hpp"
 #include "types.hpp"
 
 namespace pfs {
@@ -38,17 +39,88 @@ public:
 
     ~mem();
 
+public: // Constants
+    // Small enough to stay in the cache while all the patterns are searched
+    static const size_t DEFAULT_SCAN_BUFFER_SIZE = 256 * 1024;
+
+public: // Types
+    // A run of consecutive pages read by 'read_sparse'
+    struct mem_chunk
+    {
+        uint64_t address;
+        std::vector<uint8_t> data;
+    };
+
+    // An occurrence of a pattern found by 'scan'
+    struct scan_match
+    {
+        uint64_t address;
+        size_t pattern; // The index of the pattern
+    };
+
+    // A single item of a batched read. The caller owns the buffer, which must
+    // be at least 'length' bytes long.
+    struct read_request
+    {
+        uint64_t address;
+        void* buffer;
+        size_t length;
+    };
+
 public: // API
     std::vector<uint8_t> read(const mem_region& region);
     std::vector<uint8_t> read(loff_t offset, size_t len);
 
+    // Read many items in as few syscalls as possible, directly into the
+    // buffers of the caller.
+    // Returns the number of bytes read for every item. An item that crosses
+    // an unmapped hole is read up to the hole, and an item that starts in one
+    // isn't read at all, without failing the rest of the batch.
+    // Throws std::system_error on other errors, e.g. if the task is gone.
+    std::vector<size_t> read_batch(const std::vector<read_request>& requests);
+
+    // Read only the pages of the region that hold data, i.e. are present or
+    // swapped out, according to the pagemap of the same task.
+    // Pages that were never touched read as zeros, and are skipped, as are
+    // file backed pages that aren't in the page cache.
+    // Consecutive pages are read as a single chunk.
+    std::vector<mem_chunk> read_sparse(const mem_region& region,
+                                       pagemap& pages,
+                                       bool include_swapped = true);
+
+    // Search the readable regions, e.g. the output of 'task::get_maps', for
+    // any of the patterns, which may contain any bytes.
+    // Regions are streamed through a buffer of 'buffer_size' bytes, which is
+    // reused for all the regions, and overlapping chunks ensure matches that
+    // span two chunks are found. Unreadable pages are skipped.
+    // If the task exits during the scan, it stops, and the matches found so
+    // far are returned.
+    // When 'threads' is larger than one, regions are scanned concurrently,
+    // using a buffer per region. The result doesn't depend on the number of
+    // threads.
+    // Returns the matches sorted by address, then by pattern.
+    // Throws std::invalid_argument if any of the patterns is empty.
+    std::vector<scan_match> scan(const std::vector<mem_region>& regions,
+                                 const std::vector<std::string>& patterns,
+                                 size_t threads     = 1,
+                                 size_t buffer_size = DEFAULT_SCAN_BUFFER_SIZE);
+
 private:
     friend class task;
-    mem(const std::string& path);
+    // When 'pid' is valid, reads use process_vm_readv(2), which can read
+    // items that aren't adjacent in a single call.
+    mem(const std::string& path, int dirfd = AT_FDCWD, pid_t pid = INVALID_PID);
+
+    size_t read_batch_vm(const std::vector<read_request>& requests,
+                         std::vector<size_t>& bytes_read);
+    void read_batch_file(const std::vector<read_request>& requests,
+                         size_t first, size_t last,
+                         std::vector<size_t>& bytes_read);
 
 private:
     const std::string _path;
     int _fd;
+    const pid_t _pid;
 };
 
 } // namespace pfs
@@ -0,0 +1,74 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PFS_MEM_REGION_INDEX_HPP
+#define PFS_MEM_REGION_INDEX_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "string_pool.hpp"
+#include "string_view.hpp"
+#include "types.hpp"
+
+namespace pfs {
+
+// Maps addresses to the memory regions of a task, e.g. for symbolizing
+// sampled instruction pointers. See 'task::get_maps_index'.
+// The start addresses are kept in a separate sorted array, so a lookup is a
+// binary search over a dense array of integers.
+class mem_region_index final
+{
+public:
+    mem_region_index() = default;
+
+    // Build an index over the given regions, e.g. the output of
+    // 'task::get_maps'. The regions must not overlap.
+    explicit mem_region_index(std::vector<mem_region> regions);
+
+    // Get the region that contains the address, or nullptr if the address
+    // isn't mapped. The pointer is valid until the index is modified.
+    const mem_region* find(uint64_t address) const;
+
+    // Rebuild the index from the content of a maps file, unless the content
+    // is identical to the one the index was last built from.
+    // When a pool is given, the pathnames are interned in it.
+    // Returns whether the index was rebuilt.
+    bool update(impl::string_view maps, string_pool* pool = nullptr);
+
+    // The regions, sorted by their start address
+    const std::vector<mem_region>& regions() const { return _regions; }
+
+    size_t size() const { return _regions.size(); }
+    bool empty() const { return _regions.empty(); }
+
+private:
+    void build();
+
+private:
+    std::vector<mem_region> _regions;
+    std::vector<uint64_t> _starts;
+
+    // The content of the maps file the index was built from, if any
+    std::string _maps;
+};
+
+} // namespace pfs
+
+#endif // PFS_MEM_REGION_INDEX_HPP
@@ -18,9 +18,11 @@
 #define PFS_NET_HPP
 
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "string_view.hpp"
 #include "types.hpp"
 #include "filter.hpp"
 
@@ -50,19 +52,82 @@ public:
     using net_route_filter = std::function<filter::action(const net_route&)>;
     using net_arp_filter = std::function<filter::action(const net_arp&)>;
 
+    // Runs on the raw line of a socket file, before it's parsed.
+    // Lines that are dropped here are never parsed, which makes it much
+    // cheaper than a regular filter. See 'peek_state' and 'peek_local_port'.
+    using net_socket_line_filter =
+        std::function<filter::action(impl::string_view)>;
+
+    // Parse a single column of a raw socket line, for use by line filters
+    static net_socket::net_state peek_state(impl::string_view line);
+    static uint16_t peek_local_port(impl::string_view line);
+
+public:
+    // Where the socket getters read the sockets from
+    enum class socket_backend
+    {
+        procfs,  // Parse the text of the socket files (the default)
+        netlink, // Dump them over NETLINK_SOCK_DIAG when possible
+    };
+
+    // Selects the backend of this object's socket getters.
+    // The netlink backend is only used for TCP, UDP and UDP-Lite sockets,
+    // and only when this object describes the caller's own network namespace.
+    // Calls with a line filter always parse the socket files, since there are
+    // no lines to filter. Whenever the kernel can't serve a request over
+    // netlink, the getters silently fall back to the socket files.
+    // Notes:
+    // - 'slot' is the position of the socket in the dump, not a hash bucket
+    // - 'ref_count' and 'skbuff' aren't exposed by sock_diag, and are zeroed
+    void set_socket_backend(socket_backend backend);
+    socket_backend get_socket_backend() const;
+
 public:
     std::vector<net_device> get_dev(net_device_filter filter = nullptr) const;
 
-    std::vector<net_socket> get_icmp(net_socket_filter filter = nullptr) const;
-    std::vector<net_socket> get_icmp6(net_socket_filter filter = nullptr) const;
-    std::vector<net_socket> get_raw(net_socket_filter filter = nullptr) const;
-    std::vector<net_socket> get_raw6(net_socket_filter filter = nullptr) const;
-    std::vector<net_socket> get_tcp(net_socket_filter filter = nullptr) const;
-    std::vector<net_socket> get_tcp6(net_socket_filter filter = nullptr) const;
-    std::vector<net_socket> get_udp(net_socket_filter filter = nullptr) const;
-    std::vector<net_socket> get_udp6(net_socket_filter filter = nullptr) const;
-    std::vector<net_socket> get_udplite(net_socket_filter filter = nullptr) const;
-    std::vector<net_socket> get_udplite6(net_socket_filter filter = nullptr) const;
+    std::vector<net_socket> get_icmp(net_socket_filter filter = nullptr,
+            net_socket_line_filter line_filter = nullptr) const;
+    std::vector<net_socket> get_icmp6(net_socket_filter filter = nullptr,
+            net_socket_line_filter line_filter = nullptr) const;
+    std::vector<net_socket> get_raw(net_socket_filter filter = nullptr,
+            net_socket_line_filter line_filter = nullptr) const;
+    std::vector<net_socket> get_raw6(net_socket_filter filter = nullptr,
+            net_socket_line_filter line_filter = nullptr) const;
+    std::vector<net_socket> get_tcp(net_socket_filter filter = nullptr,
+            net_socket_line_filter line_filter = nullptr) const;
+    std::vector<net_socket> get_tcp6(net_socket_filter filter = nullptr,
+            net_socket_line_filter line_filter = nullptr) const;
+    std::vector<net_socket> get_udp(net_socket_filter filter = nullptr,
+            net_socket_line_filter line_filter = nullptr) const;
+    std::vector<net_socket> get_udp6(net_socket_filter filter = nullptr,
+            net_socket_line_filter line_filter = nullptr) const;
+    std::vector<net_socket> get_udplite(net_socket_filter filter = nullptr,
+            net_socket_line_filter line_filter = nullptr) const;
+    std::vector<net_socket> get_udplite6(net_socket_filter filter = nullptr,
+            net_socket_line_filter line_filter = nullptr) const;
+
+    // Same as above, but only returns the sockets that match the query.
+    // With the netlink backend, sockets are matched by the kernel.
+    std::vector<net_socket> get_icmp(const net_socket_query& query,
+            net_socket_filter filter = nullptr) const;
+    std::vector<net_socket> get_icmp6(const net_socket_query& query,
+            net_socket_filter filter = nullptr) const;
+    std::vector<net_socket> get_raw(const net_socket_query& query,
+            net_socket_filter filter = nullptr) const;
+    std::vector<net_socket> get_raw6(const net_socket_query& query,
+            net_socket_filter filter = nullptr) const;
+    std::vector<net_socket> get_tcp(const net_socket_query& query,
+            net_socket_filter filter = nullptr) const;
+    std::vector<net_socket> get_tcp6(const net_socket_query& query,
+            net_socket_filter filter = nullptr) const;
+    std::vector<net_socket> get_udp(const net_socket_query& query,
+            net_socket_filter filter = nullptr) const;
+    std::vector<net_socket> get_udp6(const net_socket_query& query,
+            net_socket_filter filter = nullptr) const;
+    std::vector<net_socket> get_udplite(const net_socket_query& query,
+            net_socket_filter filter = nullptr) const;
+    std::vector<net_socket> get_udplite6(const net_socket_query& query,
+            net_socket_filter filter = nullptr) const;
 
     std::vector<netlink_socket> get_netlink(netlink_socket_filter filter = nullptr) const;
 
@@ -72,21 +137,68 @@ public:
 
     std::vector<net_arp> get_arp(net_arp_filter filter = nullptr) const;
 
+public:
+    // Streaming variants of the getters above, for when only counts or
+    // aggregates are needed. Every socket is handed to the visitor instead of
+    // being collected into a vector.
+    // Note: The same object is reused for all the sockets, and is only valid
+    // during the visitor call. Copy it if it's needed afterwards.
+    using net_socket_visitor = std::function<void(const net_socket&)>;
+    using unix_socket_visitor = std::function<void(const unix_socket&)>;
+
+    void for_each_icmp(net_socket_visitor visitor) const;
+    void for_each_icmp6(net_socket_visitor visitor) const;
+    void for_each_raw(net_socket_visitor visitor) const;
+    void for_each_raw6(net_socket_visitor visitor) const;
+    void for_each_tcp(net_socket_visitor visitor) const;
+    void for_each_tcp6(net_socket_visitor visitor) const;
+    void for_each_udp(net_socket_visitor visitor) const;
+    void for_each_udp6(net_socket_visitor visitor) const;
+    void for_each_udplite(net_socket_visitor visitor) const;
+    void for_each_udplite6(net_socket_visitor visitor) const;
+
+    void for_each_unix(unix_socket_visitor visitor) const;
+
 private:
     friend class task;
-    net(const std::string& parent_root);
+    // For the net of a pinned task, 'pinned_dirfd' is the task's directory,
+    // which all the files are accessed through
+    net(const std::string& parent_root,
+        std::shared_ptr<const int> pinned_dirfd = nullptr);
 
 private:
-    std::vector<net_socket> get_net_sockets(const std::string& file,
-            net_socket_filter filter = nullptr) const;
+    // Identifies a socket file, and the matching sock_diag request
+    struct socket_source
+    {
+        const char* file;
+        int family;
+        int protocol; // 0 if sock_diag can't dump it
+    };
+
+    std::vector<net_socket> get_net_sockets(const socket_source& source,
+            const net_socket_query& query,
+            net_socket_filter filter,
+            net_socket_line_filter line_filter) const;
+
+    void for_each_net_socket(const socket_source& source,
+                             net_socket_visitor visitor) const;
+
+    bool use_sock_diag(const socket_source& source) const;
 
     static std::string build_net_root(const std::string& parent_root);
 
+    // The dirfd and path to use when accessing a file of this net
+    int dirfd() const;
+    std::string file_path(const std::string& file) const;
+
 private:
     // Net has a "parent root", and not a "procfs root", because we could
     // be looking at a net namespace of a specific process.
     const std::string _parent_root;
     const std::string _net_root;
+    const std::shared_ptr<const int> _pinned_dirfd;
+
+    socket_backend _socket_backend;
 };
 
 } // namespace pfs
@@ -0,0 +1,83 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PFS_PAGEMAP_HPP
+#define PFS_PAGEMAP_HPP
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "types.hpp"
+
+namespace pfs {
+
+// Reads /proc/[pid]/pagemap, which reports the state of every virtual page
+// of a task, see 'pagemap_entry'.
+// Every page costs 8 bytes of pagemap, so large ranges are best walked using
+// 'for_each' rather than read as a whole.
+class pagemap final
+{
+public:
+    pagemap(const pagemap&)            = delete;
+    pagemap& operator=(const pagemap&) = delete;
+    pagemap& operator=(pagemap&&)      = delete;
+
+    pagemap(pagemap&& other) noexcept;
+
+    ~pagemap();
+
+public: // Types
+    // Called for consecutive chunks of entries. The address is that of the
+    // first page in the chunk. The entries are only valid during the call.
+    using visitor = std::function<void(uint64_t address,
+                                       const pagemap_entry* entries,
+                                       size_t count)>;
+
+public: // API
+    static size_t page_size();
+
+    // Read the entries of 'count' pages, starting from the page that contains
+    // the address
+    std::vector<pagemap_entry> read(uint64_t address, size_t count);
+    std::vector<pagemap_entry> read(const mem_region& region);
+
+    // Walk the entries of all the pages in the range [start, end), a chunk at
+    // a time, without holding all of them in memory
+    void for_each(uint64_t start, uint64_t end, const visitor& handle);
+
+    pagemap_summary summarize(const mem_region& region);
+
+private:
+    friend class task;
+    pagemap(const std::string& path, int dirfd = AT_FDCWD);
+
+    // Returns the number of entries read, which is smaller than requested
+    // past the end of the address space
+    size_t read(uint64_t page, pagemap_entry* entries, size_t count);
+
+private:
+    const std::string _path;
+    int _fd;
+};
+
+} // namespace pfs
+
+#endif // PFS_PAGEMAP_HPP
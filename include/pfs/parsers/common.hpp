@@ -26,12 +26,16 @@ namespace pfs {
 namespace impl {
 namespace parsers {
 
-dev_t parse_device(const std::string& device_str, utils::base base);
+dev_t parse_device(string_view device_str, utils::base base);
 
 task_state parse_task_state(char state_char);
 
 id_map parse_id_map_line(const std::string& line);
 
+// Parse the target of an fd link, e.g. 'socket:[15979]'.
+// Returns false if the fd isn't a socket.
+bool parse_socket_link(string_view link, ino64_t& inode);
+
 } // namespace parsers
 } // namespace impl
 } // namespace pfs
@@ -17,10 +17,14 @@
 #ifndef PFS_PARSERS_KV_FILE_PARSER_HPP
 #define PFS_PARSERS_KV_FILE_PARSER_HPP
 
-#include <fstream>
+#include <stdint.h>
+
+#include <algorithm>
+#include <initializer_list>
 #include <set>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 #include "pfs/parser_error.hpp"
 #include "pfs/utils.hpp"
@@ -29,31 +33,210 @@ namespace pfs {
 namespace impl {
 namespace parsers {
 
+// A perfect hash table, mapping the keys a parser knows to the functions that
+// parse their values.
+// The table is built once, usually when the parser's static table is
+// initialized, by looking for a seed under which every key gets a slot of its
+// own. A lookup then costs a single hash and a single comparison.
+template <typename Output>
+class kv_key_table
+{
+public:
+    using value_parser = void (*)(string_view value, Output& out);
+
+    // For remapped keys whose original key carries information, e.g. the N
+    // of the 'cpuN' lines of /proc/stat
+    using keyed_value_parser = void (*)(string_view key, string_view value,
+                                        Output& out);
+
+    struct entry
+    {
+        entry(const char* k, value_parser p) : key(k), parser(p) {}
+        entry(const char* k, keyed_value_parser p) : key(k), keyed_parser(p)
+        {}
+
+        const char* key;
+        value_parser parser             = nullptr;
+        keyed_value_parser keyed_parser = nullptr;
+    };
+
+    static const size_t npos = static_cast<size_t>(-1);
+
+    // Requested keys are tracked using a bitmask
+    static const size_t MAX_KEYS = 64;
+
+public:
+    kv_key_table(std::initializer_list<entry> entries)
+    {
+        if (entries.size() > MAX_KEYS)
+        {
+            throw std::logic_error("Too many keys for a key table");
+        }
+
+        for (const auto& e : entries)
+        {
+            // No seed can separate two identical keys
+            if (std::find(_keys.begin(), _keys.end(), string_view(e.key)) !=
+                _keys.end())
+            {
+                throw std::logic_error("Duplicate key in a key table: " +
+                                       std::string(e.key));
+            }
+
+            _keys.push_back(e.key);
+            _parsers.push_back(e.parser);
+            _keyed_parsers.push_back(e.keyed_parser);
+        }
+
+        static const size_t SEEDS_PER_SIZE = 1024;
+        static const size_t MAX_SIZE       = 64 * 1024;
+
+        size_t size = 1;
+        while (size < _keys.size() * 2)
+        {
+            size *= 2;
+        }
+
+        for (; size <= MAX_SIZE; size *= 2)
+        {
+            for (uint32_t seed = 0; seed < SEEDS_PER_SIZE; ++seed)
+            {
+                if (try_build(size, seed))
+                {
+                    return;
+                }
+            }
+        }
+
+        throw std::logic_error("Couldn't build a key table");
+    }
+
+    // Returns the index of the key, or 'npos' if the key is unknown
+    size_t find(string_view key) const
+    {
+        uint8_t index = _slots[hash(key, _seed) & _mask];
+        if (index == EMPTY || _keys[index] != key)
+        {
+            return npos;
+        }
+        return index;
+    }
+
+    value_parser parser(size_t index) const { return _parsers[index]; }
+
+    // Parse the value of the key at 'index', where 'key' is the key as it
+    // appears in the file, before it was remapped
+    void parse(size_t index, string_view key, string_view value,
+               Output& out) const
+    {
+        if (_keyed_parsers[index])
+        {
+            _keyed_parsers[index](key, value, out);
+        }
+        else
+        {
+            _parsers[index](value, out);
+        }
+    }
+
+    size_t size() const { return _keys.size(); }
+
+private:
+    static const uint8_t EMPTY = 0xFF;
+
+    // FNV-1a, mixed with a seed
+    static uint32_t hash(string_view key, uint32_t seed)
+    {
+        uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+        for (char c : key)
+        {
+            h ^= static_cast<uint8_t>(c);
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    bool try_build(size_t size, uint32_t seed)
+    {
+        _slots.assign(size, EMPTY);
+        _mask = size - 1;
+        _seed = seed;
+
+        for (size_t i = 0; i < _keys.size(); ++i)
+        {
+            auto& slot = _slots[hash(_keys[i], _seed) & _mask];
+            if (slot != EMPTY)
+            {
+                return false;
+            }
+            slot = static_cast<uint8_t>(i);
+        }
+        return true;
+    }
+
+private:
+    std::vector<string_view> _keys;
+    std::vector<value_parser> _parsers;
+    std::vector<keyed_value_parser> _keyed_parsers;
+    std::vector<uint8_t> _slots;
+    size_t _mask;
+    uint32_t _seed;
+};
+
+template <typename Output>
+const size_t kv_key_table<Output>::npos;
+
+template <typename Output>
+const size_t kv_key_table<Output>::MAX_KEYS;
+
+template <typename Output>
+const uint8_t kv_key_table<Output>::EMPTY;
+
 // When parsing key value text files, we might encounter different keys which
 // should be parsed in the same manner. To relate those lines in the same
-// manner, a remap function can be used.
-using remap_function = const std::function<void(std::string&)>;
+// manner, a remap function can be used. It returns the key to look up.
+using remap_function = string_view (*)(string_view key);
 
 template <typename Output>
 class kv_file_parser
 {
 public:
+    // If the caller specified a set of keys, only those are parsed, and the
+    // parsing stops as soon as all of them were found.
+    // Note: Files that require a key remap might repeat the same key (e.g.
+    // the 'cpuN' lines of /proc/stat), so they are always read to the end.
     Output parse(const std::string& path,
-                 const std::set<std::string>& keys = {})
+                 const std::set<std::string>& keys = {},
+                 int dirfd = AT_FDCWD)
     {
-        std::ifstream in(path);
-        if (!in)
+        uint64_t requested = 0;
+        size_t remaining   = 0;
+        for (const auto& key : keys)
         {
-            throw parser_error("Couldn't open file", path);
+            size_t index = _parsers.find(key);
+            if (index != key_table::npos)
+            {
+                requested |= bit(index);
+                ++remaining;
+            }
         }
 
+        bool filtered   = !keys.empty();
+        bool stop_early = filtered && !_key_remap;
+
+        utils::line_reader in(path, dirfd);
+
         Output output;
+        if (filtered && remaining == 0)
+        {
+            return output;
+        }
 
-        std::string line;
-        while (std::getline(in, line))
+        string_view line;
+        while (in.next(line))
         {
-            std::string key;
-            std::string value;
+            string_view key;
+            string_view value;
             std::tie(key, value) = utils::split_once(line, _delim);
             if (key.empty())
             {
@@ -61,26 +244,31 @@ public:
             }
 
             utils::rtrim(key);
-            if (_key_remap)
+            string_view lookup_key = _key_remap ? _key_remap(key) : key;
+
+            size_t index = _parsers.find(lookup_key);
+            if (index == key_table::npos)
             {
-                _key_remap(key);
+                continue;
             }
 
-            // Value MIGHT be an empty value, for example:
-            // Process without any groups
-
-            // If caller specified a set of keys, get only those
-            if (!keys.empty() && keys.find(key) == keys.end())
+            if (filtered && !(requested & bit(index)))
             {
                 continue;
             }
 
-            auto iter = _parsers.find(key);
-            if (iter != _parsers.end())
+            // Value MIGHT be an empty value, for example:
+            // Process without any groups
+            utils::ltrim(value);
+            _parsers.parse(index, key, value, output);
+
+            if (stop_early)
             {
-                utils::ltrim(value);
-                auto& parser = iter->second;
-                parser(value, output);
+                requested &= ~bit(index);
+                if (--remaining == 0)
+                {
+                    break;
+                }
             }
         }
 
@@ -88,19 +276,21 @@ public:
     }
 
 protected:
-    using value_parser =
-        std::function<void(const std::string& value, Output& out)>;
-    using value_parsers = std::unordered_map<std::string, value_parser>;
+    using key_table     = kv_key_table<Output>;
+    using value_parsers = key_table;
 
     kv_file_parser(const char delim, const value_parsers& parsers,
                    remap_function key_remap = nullptr)
         : _delim(delim), _parsers(parsers), _key_remap(key_remap)
     {}
 
+private:
+    static uint64_t bit(size_t index) { return uint64_t(1) << index; }
+
 private:
     const char _delim;
     const value_parsers& _parsers;
-    remap_function _key_remap;
+    const remap_function _key_remap;
 };
 
 } // namespace parsers
@@ -17,7 +17,7 @@
 #ifndef PFS_PARSERS_GENERIC_HPP
 #define PFS_PARSERS_GENERIC_HPP
 
-#include <fstream>
+#include <functional>
 #include <string>
 
 #include "pfs/parser_error.hpp"
@@ -31,41 +31,106 @@ namespace parsers {
 template <typename Inserter>
 using inserted_type = typename Inserter::container_type::value_type;
 
+// A filter that runs on the raw line, before it is parsed.
+// Rejecting lines this way saves the cost of parsing them altogether.
+using line_filter = std::function<filter::action(string_view)>;
+
 template <typename Inserter>
 void parse_file_lines(
     const std::string& path,
     Inserter inserter,
     std::function<inserted_type<Inserter>(const std::string&)> parser,
     std::function<filter::action(const inserted_type<Inserter>&)> filter = nullptr,
-    size_t lines_to_skip = 0)
+    size_t lines_to_skip = 0,
+    int dirfd = AT_FDCWD,
+    line_filter raw_filter = nullptr)
 {
-    std::ifstream in(path);
-    if (!in)
-    {
-        throw std::runtime_error("Couldn't open file");
-    }
+    utils::line_reader in(path, dirfd);
 
+    // Reused for all the lines, to avoid allocating per line
     std::string line;
-    for (size_t i = 0; std::getline(in, line); ++i)
+    string_view raw;
+    for (size_t i = 0; in.next(raw); ++i)
     {
         if (i < lines_to_skip)
         {
             continue;
         }
 
-        if (line.empty())
+        if (raw.empty())
         {
             continue;
         }
 
+        bool last = false;
+        if (raw_filter)
+        {
+            auto act = raw_filter(raw);
+            if (!filter::is_kept(act))
+            {
+                if (filter::is_last(act))
+                {
+                    break;
+                }
+                continue;
+            }
+            last = filter::is_last(act);
+        }
+
+        line.assign(raw.data(), raw.size());
         auto inserted = parser(line);
 
-        if (filter && filter(inserted) != filter::action::keep)
+        auto act = filter ? filter(inserted) : filter::action::keep;
+        if (filter::is_kept(act))
+        {
+            inserter = std::move(inserted);
+        }
+
+        if (last || filter::is_last(act))
+        {
+            break;
+        }
+    }
+}
+
+template <typename Record>
+struct record_callbacks
+{
+    // Parse a line into an existing record, overwriting all of its fields
+    using parser  = std::function<void(string_view, Record&)>;
+    using visitor = std::function<void(const Record&)>;
+};
+
+// A streaming variant of the function above, that never materializes a
+// container: Every line is parsed into the same record, which is then handed
+// to the visitor. Records holding strings keep their capacity between lines.
+// The record is only valid during the visitor call.
+template <typename Record>
+void parse_file_lines(
+    const std::string& path,
+    Record& record,
+    typename record_callbacks<Record>::parser parser,
+    typename record_callbacks<Record>::visitor visitor,
+    size_t lines_to_skip = 0,
+    int dirfd = AT_FDCWD)
+{
+    utils::line_reader in(path, dirfd);
+
+    string_view line;
+    for (size_t i = 0; in.next(line); ++i)
+    {
+        if (i < lines_to_skip)
+        {
+            continue;
+        }
+
+        if (line.empty())
         {
             continue;
         }
 
-        inserter = std::move(inserted);
+        parser(line, record);
+        visitor(record);
     }
 }
 
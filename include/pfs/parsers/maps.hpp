@@ -25,7 +25,9 @@ namespace pfs {
 namespace impl {
 namespace parsers {
 
-mem_region parse_maps_line(const std::string& line);
+// When a pool is given, the pathname is interned in it
+mem_region parse_maps_line(const std::string& line,
+                           string_pool* pool = nullptr);
 
 } // namespace parsers
 } // namespace impl
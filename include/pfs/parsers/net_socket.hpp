@@ -19,6 +19,7 @@
 
 #include <string>
 
+#include "pfs/string_view.hpp"
 #include "pfs/types.hpp"
 
 namespace pfs {
@@ -27,6 +28,14 @@ namespace parsers {
 
 net_socket parse_net_socket_line(const std::string& line);
 
+// Same as above, but parses into an existing object, reusing its memory
+void parse_net_socket_line_into(string_view line, net_socket& out);
+
+// Parse a single column of a socket line, without parsing the rest of it.
+// Useful for filtering lines before they are fully parsed.
+net_socket::net_state parse_net_socket_state(string_view line);
+uint16_t parse_net_socket_local_port(string_view line);
+
 } // namespace parsers
 } // namespace impl
 } // namespace pfs
@@ -27,7 +27,7 @@ namespace impl {
 namespace parsers {
 
 template <typename T>
-static void to_number(const std::string& desc, const std::string& value,
+static void to_number(const std::string& desc, string_view value,
                       utils::base base, T& out)
 {
     try
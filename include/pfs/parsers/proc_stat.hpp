@@ -32,7 +32,7 @@ public:
     proc_stat_parser() : kv_file_parser<proc_stat>(DELIM, PARSERS, key_remap) {}
 
 private:
-    static void key_remap(std::string& key);
+    static string_view key_remap(string_view key);
 
 private:
     static const char DELIM;
@@ -17,7 +17,11 @@
 #ifndef PFS_PARSERS_SMAPS_HPP
 #define PFS_PARSERS_SMAPS_HPP
 
+#include <fcntl.h>
+
+#include <functional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "pfs/types.hpp"
@@ -26,7 +30,29 @@ namespace pfs {
 namespace impl {
 namespace parsers {
 
-std::vector<mem_map> parse_smaps(const std::string& path);
+// When a pool is given, the pathnames are interned in it
+std::vector<mem_map> parse_smaps(const std::string& path,
+                                 int dirfd         = AT_FDCWD,
+                                 string_pool* pool = nullptr);
+
+// Streaming variant of the above. The same object is reused for all the
+// regions, and is only valid during the visitor call.
+void for_each_smaps(const std::string& path,
+                    const std::function<void(const mem_map&)>& visitor,
+                    int dirfd = AT_FDCWD);
+
+// Parse /proc/[pid]/smaps_rollup, which holds a single pseudo region that
+// spans all the regions of the task, and sums their sizes
+mem_map parse_smaps_rollup(const std::string& path, int dirfd = AT_FDCWD);
+
+// Sum the sizes of all the regions in smaps, without collecting them.
+// Produces the same totals as smaps_rollup, for kernels that don't have it.
+mem_map sum_smaps(const std::string& path, int dirfd = AT_FDCWD);
+
+// Same as above, but sums the regions of every pathname separately.
+// Anonymous regions are grouped under an empty pathname.
+std::unordered_map<std::string, mem_map>
+sum_smaps_by_pathname(const std::string& path, int dirfd = AT_FDCWD);
 
 } // namespace parsers
 } // namespace impl
@@ -29,9 +29,6 @@ class task_io_parser : public kv_file_parser<io_stats>
 public:
     task_io_parser() : kv_file_parser<io_stats>(DELIM, PARSERS) {}
 
-private:
-    static value_parsers make_value_parsers();
-
 private:
     static const char DELIM;
     static const value_parsers PARSERS;
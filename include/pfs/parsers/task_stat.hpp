@@ -0,0 +1,35 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PFS_PARSERS_TASK_STAT_HPP
+#define PFS_PARSERS_TASK_STAT_HPP
+
+#include "pfs/string_view.hpp"
+#include "pfs/types.hpp"
+
+namespace pfs {
+namespace impl {
+namespace parsers {
+
+// Parse the content of /proc/[pid]/stat.
+// Doesn't allocate, except for the 'comm' value.
+task_stat parse_task_stat_line(string_view line);
+
+} // namespace parsers
+} // namespace impl
+} // namespace pfs
+
+#endif // PFS_PARSERS_TASK_STAT_HPP
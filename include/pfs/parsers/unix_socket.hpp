@@ -19,6 +19,7 @@
 
 #include <string>
 
+#include "pfs/string_view.hpp"
 #include "pfs/types.hpp"
 
 namespace pfs {
@@ -27,6 +28,9 @@ namespace parsers {
 
 unix_socket parse_unix_socket_line(const std::string& line);
 
+// Same as above, but parses into an existing object, reusing its memory
+void parse_unix_socket_line_into(string_view line, unix_socket& out);
+
 } // namespace parsers
 } // namespace impl
 } // namespace pfs
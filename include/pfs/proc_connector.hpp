@@ -0,0 +1,56 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#ifndef PFS_PROC_CONNECTOR_HPP
+#define PFS_PROC_CONNECTOR_HPP
+
+#include <functional>
+
+#include "pfs/process_events.hpp"
+
+struct proc_event;
+
+namespace pfs {
+namespace impl {
+namespace proc_connector {
+
+using visitor = std::function<void(const proc_event&)>;
+
+// Open a non-blocking NETLINK_CONNECTOR socket, and subscribe it to the
+// events of the proc connector.
+// Returns -1 if the kernel won't report events to the caller (e.g. it lacks
+// CAP_NET_ADMIN, or isn't in the initial PID namespace), which is only known
+// once the kernel acknowledges the subscription.
+int subscribe();
+
+// Unsubscribe and close a socket returned by 'subscribe'
+void unsubscribe(int fd);
+
+// Hand all the pending events to the visitor, without blocking.
+// Returns false if events were lost because the socket buffer overflowed.
+bool receive(int fd, const visitor& visit);
+
+// Convert a proc connector event into a process event.
+// Returns false for events that don't create, replace or end a process,
+// e.g. the creation or exit of a thread, or a change of credentials.
+bool parse_proc_event(const proc_event& event, process_event& out);
+
+} // namespace proc_connector
+} // namespace impl
+} // namespace pfs
+
+#endif // PFS_PROC_CONNECTOR_HPP
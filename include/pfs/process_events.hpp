@@ -0,0 +1,141 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#ifndef PFS_PROCESS_EVENTS_HPP
+#define PFS_PROCESS_EVENTS_HPP
+
+#include <stddef.h>
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "procfs.hpp"
+#include "task.hpp"
+
+namespace pfs {
+
+// A change in the set of live processes
+struct process_event
+{
+    enum class type
+    {
+        fork, // A new process was created
+        exec, // A process replaced its program
+        exit, // A process exited
+    };
+
+    type what       = type::fork;
+    int pid         = 0;
+    int parent_pid  = 0;  // fork only, 0 if unknown
+    int exit_code   = 0;  // exit only, as returned by wait(2), 0 if unknown
+    bool reconciled = false; // Found by reconciliation, the event was lost
+};
+
+// A live table of the processes of the system, kept up to date by the
+// events of the netlink proc connector, so keeping track of the processes
+// costs in proportion to how many of them start and exit, rather than to
+// how many of them are running.
+// Events can be lost (e.g. when the socket buffer overflows, which is
+// detected and handled by 'poll'), so callers should still 'reconcile'
+// periodically, which rescans the procfs root.
+// Subscribing requires CAP_NET_ADMIN, and the initial PID namespace, which is
+// why the table also works without events, using 'reconcile' alone.
+class process_events final
+{
+public:
+    // Called for every change applied to the table
+    using visitor = std::function<void(const process_event&)>;
+
+public:
+    // Build the table from a scan of the procfs root, which reads the state
+    // of every process once
+    explicit process_events(
+        const std::string& procfs_root = procfs::DEFAULT_ROOT);
+    ~process_events();
+
+    process_events(const process_events&) = delete;
+    process_events& operator=(const process_events&) = delete;
+
+    process_events(process_events&&) = delete;
+    process_events& operator=(process_events&&) = delete;
+
+public: // Events
+    // Start receiving events, and reconcile the table with the processes
+    // that changed before the subscription took effect.
+    // Returns false if the kernel won't report events to the caller.
+    // Only the default procfs root can be subscribed.
+    bool subscribe();
+    bool is_subscribed() const { return _fd >= 0; }
+
+    // A descriptor that becomes readable when events are pending, e.g. for
+    // waiting on events with epoll. -1 if not subscribed.
+    int fd() const { return _fd; }
+
+    // Wait up to 'timeout_ms' milliseconds for events (-1 waits forever),
+    // and apply all the pending events to the table.
+    // Reconciles the table if events were lost, and applies pending exits
+    // (see 'apply') whose process has no live threads left.
+    // Returns immediately if not subscribed.
+    // Returns the number of changes applied.
+    size_t poll(int timeout_ms = 0, const visitor& visit = nullptr);
+
+    // Rescan the procfs root, and apply the differences to the table.
+    // Zombies aren't added, since their exit was either reported already or
+    // will be reconciled when they're reaped. Pending exits (see 'apply')
+    // whose process has no live threads left are applied as well.
+    // Returns the number of changes applied.
+    size_t reconcile(const visitor& visit = nullptr);
+
+    // Apply a single event, e.g. one received by another proc connector
+    // listener, and visit it if it changed the table.
+    // The exit of a main thread (e.g. through pthread_exit) is reported like
+    // the exit of its process, so exits are only applied once the process
+    // has no other live threads. Until then, the exit is kept pending, and
+    // it's applied (and visited) by the first 'poll' or 'reconcile' that
+    // finds the last thread gone. An exec cancels the pending exit, since
+    // one of the other threads took over the process.
+    // Returns whether the table changed.
+    bool apply(const process_event& event, const visitor& visit = nullptr);
+
+public: // Table
+    size_t size() const { return _pids.size(); }
+    bool contains(int pid) const { return _pids.count(pid) != 0; }
+
+    // The live processes, sorted by ID, see 'procfs::list_processes'
+    std::vector<task_ref> list_processes() const;
+
+private:
+    // Apply the pending exits of processes without live threads left
+    size_t apply_pending_exits(const visitor& visit);
+
+    // Whether the process is gone, or is a zombie without live threads
+    bool is_zombie(int pid) const;
+
+private:
+    const procfs _procfs;
+    const std::string _root;
+    std::set<int> _pids;
+    std::map<int, process_event> _pending_exits; // Keyed by pid
+    int _fd = -1;
+};
+
+} // namespace pfs
+
+#endif // PFS_PROCESS_EVENTS_HPP
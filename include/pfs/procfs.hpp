@@ -24,6 +24,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "socket_owner_index.hpp"
 #include "task.hpp"
 #include "types.hpp"
 
@@ -45,11 +46,49 @@ public:
 
 public: // Task API
     task get_task(int task_id = getpid()) const;
-    std::set<task> get_processes(task::task_filter filter = nullptr) const;
+    // When 'threads' is larger than one, the filter is called concurrently
+    // from multiple threads, and must be thread-safe. The result doesn't
+    // depend on the number of threads.
+    std::set<task> get_processes(task::task_filter filter = nullptr,
+                                 size_t threads                = 1) const;
+
+    // A compact variant of 'get_processes', returning lightweight references
+    // sorted by ID. Use it to enumerate many tasks, e.g. all the threads of a
+    // busy host, when only a few of them are accessed afterwards.
+    std::vector<task_ref> list_processes() const;
+
+    // Collect the requested per-task files (see 'task_fields') of all the
+    // processes in a single pass.
+    // Every task is pinned while its files are read, and the read buffers are
+    // shared by all the tasks.
+    // Tasks that die during the snapshot are omitted.
+    // When 'threads' is larger than one, tasks are collected concurrently.
+    // The result doesn't depend on the number of threads.
+    task_snapshot snapshot(unsigned fields = task_fields::all,
+                           size_t threads  = 1) const;
 
 public: // Network API
     net get_net(int task_id = getpid()) const;
 
+    // Map the sockets of all the processes to the processes that hold them,
+    // e.g. for finding the owners of the sockets returned by 'get_net()'.
+    // Fd links are resolved with readlink, the sockets are never stat-ed.
+    // Processes whose fds can't be accessed are indexed without sockets.
+    // When 'threads' is larger than one, processes are scanned concurrently.
+    socket_owner_index get_socket_owners(size_t threads = 1) const;
+
+    // Rescan all the processes, and forget the ones that exited.
+    // Returns whether the index changed.
+    bool refresh_socket_owners(socket_owner_index& index,
+                               size_t threads = 1) const;
+
+    // Rescan only the given processes, e.g. the ones that were reported to
+    // have been created or exited. Processes that are gone are forgotten.
+    // Returns whether the index changed.
+    bool rescan_socket_owners(socket_owner_index& index,
+                              const std::vector<int>& pids,
+                              size_t threads = 1) const;
+
 public: // System API
     std::vector<zone> get_buddyinfo() const;
 
@@ -77,6 +116,10 @@ private: // Private utilities
     static std::string build_root(std::string root);
     static void validate_root(const std::string& root);
 
+    struct snapshot_entry;
+    static void collect_task(const task& unpinned, unsigned fields,
+                             string_pool& pool, snapshot_entry& out);
+
 private:
     const std::string _root;
 };
@@ -0,0 +1,262 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PFS_RATES_HPP
+#define PFS_RATES_HPP
+
+#include <sys/types.h>
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#include "types.hpp"
+
+namespace pfs {
+
+// Rate trackers turn consecutive samples of cumulative counters into
+// per-interval rates.
+// Every tracker keeps the previous sample in a flat table sorted by key, and
+// matches it against the next sample with a linear merge. The tables and the
+// output are reused across updates, so a steady state scrape doesn't
+// allocate.
+// Keys that only appear in one of the samples (e.g. a task that was just
+// created) don't produce rates. Counters that went backwards (e.g. a device
+// that was reset) produce zero rates.
+
+using rate_clock = std::chrono::steady_clock;
+
+namespace impl {
+
+template <typename Key, typename Counters>
+class sample_table
+{
+public:
+    // Start collecting a new sample
+    void begin() { _current.clear(); }
+
+    void add(const Key& key, const Counters& counters)
+    {
+        _current.push_back(entry{key, counters});
+    }
+
+    // Call 'handle(key, previous, current)' for every key found in both the
+    // previous and the current sample, then make the current sample the
+    // previous one
+    template <typename Handler>
+    void commit(Handler handle)
+    {
+        auto less = [](const entry& lhs, const entry& rhs) {
+            return lhs.key < rhs.key;
+        };
+        if (!std::is_sorted(_current.begin(), _current.end(), less))
+        {
+            std::sort(_current.begin(), _current.end(), less);
+        }
+
+        auto prev = _previous.begin();
+        auto curr = _current.begin();
+        while (prev != _previous.end() && curr != _current.end())
+        {
+            if (prev->key < curr->key)
+            {
+                ++prev;
+            }
+            else if (curr->key < prev->key)
+            {
+                ++curr;
+            }
+            else
+            {
+                handle(curr->key, prev->counters, curr->counters);
+                ++prev;
+                ++curr;
+            }
+        }
+
+        _previous.swap(_current);
+    }
+
+private:
+    struct entry
+    {
+        Key key;
+        Counters counters;
+    };
+
+    std::vector<entry> _previous;
+    std::vector<entry> _current;
+};
+
+// The difference between two samples of a cumulative counter
+inline unsigned long long counter_delta(unsigned long long previous,
+                                        unsigned long long current)
+{
+    return current >= previous ? current - previous : 0;
+}
+
+} // namespace impl
+
+// The share of time spent in every state, all values are in the range [0, 1]
+struct cpu_usage
+{
+    int cpu           = -1; // See 'proc_stat::cpu::id', -1 for the total
+    double user       = 0;
+    double nice       = 0;
+    double system     = 0;
+    double idle       = 0;
+    double iowait     = 0;
+    double irq        = 0;
+    double softirq    = 0;
+    double steal      = 0;
+    double guest      = 0; // Already accounted for in 'user'
+    double guest_nice = 0; // Already accounted for in 'nice'
+
+    double busy() const
+    {
+        return user + nice + system + irq + softirq + steal;
+    }
+};
+
+// Tracks the cpus reported by /proc/stat.
+// Cpus are keyed by their ID (see 'proc_stat::cpu::id'), since /proc/stat
+// omits offline cpus, so the position of a cpu changes when other cpus go
+// offline or come back online. Cpus without an ID are keyed by position.
+class cpu_rate_tracker
+{
+public:
+    // Returns false if there's no previous sample to compare against yet
+    bool update(const proc_stat& stat);
+
+    const cpu_usage& total() const { return _total; }
+
+    // Sorted by cpu ID. Cpus that weren't online in both samples are
+    // omitted, so use 'cpu_usage::cpu' rather than the position.
+    const std::vector<cpu_usage>& per_cpu() const { return _per_cpu; }
+
+private:
+    impl::sample_table<int, proc_stat::cpu> _cpus;
+    proc_stat::cpu _previous_total;
+    bool _has_previous = false;
+    cpu_usage _total;
+    std::vector<cpu_usage> _per_cpu;
+};
+
+struct task_rates
+{
+    int pid;
+    unsigned long long starttime;
+
+    // In cpus, e.g. 1.5 means a cpu and a half
+    double user_cpu;
+    double system_cpu;
+    double cpu() const { return user_cpu + system_cpu; }
+
+    // Only valid if 'has_io' is set, see 'task_snapshot::collected'
+    bool has_io;
+
+    // Per second
+    double rchar;
+    double wchar;
+    double syscr;
+    double syscw;
+    double read_bytes;
+    double write_bytes;
+    double cancelled_write_bytes;
+};
+
+// Tracks tasks collected using 'procfs::snapshot'.
+// Tasks are keyed by their ID and start time, so a recycled ID is
+// never mistaken for the task that previously held it.
+class task_rate_tracker
+{
+public:
+    // Use the clock ticks per second of the system by default
+    explicit task_rate_tracker(long ticks_per_second = 0);
+
+    // The snapshot must include 'task_fields::stat'. Tasks whose stat
+    // wasn't collected are skipped. Rates for 'io' are calculated if
+    // collected as well.
+    // Returns false if there's no previous sample to compare against yet.
+    bool update(const task_snapshot& snapshot,
+                rate_clock::time_point now = rate_clock::now());
+
+    // Sorted by pid
+    const std::vector<task_rates>& rates() const { return _rates; }
+
+private:
+    struct counters
+    {
+        unsigned long long utime;
+        unsigned long long stime;
+        bool has_io;
+        io_stats io;
+    };
+
+    using key = std::pair<int, unsigned long long>; // ID and start time
+
+    const double _ticks_per_second;
+    impl::sample_table<key, counters> _tasks;
+    rate_clock::time_point _previous_time;
+    bool _has_previous = false;
+    std::vector<task_rates> _rates;
+};
+
+struct block_rates
+{
+    dev_t dev;
+
+    // Per second
+    double read_ios;
+    double write_ios;
+    double read_bytes;
+    double write_bytes;
+    double discard_ios;
+    double flush_ios;
+
+    // Average wait time per request, in milliseconds
+    double read_await;
+    double write_await;
+
+    // The share of time the device was busy, in the range [0, 1]
+    double utilization;
+
+    // The average number of requests in flight
+    double queue_depth;
+};
+
+// Tracks block devices, keyed by their device number (see 'block::get_dev').
+class block_rate_tracker
+{
+public:
+    // Returns false if there's no previous sample to compare against yet
+    bool update(const std::vector<std::pair<dev_t, block_stat>>& stats,
+                rate_clock::time_point now = rate_clock::now());
+
+    // Sorted by device number
+    const std::vector<block_rates>& rates() const { return _rates; }
+
+private:
+    impl::sample_table<dev_t, block_stat> _devices;
+    rate_clock::time_point _previous_time;
+    bool _has_previous = false;
+    std::vector<block_rates> _rates;
+};
+
+} // namespace pfs
+
+#endif // PFS_RATES_HPP
@@ -0,0 +1,53 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#ifndef PFS_SOCK_DIAG_HPP
+#define PFS_SOCK_DIAG_HPP
+
+#include <functional>
+
+#include "pfs/types.hpp"
+
+struct inet_diag_msg;
+
+namespace pfs {
+namespace impl {
+namespace sock_diag {
+
+// Returns false to stop the dump
+using visitor = std::function<bool(const net_socket&)>;
+
+// Dump the sockets of the caller's network namespace over NETLINK_SOCK_DIAG.
+// The query is evaluated by the kernel, using the state mask of the request
+// and a bytecode filter for the port.
+// Returns false if the kernel can't serve the request (e.g. NETLINK_SOCK_DIAG
+// or the protocol's diag module isn't available), in which case nothing was
+// handed to the visitor. Failures after the first socket throw.
+bool query_sockets(int family, int protocol, const net_socket_query& query,
+                   const visitor& visit);
+
+// Convert a single inet_diag response into a socket record.
+// Fields that sock_diag doesn't expose (ref_count, skbuff) are zeroed,
+// and 'slot' is the position of the socket in the dump.
+void parse_inet_diag_msg(const inet_diag_msg& msg, int protocol, size_t slot,
+                         net_socket& out);
+
+} // namespace sock_diag
+} // namespace impl
+} // namespace pfs
+
+#endif // PFS_SOCK_DIAG_HPP
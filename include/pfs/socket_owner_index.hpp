@@ -0,0 +1,96 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#ifndef PFS_SOCKET_OWNER_INDEX_HPP
+#define PFS_SOCKET_OWNER_INDEX_HPP
+
+#include <stddef.h>
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "types.hpp"
+
+namespace pfs {
+
+// A process holding a socket open
+struct socket_owner
+{
+    int pid;
+    int fd;
+
+    bool operator==(const socket_owner& rhs) const
+    {
+        return pid == rhs.pid && fd == rhs.fd;
+    }
+
+    bool operator<(const socket_owner& rhs) const
+    {
+        return pid < rhs.pid || (pid == rhs.pid && fd < rhs.fd);
+    }
+};
+
+// Maps socket inodes (e.g. 'net_socket::inode') to the processes that hold
+// them open, so joining sockets with processes is a hash lookup.
+// See 'procfs::get_socket_owners'.
+// The index remembers the sockets of every process, so refreshing it only
+// touches the entries of the sockets that were opened or closed since.
+class socket_owner_index final
+{
+public:
+    // The socket fds of a single process, as (fd, inode) pairs
+    using process_sockets = std::vector<std::pair<int, ino64_t>>;
+
+public:
+    socket_owner_index() = default;
+
+    // Get the owners of a socket, sorted by pid and fd.
+    // Empty if no (known) process holds the socket open.
+    // The reference is valid until the index is modified.
+    const std::vector<socket_owner>& find(ino64_t inode) const;
+
+    // Replace the sockets recorded for a process.
+    // Returns whether anything changed.
+    bool update(int pid, process_sockets sockets);
+
+    // Forget a process, e.g. after it exits.
+    // Returns whether the process was known.
+    bool remove(int pid);
+
+    // Forget all the processes that aren't in 'pids', which must be sorted.
+    // Returns whether any process was forgotten.
+    bool retain(const std::vector<int>& pids);
+
+    // The number of processes and sockets in the index
+    size_t processes() const { return _processes.size(); }
+    size_t sockets() const { return _owners.size(); }
+
+private:
+    void add_owner(ino64_t inode, socket_owner owner);
+    void remove_owner(ino64_t inode, socket_owner owner);
+
+private:
+    std::unordered_map<ino64_t, std::vector<socket_owner>> _owners;
+
+    // The sockets of every process, sorted by fd
+    std::unordered_map<int, process_sockets> _processes;
+};
+
+} // namespace pfs
+
+#endif // PFS_SOCKET_OWNER_INDEX_HPP
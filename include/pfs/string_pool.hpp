@@ -0,0 +1,106 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PFS_STRING_POOL_HPP
+#define PFS_STRING_POOL_HPP
+
+#include <stddef.h>
+
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "string_view.hpp"
+
+namespace pfs {
+
+// An immutable string, whose storage might be shared with other instances.
+// Copying one only copies a reference to the storage.
+// Converts to 'const std::string&', so it can be used wherever one is
+// expected.
+class shared_string
+{
+public:
+    shared_string() = default;
+    shared_string(const char* str);
+    shared_string(const std::string& str);
+    shared_string(std::string&& str);
+
+    const std::string& str() const;
+    operator const std::string&() const { return str(); }
+
+    const char* c_str() const { return str().c_str(); }
+    size_t size() const { return str().size(); }
+    bool empty() const { return str().empty(); }
+
+    // Whether both strings refer to the same storage
+    bool shares_storage(const shared_string& other) const;
+
+private:
+    friend class string_pool;
+
+    using storage = std::shared_ptr<const std::string>;
+
+    explicit shared_string(storage str) : _str(std::move(str)) {}
+
+    storage _str; // Null for the empty string
+};
+
+bool operator==(const shared_string& lhs, const shared_string& rhs);
+bool operator==(const shared_string& lhs, const std::string& rhs);
+bool operator==(const std::string& lhs, const shared_string& rhs);
+bool operator==(const shared_string& lhs, const char* rhs);
+bool operator!=(const shared_string& lhs, const shared_string& rhs);
+bool operator!=(const shared_string& lhs, const std::string& rhs);
+bool operator!=(const std::string& lhs, const shared_string& rhs);
+bool operator!=(const shared_string& lhs, const char* rhs);
+
+std::ostream& operator<<(std::ostream& out, const shared_string& str);
+
+// Interns strings, so that equal strings share the same storage.
+// Pass the same pool to multiple calls (e.g. 'task::get_maps' of all the
+// tasks) to deduplicate the strings across all of them.
+// The pool is thread-safe. Interned strings remain valid after the pool is
+// cleared or destroyed.
+class string_pool
+{
+public:
+    shared_string intern(impl::string_view str);
+
+    // The number of distinct strings in the pool
+    size_t size() const;
+
+    void clear();
+
+private:
+    struct view_hash
+    {
+        size_t operator()(impl::string_view str) const;
+    };
+
+    // The keys view the storage of the values they map to
+    using strings =
+        std::unordered_map<impl::string_view, shared_string::storage, view_hash>;
+
+    mutable std::mutex _mutex;
+    strings _strings;
+};
+
+} // namespace pfs
+
+#endif // PFS_STRING_POOL_HPP
@@ -0,0 +1,153 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PFS_STRING_VIEW_HPP
+#define PFS_STRING_VIEW_HPP
+
+#include <stddef.h>
+#include <string.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace pfs {
+namespace impl {
+
+// A minimal, C++11 compatible, non-owning view over a sequence of chars.
+// Modeled after C++17's std::string_view, but only implements what the
+// parsers need.
+// Note: The view doesn't own the memory, the caller must ensure that the
+// underlying buffer outlives the view.
+class string_view
+{
+public:
+    using const_iterator = const char*;
+
+    static const size_t npos = static_cast<size_t>(-1);
+
+public:
+    constexpr string_view() noexcept : _data(nullptr), _size(0) {}
+
+    constexpr string_view(const char* data, size_t size) noexcept
+        : _data(data), _size(size)
+    {}
+
+    string_view(const char* str) noexcept : _data(str), _size(strlen(str)) {}
+
+    string_view(const std::string& str) noexcept
+        : _data(str.data()), _size(str.size())
+    {}
+
+    explicit operator std::string() const { return std::string(_data, _size); }
+
+public:
+    constexpr const char* data() const noexcept { return _data; }
+    constexpr size_t size() const noexcept { return _size; }
+    constexpr bool empty() const noexcept { return _size == 0; }
+
+    constexpr const_iterator begin() const noexcept { return _data; }
+    constexpr const_iterator end() const noexcept { return _data + _size; }
+
+    constexpr char operator[](size_t pos) const { return _data[pos]; }
+    constexpr char front() const { return _data[0]; }
+    constexpr char back() const { return _data[_size - 1]; }
+
+    void remove_prefix(size_t n) noexcept
+    {
+        _data += n;
+        _size -= n;
+    }
+
+    void remove_suffix(size_t n) noexcept { _size -= n; }
+
+    string_view substr(size_t pos, size_t count = npos) const
+    {
+        if (pos > _size)
+        {
+            throw std::out_of_range("string_view::substr");
+        }
+
+        size_t available = _size - pos;
+        return string_view(_data + pos, count < available ? count : available);
+    }
+
+    size_t find(char c, size_t pos = 0) const noexcept
+    {
+        if (pos >= _size)
+        {
+            return npos;
+        }
+
+        auto found = static_cast<const char*>(memchr(_data + pos, c, _size - pos));
+        return found ? static_cast<size_t>(found - _data) : npos;
+    }
+
+    size_t rfind(char c) const noexcept
+    {
+        for (size_t i = _size; i > 0; --i)
+        {
+            if (_data[i - 1] == c)
+            {
+                return i - 1;
+            }
+        }
+        return npos;
+    }
+
+    bool operator==(string_view rhs) const noexcept
+    {
+        return _size == rhs._size &&
+               (_size == 0 || memcmp(_data, rhs._data, _size) == 0);
+    }
+
+    bool operator!=(string_view rhs) const noexcept { return !(*this == rhs); }
+
+private:
+    const char* _data;
+    size_t _size;
+};
+
+inline bool operator==(const std::string& lhs, string_view rhs) noexcept
+{
+    return string_view(lhs) == rhs;
+}
+
+inline bool operator!=(const std::string& lhs, string_view rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+inline bool operator==(const char* lhs, string_view rhs) noexcept
+{
+    return string_view(lhs) == rhs;
+}
+
+inline bool operator!=(const char* lhs, string_view rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+inline std::string operator+(const std::string& lhs, string_view rhs)
+{
+    std::string out(lhs);
+    out.append(rhs.data(), rhs.size());
+    return out;
+}
+
+} // namespace impl
+} // namespace pfs
+
+#endif // PFS_STRING_VIEW_HPP
@@ -18,6 +18,7 @@
 #define PFS_TASK_HPP
 
 #include <functional>
+#include <memory>
 #include <set>
 #include <stddef.h>
 #include <string>
@@ -26,11 +27,14 @@
 #include "fd.hpp"
 #include "filter.hpp"
 #include "mem.hpp"
+#include "mem_region_index.hpp"
 #include "net.hpp"
 #include "types.hpp"
 
 namespace pfs {
 
+class task_ref;
+
 class task final
 {
 public:
@@ -52,6 +56,39 @@ public: // Properties
     int id() const;
     const std::string& dir() const;
 
+public: // Pinning
+    // Get a pinned copy of this task.
+    // A pinned task holds an open handle to the task's directory for as long
+    // as any copy of it lives, and all the getters access files relative to
+    // that handle. This saves the path lookup on every call, and guarantees
+    // that all reads refer to the same task, even if its ID gets recycled.
+    // Once the task dies, getters throw std::system_error.
+    // Throws std::system_error if the task doesn't exist.
+    // Pinning a pinned task returns a copy that shares its handle.
+    // The objects returned by 'get_fds' and 'get_net' access their files
+    // through the handle as well. The threads returned by 'get_task',
+    // 'get_tasks' and 'list_tasks' are path based (pin them if needed), and
+    // so is the path returned by 'get_exe(false)'.
+    task pin() const;
+    bool is_pinned() const;
+
+public: // Liveness
+    // Check whether the task is still alive, without parsing any file.
+    // For pinned processes under the default procfs root, uses a pidfd, and
+    // reports a task that exited but wasn't reaped yet as dead.
+    // For other pinned tasks, checks whether the pinned directory still
+    // refers to a live task.
+    // For unpinned tasks, only checks that a task with this ID exists, which
+    // might be a different task if the ID was recycled.
+    bool is_alive() const;
+
+    // Check whether both objects refer to the same task, as opposed to
+    // different tasks that got the same ID. Compares the start time of the
+    // tasks, which is captured once when pinning, so comparing two pinned
+    // tasks only checks that both are alive (see 'is_alive').
+    // Returns false if either of the tasks is dead.
+    bool same_process(const task& other) const;
+
 public: // Getters
     std::vector<cgroup> get_cgroups() const;
 
@@ -72,12 +109,34 @@ public: // Getters
 
     std::set<ino64_t> get_fds_inodes() const;
 
-    std::vector<mem_region> get_maps() const;
+    // When a pool is given, the pathnames are interned in it. Share a pool
+    // between tasks to deduplicate the pathnames across all of them.
+    std::vector<mem_region> get_maps(string_pool* pool = nullptr) const;
+
+    std::vector<mem_map> get_smaps(string_pool* pool = nullptr) const;
+
+    // Get an index for looking up the region of an address, built from maps
+    mem_region_index get_maps_index(string_pool* pool = nullptr) const;
 
-    std::vector<mem_map> get_smaps() const;
+    // Refresh an index returned by 'get_maps_index', only re-parsing maps if
+    // its content changed since the index was built.
+    // Returns whether the index was rebuilt.
+    bool refresh_maps_index(mem_region_index& index,
+                            string_pool* pool = nullptr) const;
+
+    // Read the totals the kernel aggregated over all the regions.
+    // Requires Linux 4.14 and above, use sum_smaps() on older kernels.
+    mem_map get_smaps_rollup() const;
+
+    // Sum smaps without collecting the regions in the process
+    mem_map sum_smaps() const;
+
+    std::unordered_map<std::string, mem_map> sum_smaps_by_pathname() const;
 
     mem get_mem() const;
 
+    pagemap get_pagemap() const;
+
     std::vector<mount> get_mountinfo() const;
 
     net get_net() const;
@@ -100,7 +159,12 @@ public: // Getters
 
     task get_task(int id) const;
 
-    std::set<task> get_tasks(task_filter filter = nullptr) const;
+    // See 'procfs::get_processes' regarding 'threads'
+    std::set<task> get_tasks(task_filter filter = nullptr,
+                             size_t threads     = 1) const;
+
+    // A compact variant of 'get_tasks', see 'procfs::list_processes'
+    std::vector<task_ref> list_tasks() const;
 
     std::vector<id_map> get_uid_map() const;
     std::vector<id_map> get_gid_map() const;
@@ -108,16 +172,83 @@ public: // Getters
     uint32_t get_sessionid() const;
 
 private:
+    struct handle;
+
     friend class procfs;
-    task(const std::string& procfs_root, int id);
+    friend class task_ref;
+    task(const std::string& procfs_root, int id,
+         std::shared_ptr<const handle> pinned = nullptr);
 
 private:
     static std::string build_task_root(const std::string& procfs_root, int id);
 
+    // Build the tasks with the given IDs, and keep only those that pass the
+    // filter. The filter is called concurrently if 'threads' > 1.
+    static std::set<task> filter_tasks(const std::string& procfs_root,
+                                       const std::vector<int>& ids,
+                                       const task_filter& filter,
+                                       size_t threads);
+
+    // The dirfd and path to use when accessing a file of this task.
+    // For pinned tasks, paths are relative to the pinned directory.
+    int dirfd() const;
+    std::string file_path(const std::string& file) const;
+
+    // The dirfd of a pinned task, for objects derived from it (e.g. 'fd'),
+    // which keep the pinned directory open. Null for unpinned tasks.
+    std::shared_ptr<const int> pinned_dirfd() const;
+
+    // Open the directory handle of a pinned task
+    std::shared_ptr<handle> open_handle() const;
+
+    // Same as 'pin', but only pins the directory, without capturing the
+    // identity of the task, which saves a few syscalls when the task is only
+    // used for reading a batch of files (see 'procfs::snapshot').
+    task pin_directory() const;
+
+    unsigned long long start_time() const;
+
 private:
     const int _id;
     const std::string _procfs_root;
     const std::string _task_root;
+    const std::shared_ptr<const handle> _handle; // Only set for pinned tasks
+};
+
+// A lightweight reference to a task: Its ID, and the root directory of the
+// listing it came from, which all the references of a listing share.
+// Listing tasks this way costs no allocations per task, and the paths of a
+// task are only built once it's accessed through 'get'.
+// See 'procfs::list_processes' and 'task::list_tasks'.
+class task_ref final
+{
+public:
+    int id() const { return _id; }
+
+    // The directory of the task, built on every call
+    std::string dir() const;
+
+    // Get the task this refers to
+    task get() const;
+
+    bool operator<(const task_ref& rhs) const { return _id < rhs._id; }
+    bool operator==(const task_ref& rhs) const
+    {
+        return _id == rhs._id && *_root == *rhs._root;
+    }
+
+private:
+    friend class procfs;
+    friend class process_events;
+    friend class task;
+    task_ref(std::shared_ptr<const std::string> root, int id);
+
+    static std::vector<task_ref> make_refs(const std::string& root,
+                                           const std::vector<int>& ids);
+
+private:
+    std::shared_ptr<const std::string> _root;
+    int _id;
 };
 
 } // namespace pfs
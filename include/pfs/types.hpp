@@ -25,6 +25,8 @@
 #include <string>
 #include <vector>
 
+#include "string_pool.hpp"
+
 namespace pfs {
 
 constexpr uid_t   INVALID_UID     = (uid_t)-1;
@@ -324,6 +326,64 @@ struct mem_perm
     bool is_private  = false; // Is copy on write
 };
 
+// Flags of a memory mapping, as reported by the VmFlags field in smaps
+enum class vm_flag
+{
+    readable      = 0,  // rd
+    writable      = 1,  // wr
+    executable    = 2,  // ex
+    shared        = 3,  // sh
+    may_read      = 4,  // mr
+    may_write     = 5,  // mw
+    may_execute   = 6,  // me
+    may_share     = 7,  // ms
+    grows_down    = 8,  // gd
+    pfn_map       = 9,  // pf
+    deny_write    = 10, // dw
+    locked        = 11, // lo
+    io            = 12, // io
+    seq_read      = 13, // sr
+    rand_read     = 14, // rr
+    dont_copy     = 15, // dc
+    dont_expand   = 16, // de
+    lock_on_fault = 17, // lf
+    account       = 18, // ac
+    no_reserve    = 19, // nr
+    huge_tlb      = 20, // ht
+    sync          = 21, // sf
+    arch_1        = 22, // ar
+    wipe_on_fork  = 23, // wf
+    dont_dump     = 24, // dd
+    arm64_bti     = 25, // bt
+    mpx           = 26, // mp
+    soft_dirty    = 27, // sd
+    mixed_map     = 28, // mm
+    huge_page     = 29, // hg
+    no_huge_page  = 30, // nh
+    mergeable     = 31, // mg
+    uffd_missing  = 32, // um
+    uffd_wp       = 33, // uw
+    shadow_stack  = 34, // ss
+    sealed        = 35, // sl
+    arm64_mte     = 36, // mt
+    uffd_minor    = 37, // ui
+};
+
+struct vm_flags_mask
+{
+    using raw_type = uint64_t;
+
+    explicit vm_flags_mask(raw_type raw = 0);
+
+    bool is_set(vm_flag flag) const;
+
+    void set(vm_flag flag);
+
+    bool operator==(const vm_flags_mask& rhs) const;
+
+    raw_type raw;
+};
+
 struct mem_region
 {
     uint64_t start_address = 0;
@@ -332,7 +392,7 @@ struct mem_region
     size_t offset = 0;
     dev_t device  = 0;
     ino64_t inode = INVALID_INODE;
-    std::string pathname;
+    shared_string pathname; // Shared when parsed with a 'string_pool'
 
     bool operator<(const mem_region& rhs) const
     {
@@ -340,6 +400,36 @@ struct mem_region
     }
 };
 
+// The state of a single page, as reported by /proc/[pid]/pagemap
+struct pagemap_entry
+{
+    using raw_type = uint64_t;
+
+    explicit pagemap_entry(raw_type raw = 0);
+
+    bool is_present() const;
+    bool is_swapped() const;
+    bool is_soft_dirty() const;
+    bool is_exclusive() const; // Mapped by a single process only
+    bool is_file_or_shared_anon() const;
+
+    // The page frame number of a present page.
+    // Reads as zero without CAP_SYS_ADMIN.
+    uint64_t pfn() const;
+
+    raw_type raw;
+};
+
+// Page counts of a range of pages, see 'pagemap::summarize'
+struct pagemap_summary
+{
+    size_t pages      = 0;
+    size_t present    = 0;
+    size_t swapped    = 0;
+    size_t soft_dirty = 0;
+    size_t exclusive  = 0;
+};
+
 struct mem_map
 {
     mem_region region;
@@ -350,6 +440,9 @@ struct mem_map
     uint64_t rss              = 0; // In kB
     uint64_t pss              = 0; // In kB
     uint64_t pss_dirty        = 0; // In kB
+    uint64_t pss_anon         = 0; // In kB, only reported by smaps_rollup
+    uint64_t pss_file         = 0; // In kB, only reported by smaps_rollup
+    uint64_t pss_shmem        = 0; // In kB, only reported by smaps_rollup
     uint64_t shared_clean     = 0; // In kB
     uint64_t shared_dirty     = 0; // In kB
     uint64_t private_clean    = 0; // In kB
@@ -368,7 +461,9 @@ struct mem_map
     uint64_t locked           = 0; // In kB
 
     bool thp_eligible       = false;
-    std::vector<std::string> vm_flags;
+    vm_flags_mask vm_flags;
+    // Flags this version doesn't recognize, in their two-letter form
+    std::vector<std::string> unknown_vm_flags;
 };
 
 struct module
@@ -419,6 +514,7 @@ struct proc_stat
 
     struct cpu
     {
+        int id{-1}; // The N of a 'cpuN' line, -1 for the total
         unsigned long long user{0};
         unsigned long long nice{0};
         unsigned long long system{0};
@@ -565,6 +661,30 @@ struct net_socket
     }
 };
 
+// Selects sockets by their state and local port.
+// The netlink backend hands it over to the kernel, so sockets that don't
+// match are never copied to userspace.
+struct net_socket_query
+{
+    static uint32_t state_bit(net_socket::net_state state)
+    {
+        return 1u << static_cast<unsigned>(state);
+    }
+
+    uint32_t states     = 0; // A mask of 'state_bit's, 0 matches every state
+    uint16_t local_port = 0; // 0 matches every port
+
+    bool matches_state(net_socket::net_state state) const
+    {
+        return states == 0 || (states & state_bit(state)) != 0;
+    }
+
+    bool matches_port(uint16_t port) const
+    {
+        return local_port == 0 || local_port == port;
+    }
+};
+
 // Hint: See 'unix_seq_show @ af_unix.c'
 struct unix_socket
 {
@@ -715,6 +835,45 @@ struct syscall
     uint64_t instruction_pointer;
 };
 
+// The per-task files collected by 'procfs::snapshot'.
+// Combine them using bitwise or, e.g. task_fields::stat | task_fields::io
+struct task_fields
+{
+    enum : unsigned
+    {
+        stat    = 1 << 0,
+        status  = 1 << 1,
+        io      = 1 << 2,
+        statm   = 1 << 3,
+        cmdline = 1 << 4,
+        all     = stat | status | io | statm | cmdline,
+        // Not part of 'all', as it's considerably more expensive to collect.
+        // The pathnames are interned, and shared by all the tasks.
+        maps = 1 << 5,
+    };
+};
+
+// A struct-of-arrays snapshot of many tasks, see 'procfs::snapshot'.
+// All the columns are indexed the same as 'ids'. Columns of fields that
+// weren't requested are empty.
+struct task_snapshot
+{
+    std::vector<int> ids;
+
+    // The fields actually collected for each task. Might be a subset of the
+    // requested fields, e.g. reading 'io' requires ptrace access to the task.
+    std::vector<unsigned> collected;
+
+    std::vector<task_stat> stat;
+    std::vector<task_status> status;
+    std::vector<io_stats> io;
+    std::vector<mem_stats> statm;
+    std::vector<std::vector<std::string>> cmdline;
+    std::vector<std::vector<mem_region>> maps;
+
+    size_t size() const { return ids.size(); }
+};
+
 } // namespace pfs
 
 #endif // PFS_TYPES_HPP
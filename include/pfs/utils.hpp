@@ -19,14 +19,19 @@
 
 #include <fcntl.h>
 #include <stddef.h>
+#include <string.h>
 
+#include <array>
 #include <functional>
 #include <limits>
+#include <memory>
 #include <set>
 #include <string>
+#include <system_error>
 #include <vector>
 #include <stdexcept>
 
+#include "pfs/string_view.hpp"
 #include "pfs/types.hpp"
 
 namespace pfs {
@@ -40,73 +45,309 @@ enum class base
     hex     = 16
 };
 
-// Generic template using std's sto[u]ll implementations.
+// The result of a 'from_chars' call, modeled after C++17's std::from_chars.
+// - 'ptr' points to the first char that wasn't consumed.
+// - 'ec' is default constructed on success, or one of:
+//   - std::errc::invalid_argument: No digits were found, 'ptr' == first
+//   - std::errc::result_out_of_range: Value doesn't fit in the output type
+struct from_chars_result
+{
+    const char* ptr;
+    std::errc ec;
+};
+
+// Returns the numeric value of a digit in any base up to 36,
+// or a value larger than any supported base if 'c' isn't a digit.
+inline unsigned digit_value(char c)
+{
+    static const unsigned NOT_A_DIGIT = 36;
+
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+
+    c |= 0x20; // Lowercase letters, doesn't affect digits
+    if (c >= 'a' && c <= 'z')
+    {
+        return c - 'a' + 10;
+    }
+
+    return NOT_A_DIGIT;
+}
+
+// Parse an integer from the range [first, last) without allocating,
+// throwing or looking at the locale.
+// Has the semantics of C++17's std::from_chars: Leading whitespaces, a '+'
+// sign and base prefixes (e.g. 0x) are not accepted, and a '-' sign is only
+// accepted for signed types. Parsing stops at the first non-digit char.
+// On error, 'out' is left unmodified.
+template <typename T>
+from_chars_result from_chars(const char* first, const char* last, T& out,
+                             base b = base::decimal)
+{
+    using unsigned_type = typename std::make_unsigned<T>::type;
+
+    const char* ptr = first;
+
+    bool negative = false;
+    if (std::is_signed<T>::value && ptr != last && *ptr == '-')
+    {
+        negative = true;
+        ++ptr;
+    }
+
+    // The magnitude of the minimal signed value is larger by one
+    const unsigned_type limit =
+        static_cast<unsigned_type>(std::numeric_limits<T>::max()) +
+        (negative ? 1 : 0);
+
+    const unsigned radix = static_cast<unsigned>(b);
+
+    const char* digits = ptr;
+    unsigned_type value = 0;
+    bool overflow       = false;
+    for (; ptr != last; ++ptr)
+    {
+        unsigned digit = digit_value(*ptr);
+        if (digit >= radix)
+        {
+            break;
+        }
+
+        // Keep consuming digits on overflow, just like std::from_chars
+        if (overflow || value > (limit - digit) / radix)
+        {
+            overflow = true;
+            continue;
+        }
+
+        value = value * radix + digit;
+    }
+
+    if (ptr == digits)
+    {
+        return {first, std::errc::invalid_argument};
+    }
+
+    if (overflow)
+    {
+        return {ptr, std::errc::result_out_of_range};
+    }
+
+    if (negative && value != 0)
+    {
+        // Avoid negating the unsigned value, which might not be representable
+        out = static_cast<T>(-static_cast<T>(value - 1) - 1);
+    }
+    else
+    {
+        out = static_cast<T>(value);
+    }
+
+    return {ptr, std::errc()};
+}
+
+// Parse exactly 8 hex digits (e.g. the IPv4 address 0100007F in
+// /proc/net/tcp) into a 32-bit value.
+// Uses SWAR (SIMD within a register) to validate and convert all the digits
+// at once. Returns false, leaving 'out' unmodified, if any of the chars isn't
+// a hex digit.
+bool parse_hex32(const char* first, uint32_t& out);
+
+// Generic template for converting strings to integers.
 // Notes:
 // - Output is a variable so that the compiler can deduce the type
 // automatically.
 // - Removed the optional 'pos' variable from the signature (unused atm).
+// - Well-formed tokens (the common case) are handled by 'from_chars', which
+// doesn't require a null-terminated string (and hence, doesn't allocate).
+// Everything else (e.g. leading whitespaces, signs or the '0x' prefix) falls
+// back to std's sto[u]ll, keeping their semantics intact.
 // Throws:
 // Same exceptions as std::sto* implementation:
 // - std::invalid_argument
 // - std::out_of_range
 template <typename T>
-typename std::enable_if<std::is_signed<T>::value>::type
-stot(const std::string& str, T& out, base b = base::decimal)
+typename std::enable_if<std::is_integral<T>::value>::type
+stot(string_view str, T& out, base b = base::decimal)
 {
-    std::size_t* POS = nullptr;
+    static_assert(sizeof(T) <= sizeof(long long), "stot is ill-defined");
 
-    long long temp;
-    static_assert(sizeof(T) <= sizeof(temp), "signed stot is ill-defined");
+    const unsigned radix = static_cast<unsigned>(b);
 
-    temp = std::stoll(str, POS, static_cast<int>(b));
-    if (temp < std::numeric_limits<T>::min() ||
-        temp > std::numeric_limits<T>::max())
+    // Fast path: Starts with a digit, or a minus sign followed by a digit for
+    // signed types, and isn't prefixed with '0x'.
+    size_t first = (std::is_signed<T>::value && !str.empty() && str[0] == '-');
+    bool has_digit  = str.size() > first && digit_value(str[first]) < radix;
+    bool has_prefix = b == base::hex && str.size() > first + 1 &&
+                      str[first] == '0' && (str[first + 1] | 0x20) == 'x';
+    if (has_digit && !has_prefix)
     {
-        throw std::out_of_range(str);
+        auto result = from_chars(str.begin(), str.end(), out, b);
+        if (result.ec == std::errc::result_out_of_range)
+        {
+            throw std::out_of_range(std::string(str));
+        }
+        return;
     }
 
-    out = static_cast<T>(temp);
+    std::string buffer(str);
+    std::size_t* POS = nullptr;
+
+    if (std::is_signed<T>::value)
+    {
+        long long temp = std::stoll(buffer, POS, radix);
+        if (temp < static_cast<long long>(std::numeric_limits<T>::min()) ||
+            temp > static_cast<long long>(std::numeric_limits<T>::max()))
+        {
+            throw std::out_of_range(buffer);
+        }
+
+        out = static_cast<T>(temp);
+    }
+    else
+    {
+        unsigned long long temp = std::stoull(buffer, POS, radix);
+        if (temp > static_cast<unsigned long long>(
+                       std::numeric_limits<T>::max()))
+        {
+            throw std::out_of_range(buffer);
+        }
+
+        out = static_cast<T>(temp);
+    }
 }
 
-template <typename T>
-typename std::enable_if<std::is_unsigned<T>::value>::type
-stot(const std::string& str, T& out, base b = base::decimal)
+// A non-allocating tokenizer.
+// Walks over a buffer and yields the text between consequent delimiters as
+// views into the original buffer, hence the buffer must outlive the tokenizer
+// and all the tokens it yields.
+// Has the exact same semantics as 'split', i.e. the delimiters themselves are
+// dropped and whether empty tokens are yielded or not is governed by the
+// 'keep_empty' boolean flag.
+class tokenizer
 {
-    std::size_t* POS = nullptr;
+public:
+    tokenizer(string_view buffer, char delim = ' ', bool keep_empty = false)
+        : _buffer(buffer), _delim(delim), _keep_empty(keep_empty), _pos(0)
+    {}
+
+    // Get the next token. Returns false when there are no more tokens.
+    bool next(string_view& token)
+    {
+        while (_pos < _buffer.size())
+        {
+            size_t index = _buffer.find(_delim, _pos);
+            if (index == string_view::npos)
+            {
+                index = _buffer.size();
+            }
+
+            token = _buffer.substr(_pos, index - _pos);
+            _pos  = index + 1;
+
+            if (!token.empty() || _keep_empty)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    const string_view _buffer;
+    const char _delim;
+    const bool _keep_empty;
+    size_t _pos;
+};
 
-    unsigned long long temp;
-    static_assert(sizeof(T) <= sizeof(temp), "unsigned stot is ill-defined");
+// Split a buffer into a fixed number of tokens without allocating.
+// Stores up to N tokens and returns the total number of tokens found, which
+// might be larger than N. Use the returned value to validate the count.
+// The tokens are views into 'buffer', see 'tokenizer' for more information.
+template <size_t N>
+size_t split(string_view buffer, std::array<string_view, N>& tokens,
+             char delim = ' ', bool keep_empty = false)
+{
+    tokenizer tok(buffer, delim, keep_empty);
 
-    temp = std::stoull(str, POS, static_cast<int>(b));
-    if (temp < std::numeric_limits<T>::min() ||
-        temp > std::numeric_limits<T>::max())
+    size_t count = 0;
+    string_view token;
+    while (tok.next(token))
     {
-        throw std::out_of_range(str);
+        if (count < N)
+        {
+            tokens[count] = token;
+        }
+        ++count;
     }
 
-    out = static_cast<T>(temp);
+    return count;
 }
 
+// Call 'handle' for every index in the range [0, count) using up to 'threads'
+// threads, the calling thread included.
+// Indices are handed out one at a time from a shared counter, so a worker
+// that finishes early keeps taking work, and a few slow items (e.g. a task
+// with huge smaps) don't stall the rest of the batch.
+// If any call throws, the remaining indices are skipped, and the first
+// exception is rethrown once all the workers are done.
+void parallel_for(size_t count, size_t threads,
+                  const std::function<void(size_t)>& handle);
+
 // Iterate over all the files in a given directory.
 // Calls 'handle' for every file found.
+// Entries are listed with getdents64 into a buffer that is reused by later
+// calls on the same thread.
 // Note: 'handle' can be nullptr. Use this to count the number of files in a
 // directory. Returns the number of files found.
+// If the dir is relative, then it is interpreted relative to the directory
+// referred to by the file descriptor dirfd.
 size_t iterate_files(const std::string& dir, bool include_dots,
-                     std::function<void(const char*)> handle);
+                     std::function<void(const char*)> handle,
+                     int dirfd = AT_FDCWD);
 
 // Count all the files under the specified directory.
 // File can be any unix file type, i.e. regular file, directory, link, etc.
-size_t count_files(const std::string& dir, bool include_dots = false);
+size_t count_files(const std::string& dir, bool include_dots = false,
+                   int dirfd = AT_FDCWD);
 
 // Get a set of all the files under the specified directory.
 // File can be any unix file type, i.e. regular file, directory, link, etc.
 std::set<std::string> enumerate_files(const std::string& dir,
-                                      bool include_dots = false);
+                                      bool include_dots = false,
+                                      int dirfd = AT_FDCWD);
+
+// Parse a file name that is a non-negative number, e.g. a pid or an fd.
+// Names that don't start with a digit are rejected without parsing them.
+inline bool parse_numeric_file_name(const char* name, int& out)
+{
+    static const unsigned DECIMAL_RADIX = 10;
 
-// Get a set of all the files under the specified directory whose name is a
-// number. File can be any unix file type, i.e. regular file, directory, link,
-// etc.
-std::set<int> enumerate_numeric_files(const std::string& dir);
+    if (digit_value(name[0]) >= DECIMAL_RADIX)
+    {
+        return false;
+    }
+
+    int value;
+    auto last   = name + strlen(name);
+    auto result = from_chars(name, last, value);
+    if (result.ec != std::errc() || result.ptr != last)
+    {
+        return false;
+    }
+
+    out = value;
+    return true;
+}
+
+// Get all the files under the specified directory whose name is a number,
+// sorted in ascending order. File can be any unix file type, i.e. regular
+// file, directory, link, etc.
+std::vector<int> enumerate_numeric_files(const std::string& dir,
+                                         int dirfd = AT_FDCWD);
 
 // Get the inode number of the file.
 // If the linkname is relative, then it is interpreted relative to the directory
@@ -118,19 +359,105 @@ ino64_t get_inode(const std::string& path, int dirfd = AT_FDCWD);
 // referred to by the file descriptor dirfd.
 std::string readlink(const std::string& link, int dirfd = AT_FDCWD);
 
+// A growable buffer for reading whole files in one shot.
+// Reusing the same buffer for consecutive reads saves the allocations that
+// reading a file per line or into a fresh string costs. The storage grows by
+// doubling, so large files (e.g. /proc/net/tcp) take a few reads to fill.
+class read_buffer
+{
+public:
+    static const size_t INITIAL_SIZE = 4096;
+
+public:
+    read_buffer() = default;
+
+    read_buffer(const read_buffer&) = delete;
+    read_buffer& operator=(const read_buffer&) = delete;
+
+    // Read the content of the file into the buffer.
+    // If the file is longer than 'max_size', only the first 'max_size' bytes
+    // are read.
+    // If the file is relative, then it is interpreted relative to the
+    // directory referred to by the file descriptor dirfd.
+    // The returned view is only valid until the next read.
+    // Throws std::system_error if the file can't be opened or read.
+    string_view read(const std::string& file, int dirfd = AT_FDCWD,
+                     size_t max_size = std::numeric_limits<size_t>::max());
+
+    size_t capacity() const { return _storage.size(); }
+
+private:
+    std::vector<char> _storage;
+};
+
+// Borrow a read buffer from a pool owned by the calling thread.
+// The buffer returns to the pool once the lease is destroyed, so consecutive
+// reads on the same thread reuse the same memory. Nested leases, e.g. when a
+// filter reads a file while another file is being parsed, get distinct
+// buffers, which keeps the readers reentrant.
+class read_buffer_lease
+{
+public:
+    read_buffer_lease();
+    ~read_buffer_lease();
+
+    read_buffer_lease(const read_buffer_lease&) = delete;
+    read_buffer_lease& operator=(const read_buffer_lease&) = delete;
+
+    read_buffer& operator*() const { return *_buffer; }
+    read_buffer* operator->() const { return _buffer.get(); }
+
+private:
+    std::unique_ptr<read_buffer> _buffer;
+};
+
 // Return a buffer containing the content of the specified file.
 // If the file is longer than 'max_size', only the first 'max_size' bytes are
 // read.
 // If requested to trim newline terminators, removes all of the from the
 // end of the string.
+// If the file is relative, then it is interpreted relative to the directory
+// referred to by the file descriptor dirfd.
 std::string readfile(const std::string& file, size_t max_size,
-                     bool trim_newline = true);
+                     bool trim_newline = true, int dirfd = AT_FDCWD);
 
 // Return a string containing the first line of the specified file.
 // The returned string doesn't contain the line terminator.
-std::string readline(const std::string& file);
+// If the file is relative, then it is interpreted relative to the directory
+// referred to by the file descriptor dirfd.
+std::string readline(const std::string& file, int dirfd = AT_FDCWD);
+
+// Read a file line by line.
+// The whole file is read at once into a leased 'read_buffer', and then split
+// into lines in place.
+// If the file is relative, then it is interpreted relative to the directory
+// referred to by the file descriptor dirfd.
+class line_reader
+{
+public:
+    // Throws std::system_error if the file can't be opened or read
+    line_reader(const std::string& file, int dirfd = AT_FDCWD);
+
+    line_reader(const line_reader&) = delete;
+    line_reader& operator=(const line_reader&) = delete;
+
+    // Get the next line, without the line terminator.
+    // Returns false once there are no more lines.
+    // The view is valid for as long as the reader lives.
+    bool next(string_view& line) { return _lines.next(line); }
+
+    // Same as above, but copies the line into 'line'. Reusing the same
+    // string for all the lines saves allocations.
+    bool next(std::string& line);
+
+private:
+    read_buffer_lease _buffer;
+    tokenizer _lines;
+};
 
 // Split a buffer into multiple parts.
+// Note: Allocates a string per token. Kept for API compatibility, the parsers
+// use 'tokenizer' and the fixed size 'split' overload instead.
 // The delimiters themselves are dropped.
 // If a token (the text between two consequent delimiters) is an empty string,
 // the decision whether to add it to the output or not is governed by the
@@ -149,6 +476,10 @@ std::vector<std::string> split_times(const std::string& buffer,
 std::pair<std::string, std::string> split_once(const std::string& buffer,
                                                char delim = ' ');
 
+// Same as above, but returns views into the original buffer.
+std::pair<string_view, string_view> split_once(string_view buffer,
+                                               char delim = ' ');
+
 // Remove all whitespace chars from the beginning of the string
 void ltrim(std::string& str);
 
@@ -158,20 +489,25 @@ void rtrim(std::string& str);
 // Remove all whitespace chars from both beginning and end of the string
 void trim(std::string& str);
 
+// Same as above, but shrink the view instead of modifying the string
+void ltrim(string_view& str);
+void rtrim(string_view& str);
+void trim(string_view& str);
+
 // Ensure directory path is terminated using a directory separator '/'
 void ensure_dir_terminator(std::string& dir_path);
 
 // Parse IPv4 address in the hex form (e.g. 0x7f000001) and return it as a ip struct
-ip parse_ipv4_address(const std::string& ip_address_hex);
+ip parse_ipv4_address(string_view ip_address_hex);
 
 // Parse IPv6 address in the hex form (e.g. 0x00000000000000000000000000000001) and return it as a ip struct
-ip parse_ipv6_address(const std::string& ip_address_hex);
+ip parse_ipv6_address(string_view ip_address_hex);
 
 // Figure out ip version (IPv4/IPv6), parse it and return it as a ip struct
-std::pair<ip, uint16_t> parse_address(const std::string& address_str);
+std::pair<ip, uint16_t> parse_address(string_view address_str);
 
 // Parses a memory size line (e.g. VmRSS:      4488 kB)
-void parse_memory_size(const std::string& desc, const std::string& value, uint64_t& out);
+void parse_memory_size(const std::string& desc, string_view value, uint64_t& out);
 
 } // namespace utils
 } // namespace impl
@@ -51,6 +51,8 @@ int main(int argc, char** argv)
                     "Enumerate all loaded modules that match the filter", tool_lsmod)},
             {command("netstat", "(tcp|udp) [task-id]...",
                     "Enumerate all sockets of said type for tasks", tool_netstat)},
+            {command("procmon", "[seconds]",
+                    "Print processes as they start and exit", tool_procmon)},
         };
         // clang-format on
 
@@ -19,5 +19,6 @@
 
 int tool_lsmod(std::vector<std::string>&& args);
 int tool_netstat(std::vector<std::string>&& args);
+int tool_procmon(std::vector<std::string>&& args);
 
 #endif // SAMPLE_TOOL_HPP
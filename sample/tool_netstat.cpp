@@ -23,17 +23,23 @@
 static const std::string TCP("tcp");
 static const std::string UDP("udp");
 
-void task_netstat(const pfs::task& task, const std::string& type)
+void task_netstat(const pfs::task& task, const std::string& type,
+                  const pfs::socket_owner_index& owners)
 {
     LOG("=========================================================");
     LOG("Netstat for task ID[" << task.id() << "]");
     LOG("=========================================================");
 
-    auto inodes = task.get_fds_inodes();
-    pfs::net::net_socket_filter filter = [&inodes](const pfs::net_socket& sock){
-        return inodes.find(sock.inode) != inodes.end()
-            ? pfs::filter::action::keep
-            : pfs::filter::action::drop;
+    int pid = task.id();
+    pfs::net::net_socket_filter filter = [&owners, pid](const pfs::net_socket& sock){
+        for (const auto& owner : owners.find(sock.inode))
+        {
+            if (owner.pid == pid)
+            {
+                return pfs::filter::action::keep;
+            }
+        }
+        return pfs::filter::action::drop;
     };
 
     auto net = task.get_net();
@@ -67,20 +73,23 @@ int tool_netstat(std::vector<std::string>&& args)
     {
         pfs::procfs pfs;
 
+        // Resolve the owners of all the sockets in a single pass
+        auto owners = pfs.get_socket_owners();
+
         if (args.size() > 1)
         {
             for (unsigned arg = 1; arg < args.size(); ++arg)
             {
                 auto id = std::stoi(args[arg]);
                 auto task = pfs.get_task(id);
-                task_netstat(task, type);
+                task_netstat(task, type, owners);
             }
         }
         else
         {
             for (auto& task : pfs.get_processes())
             {
-                task_netstat(task, type);
+                task_netstat(task, type, owners);
             }
         }
     }
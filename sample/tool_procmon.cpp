@@ -0,0 +1,108 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include <unistd.h>
+
+#include <chrono>
+
+#include "format.hpp"
+#include "log.hpp"
+#include "tool.hpp"
+
+#include "pfs/process_events.hpp"
+
+static const char* event_name(pfs::process_event::type what)
+{
+    switch (what)
+    {
+        case pfs::process_event::type::fork:
+            return "fork";
+        case pfs::process_event::type::exec:
+            return "exec";
+        case pfs::process_event::type::exit:
+            return "exit";
+        default:
+            return "unknown";
+    }
+}
+
+int tool_procmon(std::vector<std::string>&& args)
+{
+    try
+    {
+        LOG("=========================================================");
+        LOG("procmon");
+        LOG("=========================================================");
+
+        int seconds = 10;
+        if (!args.empty())
+        {
+            seconds = std::stoi(args[0]);
+        }
+
+        pfs::process_events events;
+        LOG("Tracking " << events.size() << " processes");
+
+        if (!events.subscribe())
+        {
+            LOG("Proc connector unavailable, falling back to rescanning");
+        }
+
+        auto print = [](const pfs::process_event& event) {
+            LOG(event_name(event.what)
+                << TAB << "pid[" << event.pid << "]"
+                << TAB << "parent[" << event.parent_pid << "]"
+                << TAB << "exit_code[" << event.exit_code << "]"
+                << (event.reconciled ? TAB "(reconciled)" : ""));
+        };
+
+        // Without events, rescan every second. With events, only reconcile
+        // once in a while, in case some were lost.
+        using clock = std::chrono::steady_clock;
+        const auto interval = std::chrono::seconds(
+            events.is_subscribed() ? 10 : 1);
+
+        auto now            = clock::now();
+        auto end            = now + std::chrono::seconds(seconds);
+        auto next_reconcile = now + interval;
+        while (now < end)
+        {
+            if (events.is_subscribed())
+            {
+                events.poll(1000, print);
+            }
+            else
+            {
+                sleep(1);
+            }
+
+            now = clock::now();
+            if (now >= next_reconcile)
+            {
+                events.reconcile(print);
+                next_reconcile = now + interval;
+            }
+        }
+    }
+    catch (const std::runtime_error& ex)
+    {
+        LOG("Error when monitoring processes:");
+        LOG(TAB << ex.what());
+    }
+
+    return 0;
+}
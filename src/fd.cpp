@@ -14,6 +14,7 @@
  *  limitations under the License.
  */
 
+#include <fcntl.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -26,8 +27,10 @@ namespace pfs {
 
 using namespace impl;
 
-fd::fd(const std::string& fds_root, int num)
-    : _num(num), _link(build_link_path(fds_root, num))
+fd::fd(const std::string& fds_root, int num,
+       std::shared_ptr<const int> pinned_dirfd)
+    : _num(num), _link(build_link_path(fds_root, num)),
+      _pinned_dirfd(std::move(pinned_dirfd))
 {}
 
 std::string fd::build_link_path(const std::string& fds_root, int num)
@@ -35,6 +38,17 @@ std::string fd::build_link_path(const std::string& fds_root, int num)
     return fds_root + std::to_string(num);
 }
 
+int fd::dirfd() const
+{
+    return _pinned_dirfd ? *_pinned_dirfd : AT_FDCWD;
+}
+
+std::string fd::link_path() const
+{
+    static const std::string FDS_DIR("fd/");
+    return _pinned_dirfd ? FDS_DIR + std::to_string(_num) : _link;
+}
+
 bool fd::operator<(const fd& rhs) const
 {
     return _num < rhs._num;
@@ -53,7 +67,7 @@ const std::string& fd::link() const
 struct stat fd::get_link_stat() const
 {
     struct stat st;
-    if (lstat(_link.c_str(), &st) != 0)
+    if (fstatat(dirfd(), link_path().c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0)
     {
         throw std::system_error(errno, std::system_category(),
                                 "Couldn't stat link");
@@ -64,13 +78,13 @@ struct stat fd::get_link_stat() const
 
 std::string fd::get_target() const
 {
-    return utils::readlink(_link);
+    return utils::readlink(link_path(), dirfd());
 }
 
 struct stat fd::get_target_stat() const
 {
     struct stat st;
-    if (stat(_link.c_str(), &st) != 0)
+    if (fstatat(dirfd(), link_path().c_str(), &st, 0) != 0)
     {
         throw std::system_error(errno, std::system_category(),
                                 "Couldn't stat target");
@@ -14,18 +14,190 @@
  *  limitations under the License.
  */
 
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <limits>
+#include <stdexcept>
 #include <system_error>
 
 #include "pfs/mem.hpp"
+#include "pfs/utils.hpp"
 
 namespace pfs {
 
-mem::mem(const std::string& path)
-    : _path(path), _fd(open(path.c_str(), O_RDONLY | O_CLOEXEC))
+using namespace impl;
+
+namespace {
+
+// The maximal number of iovecs a single call accepts (UIO_MAXIOV)
+static const size_t MAX_IOVECS = 1024;
+
+// Finds all the occurrences of multiple patterns in a single pass.
+// Every position is first checked against a bitmap of the leading byte pairs
+// of the patterns, and only the rare positions that pass are compared with
+// the patterns themselves. The cost is then nearly independent of the number
+// of patterns, as opposed to searching for every pattern separately.
+class pattern_matcher
+{
+public:
+    explicit pattern_matcher(const std::vector<std::string>& patterns)
+        : _patterns(patterns), _longest(0)
+    {
+        _pairs.fill(0);
+        _singles.fill(false);
+
+        for (const auto& pattern : _patterns)
+        {
+            if (pattern.empty())
+            {
+                throw std::invalid_argument("Empty pattern");
+            }
+            _longest = std::max(_longest, pattern.size());
+
+            auto first = static_cast<uint8_t>(pattern[0]);
+            if (pattern.size() == 1)
+            {
+                _singles[first] = true;
+                continue;
+            }
+
+            auto pair = make_pair(first, static_cast<uint8_t>(pattern[1]));
+            _pairs[pair / BITS] |= uint64_t(1) << (pair % BITS);
+        }
+    }
+
+    size_t longest() const { return _longest; }
+
+    // Call 'handle' with the offset and index of every match that ends past
+    // 'skip', i.e. that doesn't lie entirely in the first 'skip' bytes
+    template <typename Handler>
+    void find(const uint8_t* data, size_t size, size_t skip,
+              Handler handle) const
+    {
+        // The first offset where a match might end past 'skip'
+        size_t first = skip >= _longest ? skip - _longest + 1 : 0;
+
+        for (size_t offset = first; offset < size; ++offset)
+        {
+            uint8_t current = data[offset];
+            bool candidate  = _singles[current];
+            if (!candidate && offset + 1 < size)
+            {
+                auto pair = make_pair(current, data[offset + 1]);
+                candidate = (_pairs[pair / BITS] >> (pair % BITS)) & 1;
+            }
+
+            if (!candidate)
+            {
+                continue;
+            }
+
+            for (size_t index = 0; index < _patterns.size(); ++index)
+            {
+                const auto& pattern = _patterns[index];
+                if (offset + pattern.size() <= size &&
+                    offset + pattern.size() > skip &&
+                    memcmp(data + offset, pattern.data(), pattern.size()) == 0)
+                {
+                    handle(offset, index);
+                }
+            }
+        }
+    }
+
+private:
+    static const size_t BITS = 64;
+
+    static size_t make_pair(uint8_t first, uint8_t second)
+    {
+        return (static_cast<size_t>(first) << 8) | second;
+    }
+
+    const std::vector<std::string>& _patterns;
+    size_t _longest;
+    std::array<uint64_t, 65536 / BITS> _pairs;
+    std::array<bool, 256> _singles;
+};
+
+// The region is read in chunks. Every chunk starts with the last bytes of the
+// previous one, one byte less than the longest pattern, so a match is found
+// in the first chunk that contains its last byte, and is reported once.
+// Returns false if the address space of the task is gone, e.g. because it
+// exited, in which case every later read would come up empty as well.
+bool scan_region(int fd, const mem_region& region,
+                 const pattern_matcher& matcher, std::vector<uint8_t>& buffer,
+                 std::vector<mem::scan_match>& out)
+{
+    // Addresses that don't fit the file offset, e.g. [vsyscall], can't be
+    // read through the mem file
+    static const uint64_t MAX_ADDRESS =
+        static_cast<uint64_t>(std::numeric_limits<loff_t>::max());
+
+    if (!region.perm.can_read || region.end_address > MAX_ADDRESS)
+    {
+        return true;
+    }
+
+    const size_t overlap   = matcher.longest() - 1;
+    const size_t page_size = pagemap::page_size();
+
+    uint64_t address = region.start_address;
+    size_t carry     = 0; // Bytes kept from the previous chunk
+    while (address < region.end_address)
+    {
+        size_t wanted = static_cast<size_t>(
+            std::min<uint64_t>(buffer.size() - carry,
+                               region.end_address - address));
+
+        ssize_t bytes = pread(fd, buffer.data() + carry, wanted,
+                              static_cast<loff_t>(address));
+        if (bytes == -1 && errno != EIO)
+        {
+            throw std::system_error(errno, std::system_category(),
+                                    "Couldn't read from memory");
+        }
+
+        if (bytes == 0)
+        {
+            return false;
+        }
+
+        if (bytes < 0)
+        {
+            // An unreadable page, skip it, and start over after it
+            address = (address / page_size + 1) * page_size;
+            carry   = 0;
+            continue;
+        }
+
+        size_t size   = carry + static_cast<size_t>(bytes);
+        uint64_t base = address - carry;
+        // Matches that end in the carried bytes were already reported
+        matcher.find(buffer.data(), size, carry,
+                     [&out, base](size_t offset, size_t index) {
+                         out.push_back({base + offset, index});
+                     });
+
+        address += static_cast<uint64_t>(bytes);
+
+        carry = std::min(overlap, size);
+        memmove(buffer.data(), buffer.data() + size - carry, carry);
+    }
+
+    return true;
+}
+
+} // anonymous namespace
+
+mem::mem(const std::string& path, int dirfd, pid_t pid)
+    : _path(path), _fd(openat(dirfd, path.c_str(), O_RDONLY | O_CLOEXEC)),
+      _pid(pid)
 {
     if (_fd < 0)
     {
@@ -35,7 +207,7 @@ mem::mem(const std::string& path)
 }
 
 mem::mem(mem&& other) noexcept
-    : _path(std::move(other._path)), _fd(other._fd)
+    : _path(std::move(other._path)), _fd(other._fd), _pid(other._pid)
 {
     other._fd = -1;
 }
@@ -71,4 +243,264 @@ std::vector<uint8_t> mem::read(loff_t offset, size_t bytes)
     return buffer;
 }
 
+std::vector<size_t> mem::read_batch(const std::vector<read_request>& requests)
+{
+    std::vector<size_t> bytes_read(requests.size(), 0);
+
+    size_t done = 0;
+    if (_pid != INVALID_PID)
+    {
+        done = read_batch_vm(requests, bytes_read);
+    }
+
+    // Either there's no pid to use, or process_vm_readv isn't available
+    read_batch_file(requests, done, requests.size(), bytes_read);
+
+    return bytes_read;
+}
+
+std::vector<mem::mem_chunk> mem::read_sparse(const mem_region& region,
+                                             pagemap& pages,
+                                             bool include_swapped)
+{
+    const uint64_t page_size = pagemap::page_size();
+
+    // Find the runs of pages that hold data
+    std::vector<mem_chunk> chunks;
+    uint64_t run_start = 0;
+    uint64_t run_end   = 0;
+
+    // Regions are page aligned, but don't count on that
+    auto add_run = [&] {
+        auto start = std::max(run_start, region.start_address);
+        auto end   = std::min(run_end, region.end_address);
+        if (end > start)
+        {
+            chunks.push_back({start, std::vector<uint8_t>()});
+            chunks.back().data.resize(end - start);
+        }
+    };
+
+    pages.for_each(
+        region.start_address, region.end_address,
+        [&](uint64_t address, const pagemap_entry* entries, size_t count) {
+            for (size_t i = 0; i < count; ++i, address += page_size)
+            {
+                const auto& entry = entries[i];
+                if (!entry.is_present() &&
+                    !(include_swapped && entry.is_swapped()))
+                {
+                    continue;
+                }
+
+                if (address != run_end)
+                {
+                    add_run();
+                    run_start = address;
+                }
+                run_end = address + page_size;
+            }
+        });
+    add_run();
+
+    std::vector<read_request> requests;
+    requests.reserve(chunks.size());
+    for (auto& chunk : chunks)
+    {
+        requests.push_back({chunk.address, chunk.data.data(), chunk.data.size()});
+    }
+
+    // Pages might have been unmapped since the pagemap was read
+    auto bytes_read = read_batch(requests);
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        chunks[i].data.resize(bytes_read[i]);
+    }
+
+    chunks.erase(std::remove_if(chunks.begin(), chunks.end(),
+                                [](const mem_chunk& chunk) {
+                                    return chunk.data.empty();
+                                }),
+                 chunks.end());
+
+    return chunks;
+}
+
+std::vector<mem::scan_match>
+mem::scan(const std::vector<mem_region>& regions,
+          const std::vector<std::string>& patterns, size_t threads,
+          size_t buffer_size)
+{
+    pattern_matcher matcher(patterns);
+    if (patterns.empty())
+    {
+        return {};
+    }
+
+    // A chunk must fit the overlap with the previous chunk, and new data
+    buffer_size = std::max(buffer_size, 2 * matcher.longest());
+
+    std::vector<std::vector<scan_match>> matches(regions.size());
+    if (threads <= 1)
+    {
+        std::vector<uint8_t> buffer(buffer_size);
+        for (size_t i = 0; i < regions.size(); ++i)
+        {
+            if (!scan_region(_fd, regions[i], matcher, buffer, matches[i]))
+            {
+                break;
+            }
+        }
+    }
+    else
+    {
+        std::atomic<bool> gone(false);
+        utils::parallel_for(regions.size(), threads, [&](size_t i) {
+            if (gone.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+
+            std::vector<uint8_t> buffer(buffer_size);
+            if (!scan_region(_fd, regions[i], matcher, buffer, matches[i]))
+            {
+                gone.store(true, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    std::vector<scan_match> out;
+    for (auto& region_matches : matches)
+    {
+        out.insert(out.end(), region_matches.begin(), region_matches.end());
+    }
+
+    std::sort(out.begin(), out.end(),
+              [](const scan_match& lhs, const scan_match& rhs) {
+                  return lhs.address != rhs.address ? lhs.address < rhs.address
+                                                    : lhs.pattern < rhs.pattern;
+              });
+    return out;
+}
+
+// Returns the number of items handled before process_vm_readv turned out to
+// be unavailable, e.g. blocked by seccomp, which is all of them otherwise.
+size_t mem::read_batch_vm(const std::vector<read_request>& requests,
+                          std::vector<size_t>& bytes_read)
+{
+    std::vector<struct iovec> local;
+    std::vector<struct iovec> remote;
+    local.reserve(std::min(requests.size(), MAX_IOVECS));
+    remote.reserve(std::min(requests.size(), MAX_IOVECS));
+
+    size_t first = 0;
+    while (first < requests.size())
+    {
+        local.clear();
+        remote.clear();
+        for (size_t i = first; i < requests.size() && local.size() < MAX_IOVECS;
+             ++i)
+        {
+            const auto& request = requests[i];
+            local.push_back({request.buffer, request.length});
+            remote.push_back({reinterpret_cast<void*>(request.address),
+                              request.length});
+        }
+        size_t last = first + local.size();
+
+        ssize_t bytes = process_vm_readv(_pid, local.data(), local.size(),
+                                         remote.data(), remote.size(), 0);
+        if (bytes == -1)
+        {
+            if (errno == ENOSYS || errno == EPERM)
+            {
+                return first;
+            }
+
+            if (errno != EFAULT)
+            {
+                throw std::system_error(errno, std::system_category(),
+                                        "Couldn't read from memory");
+            }
+
+            // The first item starts in an unmapped hole
+            bytes = 0;
+        }
+
+        // Transfers stop at the first item that can't be read as a whole
+        size_t left = static_cast<size_t>(bytes);
+        size_t i    = first;
+        for (; i < last && left >= requests[i].length; ++i)
+        {
+            bytes_read[i] = requests[i].length;
+            left -= requests[i].length;
+        }
+
+        if (i < last)
+        {
+            // Read whatever precedes the hole
+            read_batch_file(requests, i, i + 1, bytes_read);
+            ++i;
+        }
+
+        first = i;
+    }
+
+    return first;
+}
+
+// Items that are adjacent in the target are read using a single preadv call
+void mem::read_batch_file(const std::vector<read_request>& requests,
+                          size_t first, size_t last,
+                          std::vector<size_t>& bytes_read)
+{
+    std::vector<struct iovec> iovs;
+
+    while (first < last)
+    {
+        iovs.clear();
+        uint64_t next = requests[first].address;
+        size_t end    = first;
+        for (; end < last && iovs.size() < MAX_IOVECS &&
+               requests[end].address == next;
+             ++end)
+        {
+            iovs.push_back({requests[end].buffer, requests[end].length});
+            next += requests[end].length;
+        }
+
+        ssize_t bytes = preadv(_fd, iovs.data(), iovs.size(),
+                               static_cast<loff_t>(requests[first].address));
+        if (bytes == -1)
+        {
+            if (errno != EIO)
+            {
+                throw std::system_error(errno, std::system_category(),
+                                        "Couldn't read from memory");
+            }
+
+            // The first item starts in an unmapped hole
+            bytes = 0;
+        }
+
+        size_t left = static_cast<size_t>(bytes);
+        size_t i    = first;
+        for (; i < end; ++i)
+        {
+            size_t chunk  = std::min(left, requests[i].length);
+            bytes_read[i] = chunk;
+            left -= chunk;
+
+            if (chunk < requests[i].length)
+            {
+                // Stopped at a hole, skip to the next item
+                ++i;
+                break;
+            }
+        }
+
+        first = i;
+    }
+}
+
 } // namespace pfs
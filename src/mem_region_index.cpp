@@ -0,0 +1,88 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "pfs/mem_region_index.hpp"
+#include "pfs/parsers/maps.hpp"
+#include "pfs/utils.hpp"
+
+namespace pfs {
+
+using namespace impl;
+
+mem_region_index::mem_region_index(std::vector<mem_region> regions)
+    : _regions(std::move(regions))
+{
+    build();
+}
+
+const mem_region* mem_region_index::find(uint64_t address) const
+{
+    // The last region that starts at or before the address
+    auto iter = std::upper_bound(_starts.begin(), _starts.end(), address);
+    if (iter == _starts.begin())
+    {
+        return nullptr;
+    }
+
+    const auto& region = _regions[(iter - _starts.begin()) - 1];
+    return address < region.end_address ? &region : nullptr;
+}
+
+bool mem_region_index::update(string_view maps, string_pool* pool)
+{
+    if (!_maps.empty() && _maps == maps)
+    {
+        return false;
+    }
+
+    std::vector<mem_region> regions;
+
+    utils::tokenizer lines(maps, '\n');
+
+    // Reused for all the lines, to avoid allocating per line
+    std::string line;
+    string_view raw;
+    while (lines.next(raw))
+    {
+        line.assign(raw.data(), raw.size());
+        regions.push_back(parsers::parse_maps_line(line, pool));
+    }
+
+    _regions = std::move(regions);
+    _maps.assign(maps.data(), maps.size());
+    build();
+    return true;
+}
+
+void mem_region_index::build()
+{
+    // The kernel lists the regions in order, but don't count on that
+    if (!std::is_sorted(_regions.begin(), _regions.end()))
+    {
+        std::sort(_regions.begin(), _regions.end());
+    }
+
+    _starts.clear();
+    _starts.reserve(_regions.size());
+    for (const auto& region : _regions)
+    {
+        _starts.push_back(region.start_address);
+    }
+}
+
+} // namespace pfs
@@ -14,7 +14,14 @@
  *  limitations under the License.
  */
 
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
 #include "pfs/net.hpp"
+#include "pfs/procfs.hpp"
+#include "pfs/sock_diag.hpp"
 #include "pfs/parsers/net_route.hpp"
 #include "pfs/parsers/net_arp.hpp"
 #include "pfs/parsers/net_device.hpp"
@@ -27,157 +34,444 @@ namespace pfs {
 
 using namespace impl;
 
-net::net(const std::string& parent_root)
-    : _parent_root(parent_root), _net_root(build_net_root(parent_root))
+// The protocol of socket files that sock_diag can't dump
+static const int NO_SOCK_DIAG = 0;
+
+net::net(const std::string& parent_root,
+         std::shared_ptr<const int> pinned_dirfd)
+    : _parent_root(parent_root), _net_root(build_net_root(parent_root)),
+      _pinned_dirfd(std::move(pinned_dirfd)),
+      _socket_backend(socket_backend::procfs)
 {}
 
+void net::set_socket_backend(socket_backend backend)
+{
+    _socket_backend = backend;
+}
+
+net::socket_backend net::get_socket_backend() const
+{
+    return _socket_backend;
+}
+
 std::string net::build_net_root(const std::string& parent_root)
 {
     static const std::string NET_DIR("net/");
     return parent_root + NET_DIR;
 }
 
+int net::dirfd() const
+{
+    return _pinned_dirfd ? *_pinned_dirfd : AT_FDCWD;
+}
+
+std::string net::file_path(const std::string& file) const
+{
+    static const std::string NET_DIR("net/");
+    return _pinned_dirfd ? NET_DIR + file : _net_root + file;
+}
+
 std::vector<net_device> net::get_dev(net_device_filter filter) const
 {
     static const std::string DEV_FILE("dev");
-    auto path = _net_root + DEV_FILE;
+    auto path = file_path(DEV_FILE);
 
     static const size_t HEADER_LINES = 2; // /proc/net/dev has two header rows: title + column names
 
     std::vector<net_device> output;
     parsers::parse_file_lines(path, std::back_inserter(output),
 		                      parsers::parse_net_device_line,
-                              filter, HEADER_LINES);
+                              filter, HEADER_LINES, dirfd());
     return output;
 }
 
-std::vector<net_socket> net::get_icmp(net_socket_filter filter) const
+std::vector<net_socket> net::get_icmp(net_socket_filter filter,
+        net_socket_line_filter line_filter) const
+{
+    static const socket_source ICMP_SOCKETS{"icmp", AF_INET, NO_SOCK_DIAG};
+    return get_net_sockets(ICMP_SOCKETS, net_socket_query(), filter,
+                           line_filter);
+}
+
+std::vector<net_socket> net::get_icmp6(net_socket_filter filter,
+        net_socket_line_filter line_filter) const
+{
+    static const socket_source ICMP6_SOCKETS{"icmp6", AF_INET6, NO_SOCK_DIAG};
+    return get_net_sockets(ICMP6_SOCKETS, net_socket_query(), filter,
+                           line_filter);
+}
+
+std::vector<net_socket> net::get_raw(net_socket_filter filter,
+        net_socket_line_filter line_filter) const
+{
+    static const socket_source RAW_SOCKETS{"raw", AF_INET, NO_SOCK_DIAG};
+    return get_net_sockets(RAW_SOCKETS, net_socket_query(), filter,
+                           line_filter);
+}
+
+std::vector<net_socket> net::get_raw6(net_socket_filter filter,
+        net_socket_line_filter line_filter) const
+{
+    static const socket_source RAW6_SOCKETS{"raw6", AF_INET6, NO_SOCK_DIAG};
+    return get_net_sockets(RAW6_SOCKETS, net_socket_query(), filter,
+                           line_filter);
+}
+
+std::vector<net_socket> net::get_tcp(net_socket_filter filter,
+        net_socket_line_filter line_filter) const
+{
+    static const socket_source TCP_SOCKETS{"tcp", AF_INET, IPPROTO_TCP};
+    return get_net_sockets(TCP_SOCKETS, net_socket_query(), filter,
+                           line_filter);
+}
+
+std::vector<net_socket> net::get_tcp6(net_socket_filter filter,
+        net_socket_line_filter line_filter) const
+{
+    static const socket_source TCP6_SOCKETS{"tcp6", AF_INET6, IPPROTO_TCP};
+    return get_net_sockets(TCP6_SOCKETS, net_socket_query(), filter,
+                           line_filter);
+}
+
+std::vector<net_socket> net::get_udp(net_socket_filter filter,
+        net_socket_line_filter line_filter) const
+{
+    static const socket_source UDP_SOCKETS{"udp", AF_INET, IPPROTO_UDP};
+    return get_net_sockets(UDP_SOCKETS, net_socket_query(), filter,
+                           line_filter);
+}
+
+std::vector<net_socket> net::get_udp6(net_socket_filter filter,
+        net_socket_line_filter line_filter) const
+{
+    static const socket_source UDP6_SOCKETS{"udp6", AF_INET6, IPPROTO_UDP};
+    return get_net_sockets(UDP6_SOCKETS, net_socket_query(), filter,
+                           line_filter);
+}
+
+std::vector<net_socket> net::get_udplite(net_socket_filter filter,
+        net_socket_line_filter line_filter) const
+{
+    static const socket_source UDPLITE_SOCKETS{"udplite", AF_INET,
+                                               IPPROTO_UDPLITE};
+    return get_net_sockets(UDPLITE_SOCKETS, net_socket_query(), filter,
+                           line_filter);
+}
+
+std::vector<net_socket> net::get_udplite6(net_socket_filter filter,
+        net_socket_line_filter line_filter) const
 {
-    static const std::string ICMP_FILE("icmp");
-    return get_net_sockets(ICMP_FILE, filter);
+    static const socket_source UDPLITE6_SOCKETS{"udplite6", AF_INET6,
+                                                IPPROTO_UDPLITE};
+    return get_net_sockets(UDPLITE6_SOCKETS, net_socket_query(), filter,
+                           line_filter);
 }
 
-std::vector<net_socket> net::get_icmp6(net_socket_filter filter) const
+std::vector<net_socket> net::get_icmp(const net_socket_query& query,
+        net_socket_filter filter) const
 {
-    static const std::string ICMP6_FILE("icmp6");
-    return get_net_sockets(ICMP6_FILE, filter);
+    static const socket_source ICMP_SOCKETS{"icmp", AF_INET, NO_SOCK_DIAG};
+    return get_net_sockets(ICMP_SOCKETS, query, filter, nullptr);
 }
 
-std::vector<net_socket> net::get_raw(net_socket_filter filter) const
+std::vector<net_socket> net::get_icmp6(const net_socket_query& query,
+        net_socket_filter filter) const
 {
-    static const std::string RAW_FILE("raw");
-    return get_net_sockets(RAW_FILE, filter);
+    static const socket_source ICMP6_SOCKETS{"icmp6", AF_INET6, NO_SOCK_DIAG};
+    return get_net_sockets(ICMP6_SOCKETS, query, filter, nullptr);
 }
 
-std::vector<net_socket> net::get_raw6(net_socket_filter filter) const
+std::vector<net_socket> net::get_raw(const net_socket_query& query,
+        net_socket_filter filter) const
+{
+    static const socket_source RAW_SOCKETS{"raw", AF_INET, NO_SOCK_DIAG};
+    return get_net_sockets(RAW_SOCKETS, query, filter, nullptr);
+}
+
+std::vector<net_socket> net::get_raw6(const net_socket_query& query,
+        net_socket_filter filter) const
 {
-    static const std::string RAW6_FILE("raw6");
-    return get_net_sockets(RAW6_FILE, filter);
+    static const socket_source RAW6_SOCKETS{"raw6", AF_INET6, NO_SOCK_DIAG};
+    return get_net_sockets(RAW6_SOCKETS, query, filter, nullptr);
 }
 
-std::vector<net_socket> net::get_tcp(net_socket_filter filter) const
+std::vector<net_socket> net::get_tcp(const net_socket_query& query,
+        net_socket_filter filter) const
 {
-    static const std::string TCP_FILE("tcp");
-    return get_net_sockets(TCP_FILE, filter);
+    static const socket_source TCP_SOCKETS{"tcp", AF_INET, IPPROTO_TCP};
+    return get_net_sockets(TCP_SOCKETS, query, filter, nullptr);
 }
 
-std::vector<net_socket> net::get_tcp6(net_socket_filter filter) const
+std::vector<net_socket> net::get_tcp6(const net_socket_query& query,
+        net_socket_filter filter) const
 {
-    static const std::string TCP6_FILE("tcp6");
-    return get_net_sockets(TCP6_FILE, filter);
+    static const socket_source TCP6_SOCKETS{"tcp6", AF_INET6, IPPROTO_TCP};
+    return get_net_sockets(TCP6_SOCKETS, query, filter, nullptr);
 }
 
-std::vector<net_socket> net::get_udp(net_socket_filter filter) const
+std::vector<net_socket> net::get_udp(const net_socket_query& query,
+        net_socket_filter filter) const
 {
-    static const std::string UDP_FILE("udp");
-    return get_net_sockets(UDP_FILE, filter);
+    static const socket_source UDP_SOCKETS{"udp", AF_INET, IPPROTO_UDP};
+    return get_net_sockets(UDP_SOCKETS, query, filter, nullptr);
 }
 
-std::vector<net_socket> net::get_udp6(net_socket_filter filter) const
+std::vector<net_socket> net::get_udp6(const net_socket_query& query,
+        net_socket_filter filter) const
 {
-    static const std::string UDP6_FILE("udp6");
-    return get_net_sockets(UDP6_FILE, filter);
+    static const socket_source UDP6_SOCKETS{"udp6", AF_INET6, IPPROTO_UDP};
+    return get_net_sockets(UDP6_SOCKETS, query, filter, nullptr);
 }
 
-std::vector<net_socket> net::get_udplite(net_socket_filter filter) const
+std::vector<net_socket> net::get_udplite(const net_socket_query& query,
+        net_socket_filter filter) const
 {
-    static const std::string UDPLITE_FILE("udplite");
-    return get_net_sockets(UDPLITE_FILE, filter);
+    static const socket_source UDPLITE_SOCKETS{"udplite", AF_INET,
+                                               IPPROTO_UDPLITE};
+    return get_net_sockets(UDPLITE_SOCKETS, query, filter, nullptr);
 }
 
-std::vector<net_socket> net::get_udplite6(net_socket_filter filter) const
+std::vector<net_socket> net::get_udplite6(const net_socket_query& query,
+        net_socket_filter filter) const
 {
-    static const std::string UDPLITE6_FILE("udplite6");
-    return get_net_sockets(UDPLITE6_FILE, filter);
+    static const socket_source UDPLITE6_SOCKETS{"udplite6", AF_INET6,
+                                                IPPROTO_UDPLITE};
+    return get_net_sockets(UDPLITE6_SOCKETS, query, filter, nullptr);
 }
 
 std::vector<netlink_socket> net::get_netlink(netlink_socket_filter filter) const
 {
     static const std::string NETLINK_FILE("netlink");
-    auto path = _net_root + NETLINK_FILE;
+    auto path = file_path(NETLINK_FILE);
 
     static const size_t HEADER_LINES = 1;
 
     std::vector<netlink_socket> output;
     parsers::parse_file_lines(path, std::back_inserter(output),
                               parsers::parse_netlink_socket_line,
-                              filter, HEADER_LINES);
+                              filter, HEADER_LINES, dirfd());
     return output;
 }
 
 std::vector<unix_socket> net::get_unix(unix_socket_filter filter) const
 {
     static const std::string UNIX_FILE("unix");
-    auto path = _net_root + UNIX_FILE;
+    auto path = file_path(UNIX_FILE);
 
     static const size_t HEADER_LINES = 1;
 
     std::vector<unix_socket> output;
     parsers::parse_file_lines(path, std::back_inserter(output),
                               parsers::parse_unix_socket_line,
-                              filter, HEADER_LINES);
+                              filter, HEADER_LINES, dirfd());
     return output;
 }
 
-std::vector<net_socket> net::get_net_sockets(const std::string& file,
-        net_socket_filter filter) const
+std::vector<net_socket> net::get_net_sockets(const socket_source& source,
+        const net_socket_query& query, net_socket_filter filter,
+        net_socket_line_filter line_filter) const
 {
-    auto path = _net_root + file;
+    std::vector<net_socket> output;
+
+    if (!line_filter && use_sock_diag(source))
+    {
+        auto collect = [&output, &filter](const net_socket& sock) {
+            auto act = filter ? filter(sock) : filter::action::keep;
+            if (filter::is_kept(act))
+            {
+                output.push_back(sock);
+            }
+            return !filter::is_last(act);
+        };
+
+        if (sock_diag::query_sockets(source.family, source.protocol, query,
+                                     collect))
+        {
+            return output;
+        }
+    }
+
+    if (query.states != 0 || query.local_port != 0)
+    {
+        // Only the query overloads get here, and they take no line filter
+        line_filter = [&query](string_view line) {
+            bool matches =
+                query.matches_state(parsers::parse_net_socket_state(line)) &&
+                query.matches_port(parsers::parse_net_socket_local_port(line));
+            return matches ? filter::action::keep : filter::action::drop;
+        };
+    }
+
+    auto path = file_path(source.file);
 
     static const size_t HEADER_LINES = 1;
 
-    std::vector<net_socket> output;
     parsers::parse_file_lines(path, std::back_inserter(output),
                               parsers::parse_net_socket_line,
-                              filter, HEADER_LINES);
+                              filter, HEADER_LINES, dirfd(), line_filter);
     return output;
 }
 
+bool net::use_sock_diag(const socket_source& source) const
+{
+    if (_socket_backend != socket_backend::netlink ||
+        source.protocol == NO_SOCK_DIAG)
+    {
+        return false;
+    }
+
+    // sock_diag only reports the sockets of the caller's network namespace
+    static const std::string NS_NET_FILE("ns/net");
+    static const std::string SELF_NS_NET_FILE("self/ns/net");
+
+    auto own_path = _pinned_dirfd ? NS_NET_FILE : _parent_root + NS_NET_FILE;
+
+    struct stat own;
+    struct stat self;
+    if (fstatat(dirfd(), own_path.c_str(), &own, 0) != 0 ||
+        stat((procfs::DEFAULT_ROOT + SELF_NS_NET_FILE).c_str(), &self) != 0)
+    {
+        return false;
+    }
+
+    return own.st_dev == self.st_dev && own.st_ino == self.st_ino;
+}
+
+net_socket::net_state net::peek_state(string_view line)
+{
+    return parsers::parse_net_socket_state(line);
+}
+
+uint16_t net::peek_local_port(string_view line)
+{
+    return parsers::parse_net_socket_local_port(line);
+}
+
+void net::for_each_icmp(net_socket_visitor visitor) const
+{
+    static const socket_source ICMP_SOCKETS{"icmp", AF_INET, NO_SOCK_DIAG};
+    for_each_net_socket(ICMP_SOCKETS, visitor);
+}
+
+void net::for_each_icmp6(net_socket_visitor visitor) const
+{
+    static const socket_source ICMP6_SOCKETS{"icmp6", AF_INET6, NO_SOCK_DIAG};
+    for_each_net_socket(ICMP6_SOCKETS, visitor);
+}
+
+void net::for_each_raw(net_socket_visitor visitor) const
+{
+    static const socket_source RAW_SOCKETS{"raw", AF_INET, NO_SOCK_DIAG};
+    for_each_net_socket(RAW_SOCKETS, visitor);
+}
+
+void net::for_each_raw6(net_socket_visitor visitor) const
+{
+    static const socket_source RAW6_SOCKETS{"raw6", AF_INET6, NO_SOCK_DIAG};
+    for_each_net_socket(RAW6_SOCKETS, visitor);
+}
+
+void net::for_each_tcp(net_socket_visitor visitor) const
+{
+    static const socket_source TCP_SOCKETS{"tcp", AF_INET, IPPROTO_TCP};
+    for_each_net_socket(TCP_SOCKETS, visitor);
+}
+
+void net::for_each_tcp6(net_socket_visitor visitor) const
+{
+    static const socket_source TCP6_SOCKETS{"tcp6", AF_INET6, IPPROTO_TCP};
+    for_each_net_socket(TCP6_SOCKETS, visitor);
+}
+
+void net::for_each_udp(net_socket_visitor visitor) const
+{
+    static const socket_source UDP_SOCKETS{"udp", AF_INET, IPPROTO_UDP};
+    for_each_net_socket(UDP_SOCKETS, visitor);
+}
+
+void net::for_each_udp6(net_socket_visitor visitor) const
+{
+    static const socket_source UDP6_SOCKETS{"udp6", AF_INET6, IPPROTO_UDP};
+    for_each_net_socket(UDP6_SOCKETS, visitor);
+}
+
+void net::for_each_udplite(net_socket_visitor visitor) const
+{
+    static const socket_source UDPLITE_SOCKETS{"udplite", AF_INET,
+                                               IPPROTO_UDPLITE};
+    for_each_net_socket(UDPLITE_SOCKETS, visitor);
+}
+
+void net::for_each_udplite6(net_socket_visitor visitor) const
+{
+    static const socket_source UDPLITE6_SOCKETS{"udplite6", AF_INET6,
+                                                IPPROTO_UDPLITE};
+    for_each_net_socket(UDPLITE6_SOCKETS, visitor);
+}
+
+void net::for_each_unix(unix_socket_visitor visitor) const
+{
+    static const std::string UNIX_FILE("unix");
+    auto path = file_path(UNIX_FILE);
+
+    static const size_t HEADER_LINES = 1;
+
+    unix_socket sock;
+    parsers::parse_file_lines(path, sock, parsers::parse_unix_socket_line_into,
+                              visitor, HEADER_LINES, dirfd());
+}
+
+void net::for_each_net_socket(const socket_source& source,
+                              net_socket_visitor visitor) const
+{
+    if (use_sock_diag(source))
+    {
+        auto visit = [&visitor](const net_socket& sock) {
+            visitor(sock);
+            return true;
+        };
+
+        if (sock_diag::query_sockets(source.family, source.protocol,
+                                     net_socket_query(), visit))
+        {
+            return;
+        }
+    }
+
+    auto path = file_path(source.file);
+
+    static const size_t HEADER_LINES = 1;
+
+    net_socket sock;
+    parsers::parse_file_lines(path, sock, parsers::parse_net_socket_line_into,
+                              visitor, HEADER_LINES, dirfd());
+}
+
 std::vector<net_route> net::get_route(net_route_filter filter) const
 {
     static const std::string ROUTES_FILE("route");
-    auto path = _net_root + ROUTES_FILE;
+    auto path = file_path(ROUTES_FILE);
 
     static const size_t HEADER_LINES = 1;
 
     std::vector<net_route> output;
     parsers::parse_file_lines(path, std::back_inserter(output),
                               parsers::parse_net_route_line,
-                              filter, HEADER_LINES);
+                              filter, HEADER_LINES, dirfd());
     return output;
 }
 
 std::vector<net_arp> net::get_arp(net_arp_filter filter) const
 {
     static const std::string ARP_FILE("arp");
-    auto path = _net_root + ARP_FILE;
+    auto path = file_path(ARP_FILE);
 
     static const size_t HEADER_LINES = 1;
 
     std::vector<net_arp> output;
     parsers::parse_file_lines(path, std::back_inserter(output),
                               parsers::parse_net_arp_line,
-                              filter, HEADER_LINES);
+                              filter, HEADER_LINES, dirfd());
     return output;
 }
 
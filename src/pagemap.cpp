@@ -0,0 +1,151 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <system_error>
+
+#include "pfs/pagemap.hpp"
+
+namespace pfs {
+
+namespace {
+
+static_assert(sizeof(pagemap_entry) == sizeof(pagemap_entry::raw_type),
+              "pagemap entries are read directly into pagemap_entry");
+
+// The number of entries read at once by 'for_each', i.e. 32KiB of pagemap
+static const size_t CHUNK_ENTRIES = 4096;
+
+} // anonymous namespace
+
+pagemap::pagemap(const std::string& path, int dirfd)
+    : _path(path), _fd(openat(dirfd, path.c_str(), O_RDONLY | O_CLOEXEC))
+{
+    if (_fd < 0)
+    {
+        throw std::system_error(errno, std::system_category(),
+                                "Couldn't open file");
+    }
+}
+
+pagemap::pagemap(pagemap&& other) noexcept
+    : _path(std::move(other._path)), _fd(other._fd)
+{
+    other._fd = -1;
+}
+
+pagemap::~pagemap()
+{
+    if (_fd >= 0)
+    {
+        close(_fd);
+    }
+}
+
+size_t pagemap::page_size()
+{
+    static const size_t PAGE_SIZE = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return PAGE_SIZE;
+}
+
+std::vector<pagemap_entry> pagemap::read(uint64_t address, size_t count)
+{
+    std::vector<pagemap_entry> entries(count);
+    entries.resize(read(address / page_size(), entries.data(), count));
+    return entries;
+}
+
+std::vector<pagemap_entry> pagemap::read(const mem_region& region)
+{
+    auto first = region.start_address / page_size();
+    auto last  = (region.end_address + page_size() - 1) / page_size();
+
+    return read(region.start_address, last - first);
+}
+
+void pagemap::for_each(uint64_t start, uint64_t end, const visitor& handle)
+{
+    std::vector<pagemap_entry> entries(CHUNK_ENTRIES);
+
+    auto page = start / page_size();
+    auto last = (end + page_size() - 1) / page_size();
+    while (page < last)
+    {
+        size_t count = static_cast<size_t>(
+            std::min<uint64_t>(last - page, entries.size()));
+
+        size_t entries_read = read(page, entries.data(), count);
+        if (entries_read == 0)
+        {
+            break;
+        }
+
+        handle(page * page_size(), entries.data(), entries_read);
+        page += entries_read;
+    }
+}
+
+pagemap_summary pagemap::summarize(const mem_region& region)
+{
+    pagemap_summary summary;
+    for_each(region.start_address, region.end_address,
+             [&summary](uint64_t, const pagemap_entry* entries, size_t count) {
+                 for (size_t i = 0; i < count; ++i)
+                 {
+                     const auto& entry = entries[i];
+                     summary.present += entry.is_present() ? 1 : 0;
+                     summary.swapped += entry.is_swapped() ? 1 : 0;
+                     summary.soft_dirty += entry.is_soft_dirty() ? 1 : 0;
+                     summary.exclusive += entry.is_exclusive() ? 1 : 0;
+                 }
+                 summary.pages += count;
+             });
+    return summary;
+}
+
+size_t pagemap::read(uint64_t page, pagemap_entry* entries, size_t count)
+{
+    static const size_t ENTRY_SIZE = sizeof(pagemap_entry);
+
+    auto buffer = reinterpret_cast<char*>(entries);
+    auto offset = static_cast<off_t>(page * ENTRY_SIZE);
+    size_t size = count * ENTRY_SIZE;
+
+    size_t total = 0;
+    while (total < size)
+    {
+        ssize_t bytes = pread(_fd, buffer + total, size - total,
+                              offset + static_cast<off_t>(total));
+        if (bytes == -1)
+        {
+            throw std::system_error(errno, std::system_category(),
+                                    "Couldn't read pagemap");
+        }
+
+        if (bytes == 0)
+        {
+            break;
+        }
+
+        total += static_cast<size_t>(bytes);
+    }
+
+    return total / ENTRY_SIZE;
+}
+
+} // namespace pfs
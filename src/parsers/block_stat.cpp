@@ -57,8 +57,9 @@ block_stat parse_block_stat_line(const std::string& line)
 
     static const char DELIM = ' ';
 
-    auto tokens = utils::split(line, DELIM);
-    if (tokens.size() < MIN_COUNT)
+    std::array<string_view, COUNT> tokens;
+    size_t count = utils::split(line, tokens, DELIM);
+    if (count < MIN_COUNT)
     {
         throw parser_error("Corrupted block stat - Unexpected tokens count", line);
     }
@@ -80,17 +81,17 @@ block_stat parse_block_stat_line(const std::string& line)
         utils::stot(tokens.at(DISCARD_MERGES), stat.discard_merges, utils::base::decimal);
         utils::stot(tokens.at(DISCARD_SECTORS), stat.discard_sectors, utils::base::decimal);
 
-        if (tokens.size() > DISCARD_TICKS)
+        if (count > DISCARD_TICKS)
         {
             utils::stot(tokens.at(DISCARD_TICKS), stat.discard_ticks, utils::base::decimal);
         }
 
-        if (tokens.size() > FLUSH_IOS)
+        if (count > FLUSH_IOS)
         {
             utils::stot(tokens.at(FLUSH_IOS), stat.flush_ios, utils::base::decimal);
         }
 
-        if (tokens.size() > FLUSH_TICKS)
+        if (count > FLUSH_TICKS)
         {
             utils::stot(tokens.at(FLUSH_TICKS), stat.flush_ticks, utils::base::decimal);
         }
@@ -42,22 +42,26 @@ zone parse_buddyinfo_line(const std::string& line)
 
     static const char NODE_DELIM = ',';
 
-    auto tokens = utils::split(line);
+    utils::tokenizer tok(line);
 
     // The number of chunks is variable, but we should always have at least the
     // first four columns.
-    if (tokens.size() < FIRST_CHUNK)
+    std::array<string_view, FIRST_CHUNK> tokens;
+    for (auto& token : tokens)
     {
-        throw parser_error("Corrupted buddyinfo - Unexpected tokens count",
-                           line);
+        if (!tok.next(token))
+        {
+            throw parser_error("Corrupted buddyinfo - Unexpected tokens count",
+                               line);
+        }
     }
 
-    std::string node_id_str = tokens[NODE_ID]; // Something like '0,'
+    string_view node_id_str = tokens[NODE_ID]; // Something like '0,'
     if (node_id_str.back() != NODE_DELIM)
     {
         throw parser_error("Corrupted buddyinfo - Missing node delim", line);
     }
-    node_id_str.pop_back();
+    node_id_str.remove_suffix(1);
 
     try
     {
@@ -65,17 +69,14 @@ zone parse_buddyinfo_line(const std::string& line)
 
         utils::stot(node_id_str, zn.node_id);
 
-        zn.name = tokens[ZONE_NAME];
-
-        // This line is protected from underflow thanks to the tokens size
-        // conditional above.
-        size_t num_chunks = tokens.size() - FIRST_CHUNK;
-
-        zn.chunks.resize(num_chunks);
+        zn.name = std::string(tokens[ZONE_NAME]);
 
-        for (size_t i = 0; i < num_chunks; ++i)
+        string_view chunk;
+        while (tok.next(chunk))
         {
-            utils::stot(tokens[FIRST_CHUNK + i], zn.chunks[i]);
+            size_t value;
+            utils::stot(chunk, value);
+            zn.chunks.push_back(value);
         }
 
         return zn;
@@ -56,12 +56,27 @@ cgroup parse_cgroup_line(const std::string& line)
     // The cgroup path component can contain colons (which are used as the
     // delimiter), so we must split exactly COUNT-1 times and cannot use the
     // regular `split` function here
-    auto tokens = utils::split_times(line, DELIM, COUNT - 1);
-    if (tokens.size() < COUNT)
+    string_view rest(line);
+    std::array<string_view, COUNT> tokens;
+    for (size_t i = 0; i < COUNT - 1; ++i)
+    {
+        size_t index = rest.find(DELIM);
+        if (index == string_view::npos)
+        {
+            throw parser_error(
+                "Corrupted cgroup line - Unexpected tokens count", line);
+        }
+
+        tokens[i] = rest.substr(0, index);
+        rest      = rest.substr(index + 1);
+    }
+
+    if (rest.empty())
     {
         throw parser_error("Corrupted cgroup line - Unexpected tokens count",
                            line);
     }
+    tokens[PATHNAME] = rest;
 
     try
     {
@@ -69,9 +84,14 @@ cgroup parse_cgroup_line(const std::string& line)
 
         utils::stot(tokens[HIERARCHY], cg.hierarchy);
 
-        cg.controllers = utils::split(tokens[CONTROLLERS], CONTROLLERS_DELIM);
+        utils::tokenizer tok(tokens[CONTROLLERS], CONTROLLERS_DELIM);
+        string_view controller;
+        while (tok.next(controller))
+        {
+            cg.controllers.emplace_back(controller);
+        }
 
-        cg.pathname = tokens[PATHNAME];
+        cg.pathname = std::string(tokens[PATHNAME]);
 
         return cg;
     }
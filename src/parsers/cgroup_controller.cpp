@@ -53,8 +53,8 @@ cgroup_controller parse_cgroup_controller_line(const std::string& line)
 
     static const char DELIM = '\t';
 
-    auto tokens = utils::split(line, DELIM);
-    if (tokens.size() != COUNT)
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(line, tokens, DELIM) != COUNT)
     {
         throw parser_error(
             "Corrupted cgroup controller line - Unexpected tokens count", line);
@@ -64,7 +64,7 @@ cgroup_controller parse_cgroup_controller_line(const std::string& line)
     {
         cgroup_controller controller;
 
-        controller.subsys_name = tokens[SUBSYS_NAME];
+        controller.subsys_name = std::string(tokens[SUBSYS_NAME]);
 
         utils::stot(tokens[HIERARCHY], controller.hierarchy);
 
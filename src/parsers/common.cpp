@@ -24,7 +24,7 @@ namespace pfs {
 namespace impl {
 namespace parsers {
 
-dev_t parse_device(const std::string& device_str, utils::base base)
+dev_t parse_device(string_view device_str, utils::base base)
 {
     // Device format must be '<major>:<minor>'
 
@@ -37,8 +37,8 @@ dev_t parse_device(const std::string& device_str, utils::base base)
 
     static const char DELIM = ':';
 
-    auto tokens = utils::split(device_str, DELIM);
-    if (tokens.size() != COUNT)
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(device_str, tokens, DELIM) != COUNT)
     {
         throw parser_error("Corrupted device - Unexpected tokens count",
                            device_str);
@@ -118,8 +118,8 @@ id_map parse_id_map_line(const std::string& line)
         COUNT
     };
 
-    auto tokens = utils::split(line);
-    if (tokens.size() < COUNT)
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(line, tokens) < COUNT)
     {
         throw parser_error("Corrupted uid_map/gid_map - Unexpected tokens count", line);
     }
@@ -144,6 +144,30 @@ id_map parse_id_map_line(const std::string& line)
     }
 }
 
+bool parse_socket_link(string_view link, ino64_t& inode)
+{
+    static const string_view PREFIX("socket:[");
+    static const char SUFFIX = ']';
+
+    if (link.size() <= PREFIX.size() + 1 ||
+        link.substr(0, PREFIX.size()) != PREFIX || link.back() != SUFFIX)
+    {
+        return false;
+    }
+
+    auto digits = link.substr(PREFIX.size(), link.size() - PREFIX.size() - 1);
+
+    ino64_t value;
+    auto result = utils::from_chars(digits.begin(), digits.end(), value);
+    if (result.ec != std::errc() || result.ptr != digits.end())
+    {
+        return false;
+    }
+
+    inode = value;
+    return true;
+}
+
 } // namespace parsers
 } // namespace impl
 } // namespace pfs
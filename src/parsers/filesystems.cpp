@@ -44,14 +44,15 @@ std::pair<std::string, bool> parse_filesystems_line(const std::string& line)
 
     static const char DELIM = '\t';
 
-    auto tokens = utils::split(line, DELIM);
-    if (tokens.size() == TOKENS_DEV)
+    std::array<string_view, TOKENS_NODEV> tokens;
+    size_t count = utils::split(line, tokens, DELIM);
+    if (count == TOKENS_DEV)
     {
-        return std::make_pair(tokens.back(), true);
+        return std::make_pair(std::string(tokens[count - 1]), true);
     }
-    else if (tokens.size() == TOKENS_NODEV)
+    else if (count == TOKENS_NODEV)
     {
-        return std::make_pair(tokens.back(), false);
+        return std::make_pair(std::string(tokens[count - 1]), false);
     }
     else
     {
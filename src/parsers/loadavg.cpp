@@ -25,7 +25,7 @@ namespace parsers {
 namespace {
 
 std::pair<size_t, size_t>
-parse_loadavg_task_counts(const std::string& task_counts_str)
+parse_loadavg_task_counts(string_view task_counts_str)
 {
     enum token
     {
@@ -36,8 +36,8 @@ parse_loadavg_task_counts(const std::string& task_counts_str)
 
     static const char DELIM = '/';
 
-    auto tokens = utils::split(task_counts_str, DELIM);
-    if (tokens.size() != COUNT)
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(task_counts_str, tokens, DELIM) != COUNT)
     {
         throw parser_error(
             "Corrupted loadavg task counts - Unexpected number of tokens",
@@ -72,8 +72,8 @@ load_average parse_loadavg_line(const std::string& line)
         COUNT
     };
 
-    auto tokens = utils::split(line);
-    if (tokens.size() != COUNT)
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(line, tokens) != COUNT)
     {
         throw parser_error("Corrupted loadavg - Unexpected tokens count", line);
     }
@@ -82,9 +82,9 @@ load_average parse_loadavg_line(const std::string& line)
     {
         load_average load;
 
-        load.last_1min  = std::stod(tokens[LAST_1MIN]);
-        load.last_5min  = std::stod(tokens[LAST_5MIN]);
-        load.last_15min = std::stod(tokens[LAST_15MIN]);
+        load.last_1min  = std::stod(std::string(tokens[LAST_1MIN]));
+        load.last_5min  = std::stod(std::string(tokens[LAST_5MIN]));
+        load.last_15min = std::stod(std::string(tokens[LAST_15MIN]));
 
         std::tie(load.runnable_tasks, load.total_tasks) =
             parse_loadavg_task_counts(tokens[TASK_COUNTS]);
@@ -26,7 +26,7 @@ namespace parsers {
 namespace {
 
 std::pair<uint64_t, uint64_t>
-parse_mem_region_address(const std::string& address_str)
+parse_mem_region_address(string_view address_str)
 {
     // Address must be a range '<start>-<end>'
     enum address_token
@@ -38,8 +38,8 @@ parse_mem_region_address(const std::string& address_str)
 
     static const char DELIM = '-';
 
-    auto tokens = utils::split(address_str, DELIM);
-    if (tokens.size() != COUNT)
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(address_str, tokens, DELIM) != COUNT)
     {
         throw parser_error("Corrupted address - Unexpected tokens count",
                            address_str);
@@ -65,7 +65,7 @@ parse_mem_region_address(const std::string& address_str)
     }
 }
 
-mem_perm parse_mem_region_permissions(const std::string& perm_str)
+mem_perm parse_mem_region_permissions(string_view perm_str)
 {
     enum bit
     {
@@ -96,7 +96,7 @@ mem_perm parse_mem_region_permissions(const std::string& perm_str)
     return perm;
 }
 
-uint64_t parse_mem_region_offset(const std::string& offset_str)
+uint64_t parse_mem_region_offset(string_view offset_str)
 {
     try
     {
@@ -114,7 +114,7 @@ uint64_t parse_mem_region_offset(const std::string& offset_str)
     }
 }
 
-ino64_t parse_mem_region_inode(const std::string& inode_str)
+ino64_t parse_mem_region_inode(string_view inode_str)
 {
     try
     {
@@ -134,7 +134,7 @@ ino64_t parse_mem_region_inode(const std::string& inode_str)
 
 } // anonymous namespace
 
-mem_region parse_maps_line(const std::string& line)
+mem_region parse_maps_line(const std::string& line, string_pool* pool)
 {
     // Some examples:
     // clang-format off
@@ -165,11 +165,16 @@ mem_region parse_maps_line(const std::string& line)
         COUNT
     };
 
-    auto tokens = utils::split(line);
-    if (tokens.size() < MIN_COUNT)
+    utils::tokenizer tok(line);
+
+    std::array<string_view, MIN_COUNT> tokens;
+    for (auto& token : tokens)
     {
-        throw parser_error("Corrupted maps line - Unexpected tokens count",
-                           line);
+        if (!tok.next(token))
+        {
+            throw parser_error("Corrupted maps line - Unexpected tokens count",
+                               line);
+        }
     }
 
     mem_region region;
@@ -185,14 +190,16 @@ mem_region parse_maps_line(const std::string& line)
 
     region.inode = parse_mem_region_inode(tokens[INODE]);
 
-    for (size_t i = PATHNAME; i < tokens.size(); ++i)
+    // The pathname is printed as is, and might contain spaces
+    string_view pathname;
+    if (tok.next(pathname))
     {
-        if (!region.pathname.empty())
-        {
-            region.pathname += " ";
-        }
+        pathname = string_view(pathname.data(), line.data() + line.size() -
+                                                     pathname.data());
+        utils::rtrim(pathname);
 
-        region.pathname += tokens[i];
+        region.pathname =
+            pool ? pool->intern(pathname) : shared_string(std::string(pathname));
     }
 
     return region;
@@ -53,21 +53,22 @@ std::pair<std::string, size_t> parse_meminfo_line(const std::string& line)
         COUNT
     };
 
-    auto tokens = utils::split(line);
-    if (tokens.size() < MIN_COUNT || tokens.size() > COUNT)
+    std::array<string_view, COUNT> tokens;
+    size_t count = utils::split(line, tokens);
+    if (count < MIN_COUNT || count > COUNT)
     {
         throw parser_error("Corrupted meminfo - Unexpected tokens count", line);
     }
 
     try
     {
-        auto& description = tokens[DESCRIPTION];
-        description.pop_back(); // Remove ':'
+        auto description = tokens[DESCRIPTION];
+        description.remove_suffix(1); // Remove ':'
 
         size_t amount;
         utils::stot(tokens[AMOUNT], amount);
 
-        return std::make_pair(description, amount);
+        return std::make_pair(std::string(description), amount);
     }
     catch (const std::invalid_argument& ex)
     {
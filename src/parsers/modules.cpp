@@ -24,11 +24,11 @@ namespace parsers {
 
 namespace {
 
-module::state parse_module_state(const std::string& state_str)
+module::state parse_module_state(string_view state_str)
 {
-    static const std::string LIVE("Live");
-    static const std::string LOADING("Loading");
-    static const std::string UNLOADING("Unloading");
+    static const string_view LIVE("Live");
+    static const string_view LOADING("Loading");
+    static const string_view UNLOADING("Unloading");
 
     if (state_str == LIVE)
     {
@@ -82,11 +82,12 @@ module parse_modules_line(const std::string& line)
     static const char FLAG_OUT_OF_TREE('O');
     static const char FLAG_UNSIGNED('E');
 
-    static const std::string NO_DEPENDENCIES("-");
-    static const std::string NO_INSTANCES("-");
+    static const string_view NO_DEPENDENCIES("-");
+    static const string_view NO_INSTANCES("-");
 
-    auto tokens = utils::split(line);
-    if (tokens.size() < MIN_COUNT || tokens.size() > COUNT)
+    std::array<string_view, COUNT> tokens;
+    size_t count = utils::split(line, tokens);
+    if (count < MIN_COUNT || count > COUNT)
     {
         throw parser_error("Corrupted modules line - Unexpected tokens count",
                            line);
@@ -96,7 +97,7 @@ module parse_modules_line(const std::string& line)
     {
         module mod;
 
-        mod.name = tokens[NAME];
+        mod.name = std::string(tokens[NAME]);
 
         utils::stot(tokens[SIZE], mod.size);
 
@@ -111,19 +112,24 @@ module parse_modules_line(const std::string& line)
 
         if (tokens[DEPENDENCIES] != NO_DEPENDENCIES)
         {
-            mod.dependencies = utils::split(tokens[DEPENDENCIES], ',');
+            utils::tokenizer tok(tokens[DEPENDENCIES], ',');
+            string_view dependency;
+            while (tok.next(dependency))
+            {
+                mod.dependencies.emplace_back(dependency);
+            }
         }
 
         mod.module_state = parse_module_state(tokens[STATE]);
 
         utils::stot(tokens[OFFSET], mod.offset, utils::base::hex);
 
-        if (tokens.size() > FLAGS)
+        if (count > FLAGS)
         {
             const auto& flags = tokens[FLAGS];
             mod.is_out_of_tree =
-                (flags.find(FLAG_OUT_OF_TREE) != std::string::npos);
-            mod.is_unsigned = (flags.find(FLAG_UNSIGNED) != std::string::npos);
+                (flags.find(FLAG_OUT_OF_TREE) != string_view::npos);
+            mod.is_unsigned = (flags.find(FLAG_UNSIGNED) != string_view::npos);
         }
         else
         {
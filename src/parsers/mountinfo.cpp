@@ -57,44 +57,83 @@ mount parse_mountinfo_line(const std::string& line)
         POST_COUNT
     };
 
-    static const std::string SEPARATOR("-");
+    static const string_view SEPARATOR("-");
 
     static const char OPTIONS_DELIM = ',';
 
-    auto tokens = utils::split(line);
-    if (tokens.size() < static_cast<int>(PRE_COUNT) + static_cast<int>(POST_COUNT))
+    auto corrupted = [&line]() {
+        return parser_error("Corrupted mountinfo - Unexpected tokens count",
+                            line);
+    };
+
+    auto split_options = [](string_view options_str) {
+        std::vector<std::string> options;
+
+        utils::tokenizer tok(options_str, OPTIONS_DELIM);
+        string_view option;
+        while (tok.next(option))
+        {
+            options.emplace_back(option);
+        }
+
+        return options;
+    };
+
+    utils::tokenizer tok(line);
+
+    std::array<string_view, OPTIONAL> pre_tokens;
+    for (auto& token : pre_tokens)
     {
-        throw parser_error("Corrupted mountinfo - Unexpected tokens count",
-                           line);
+        if (!tok.next(token))
+        {
+            throw corrupted();
+        }
     }
 
     try
     {
         mount mnt;
 
-        utils::stot(tokens[MOUNT_ID], mnt.id);
-        utils::stot(tokens[PARENT_ID], mnt.parent_id);
+        utils::stot(pre_tokens[MOUNT_ID], mnt.id);
+        utils::stot(pre_tokens[PARENT_ID], mnt.parent_id);
+
+        mnt.device = parse_device(pre_tokens[DEVICE], utils::base::decimal);
 
-        mnt.device = parse_device(tokens[DEVICE], utils::base::decimal);
+        mnt.root  = std::string(pre_tokens[ROOT]);
+        mnt.point = std::string(pre_tokens[MOUNT_POINT]);
 
-        mnt.root  = tokens[ROOT];
-        mnt.point = tokens[MOUNT_POINT];
+        mnt.options = split_options(pre_tokens[MOUNT_OPTIONS]);
 
-        mnt.options = utils::split(tokens[MOUNT_OPTIONS], OPTIONS_DELIM);
+        string_view optional;
+        while (true)
+        {
+            if (!tok.next(optional))
+            {
+                throw corrupted();
+            }
+
+            if (optional == SEPARATOR)
+            {
+                break;
+            }
+
+            mnt.optional.emplace_back(optional);
+        }
 
-        size_t i;
-        for (i = OPTIONAL; tokens[i] != SEPARATOR; ++i)
+        std::array<string_view, POST_COUNT> post_tokens;
+        for (auto& token : post_tokens)
         {
-            mnt.optional.push_back(tokens[i]);
+            if (!tok.next(token))
+            {
+                throw corrupted();
+            }
         }
-        ++i; // Skip separator
 
-        mnt.filesystem_type = tokens[i + FILESYSTEM_TYPE];
+        mnt.filesystem_type = std::string(post_tokens[FILESYSTEM_TYPE]);
 
-        mnt.source = tokens[i + MOUNT_SOURCE];
+        mnt.source = std::string(post_tokens[MOUNT_SOURCE]);
 
-        mnt.super_options =
-            utils::split(tokens[i + SUPER_OPTIONS], OPTIONS_DELIM);
+        mnt.super_options = split_options(post_tokens[SUPER_OPTIONS]);
 
         return mnt;
     }
@@ -46,8 +46,8 @@ net_arp parse_net_arp_line(const std::string& line)
 
     static const char DELIM = ' ';
 
-    auto tokens = utils::split(line, DELIM);
-    if (tokens.size() != COUNT)
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(line, tokens, DELIM) != COUNT)
     {
         throw parser_error("Corrupted net arp - Unexpected tokens count", line);
     }
@@ -55,12 +55,12 @@ net_arp parse_net_arp_line(const std::string& line)
     try
     {
         // Parse tokens into arp struct
-        arp.ip_address = tokens[IP_ADDRESS];
+        arp.ip_address = std::string(tokens[IP_ADDRESS]);
         utils::stot(tokens[TYPE], arp.type, utils::base::hex);
         utils::stot(tokens[FLAGS], arp.flags, utils::base::hex);
-        arp.hw_address = tokens[HW_ADDRESS];
-        arp.mask = tokens[MASK];
-        arp.device = tokens[DEVICE];
+        arp.hw_address = std::string(tokens[HW_ADDRESS]);
+        arp.mask = std::string(tokens[MASK]);
+        arp.device = std::string(tokens[DEVICE]);
     }
     catch (const std::invalid_argument& ex)
     {
@@ -54,8 +54,8 @@ net_device parse_net_device_line(const std::string& line)
         COUNT
     };
 
-    auto tokens = utils::split(line);
-    if (tokens.size() != COUNT)
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(line, tokens) != COUNT)
     {
         throw parser_error("Corrupted net device line - Wrong number of tokens",
                            line);
@@ -65,8 +65,9 @@ net_device parse_net_device_line(const std::string& line)
     {
         net_device dev;
 
-        dev.interface = tokens[INTERFACE];
-        dev.interface.pop_back(); // Remove ':';
+        auto interface = tokens[INTERFACE];
+        interface.remove_suffix(1); // Remove ':';
+        dev.interface = std::string(interface);
 
         utils::stot(tokens[RX_BYTES], dev.rx_bytes, utils::base::decimal);
         utils::stot(tokens[RX_PACKETS], dev.rx_packets, utils::base::decimal);
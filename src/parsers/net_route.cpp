@@ -55,8 +55,8 @@ net_route parse_net_route_line(const std::string& line)
 
     static const char DELIM = '\t';
 
-    auto tokens = utils::split(line, DELIM);
-    if (tokens.size() != COUNT)
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(line, tokens, DELIM) != COUNT)
     {
         throw parser_error("Corrupted net route - Unexpected tokens count", line);
     }
@@ -64,7 +64,7 @@ net_route parse_net_route_line(const std::string& line)
     try
     {
         // Parse tokens into route struct
-        route.iface = tokens[INTERFACE];
+        route.iface = std::string(tokens[INTERFACE]);
         route.destination = utils::parse_ipv4_address(tokens[DESTINATION]);
         route.gateway = utils::parse_ipv4_address(tokens[GATEWAY]);
         route.mask = utils::parse_ipv4_address(tokens[MASK]);
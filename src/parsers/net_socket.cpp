@@ -26,7 +26,7 @@ namespace parsers {
 
 namespace {
 
-net_socket::net_state parse_state(const std::string& state_str)
+net_socket::net_state parse_state(string_view state_str)
 {
     int state_int;
     utils::stot(state_str, state_int, utils::base::hex);
@@ -42,7 +42,7 @@ net_socket::net_state parse_state(const std::string& state_str)
     return state;
 }
 
-std::pair<size_t, size_t> parse_queues(const std::string& queues_str)
+std::pair<size_t, size_t> parse_queues(string_view queues_str)
 {
     enum token
     {
@@ -53,8 +53,8 @@ std::pair<size_t, size_t> parse_queues(const std::string& queues_str)
 
     static const char DELIM = ':';
 
-    auto tokens = utils::split(queues_str, DELIM);
-    if (tokens.size() != COUNT)
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(queues_str, tokens, DELIM) != COUNT)
     {
         throw parser_error(
             "Corrupted net socket queues - Unexpected token counts",
@@ -70,7 +70,7 @@ std::pair<size_t, size_t> parse_queues(const std::string& queues_str)
     return std::make_pair(tx_queue, rx_queue);
 }
 
-std::pair<net_socket::timer, size_t> parse_timer(const std::string& timer_str)
+std::pair<net_socket::timer, size_t> parse_timer(string_view timer_str)
 {
     enum token
     {
@@ -81,8 +81,8 @@ std::pair<net_socket::timer, size_t> parse_timer(const std::string& timer_str)
 
     static const char DELIM = ':';
 
-    auto tokens = utils::split(timer_str, DELIM);
-    if (tokens.size() != COUNT)
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(timer_str, tokens, DELIM) != COUNT)
     {
         throw parser_error(
             "Corrupted net socket timer - Unexpected token counts", timer_str);
@@ -105,9 +105,24 @@ std::pair<net_socket::timer, size_t> parse_timer(const std::string& timer_str)
     return std::make_pair(timer, expire_jiffies);
 }
 
+// Tokenize only the leading columns of a line, the rest is left untouched
+template <size_t N>
+void split_leading(string_view line, std::array<string_view, N>& tokens)
+{
+    utils::tokenizer tok(line);
+    for (auto& token : tokens)
+    {
+        if (!tok.next(token))
+        {
+            throw parser_error("Corrupted net socket line - Not enough tokens",
+                               line);
+        }
+    }
+}
+
 } // anonymous namespace
 
-net_socket parse_net_socket_line(const std::string& line)
+void parse_net_socket_line_into(string_view line, net_socket& sock)
 {
     // Some examples:
     // clang-format off
@@ -140,8 +155,8 @@ net_socket parse_net_socket_line(const std::string& line)
         MIN_COUNT // More tokens are expected, but ignored
     };
 
-    auto tokens = utils::split(line);
-    if (tokens.size() < MIN_COUNT)
+    std::array<string_view, MIN_COUNT> tokens;
+    if (utils::split(line, tokens) < MIN_COUNT)
     {
         throw parser_error("Corrupted net socket line - Not enough tokens",
                            line);
@@ -149,8 +164,6 @@ net_socket parse_net_socket_line(const std::string& line)
 
     try
     {
-        net_socket sock;
-
         utils::stot(tokens[SLOT], sock.slot, utils::base::hex);
 
         std::tie(sock.local_ip, sock.local_port) =
@@ -176,8 +189,79 @@ net_socket parse_net_socket_line(const std::string& line)
         utils::stot(tokens[REF_COUNT], sock.ref_count);
 
         utils::stot(tokens[SKBUFF], sock.skbuff, utils::base::hex);
+    }
+    catch (const std::invalid_argument& ex)
+    {
+        throw parser_error("Corrupted net socket - Invalid argument", line);
+    }
+    catch (const std::out_of_range& ex)
+    {
+        throw parser_error("Corrupted net socket - Out of range", line);
+    }
+}
+
+net_socket parse_net_socket_line(const std::string& line)
+{
+    net_socket sock;
+    parse_net_socket_line_into(line, sock);
+    return sock;
+}
 
-        return sock;
+net_socket::net_state parse_net_socket_state(string_view line)
+{
+    enum token
+    {
+        SLOT           = 0,
+        LOCAL_ADDRESS  = 1,
+        REMOTE_ADDRESS = 2,
+        STATE          = 3,
+        COUNT
+    };
+
+    std::array<string_view, COUNT> tokens;
+    split_leading(line, tokens);
+
+    try
+    {
+        return parse_state(tokens[STATE]);
+    }
+    catch (const std::invalid_argument& ex)
+    {
+        throw parser_error("Corrupted net socket - Invalid argument", line);
+    }
+    catch (const std::out_of_range& ex)
+    {
+        throw parser_error("Corrupted net socket - Out of range", line);
+    }
+}
+
+uint16_t parse_net_socket_local_port(string_view line)
+{
+    enum token
+    {
+        SLOT          = 0,
+        LOCAL_ADDRESS = 1,
+        COUNT
+    };
+
+    static const char DELIM = ':';
+
+    std::array<string_view, COUNT> tokens;
+    split_leading(line, tokens);
+
+    auto address = tokens[LOCAL_ADDRESS];
+    auto delim   = address.rfind(DELIM);
+    if (delim == string_view::npos)
+    {
+        throw parser_error("Corrupted net socket address - Missing port",
+                           address);
+    }
+
+    try
+    {
+        uint16_t port;
+        utils::stot(address.substr(delim + 1), port, utils::base::hex);
+        return port;
     }
     catch (const std::invalid_argument& ex)
     {
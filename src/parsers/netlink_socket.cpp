@@ -24,7 +24,7 @@ namespace parsers {
 
 namespace {
 
-uint32_t parse_port_id(const std::string& port_id_str)
+uint32_t parse_port_id(string_view port_id_str)
 {
     // Older versions serialize this as %-6d, even though
     // the type has always been u32.
@@ -35,7 +35,7 @@ uint32_t parse_port_id(const std::string& port_id_str)
     if (port_id < std::numeric_limits<int32_t>::min() ||
         port_id > std::numeric_limits<uint32_t>::max())
     {
-        throw std::out_of_range(port_id_str);
+        throw std::out_of_range(std::string(port_id_str));
     }
 
     return static_cast<uint32_t>(port_id);
@@ -70,11 +70,12 @@ netlink_socket parse_netlink_socket_line(const std::string& line)
         COUNT
     };
 
-    static const std::string NULL_STR("(null)");
-    static const std::string ZERO_STR("0");
+    static const string_view NULL_STR("(null)");
+    static const string_view ZERO_STR("0");
 
-    auto tokens = utils::split(line);
-    if (tokens.size() < MIN_COUNT)
+    std::array<string_view, COUNT> tokens;
+    size_t count = utils::split(line, tokens);
+    if (count < MIN_COUNT)
     {
         throw parser_error(
             "Corrupted netlink socket line - Unexpected token count", line);
@@ -106,7 +107,7 @@ netlink_socket parse_netlink_socket_line(const std::string& line)
 
         utils::stot(tokens[DROPS], sock.drops);
 
-        if (tokens.size() > INODE)
+        if (count > INODE)
         {
             utils::stot(tokens[INODE], sock.inode);
         }
@@ -28,7 +28,7 @@ namespace parsers {
 namespace {
 
 template <typename T>
-static void to_sequence(const std::string& value, proc_stat::sequence<T>& out)
+static void to_sequence(string_view value, proc_stat::sequence<T>& out)
 {
     // Some examples:
     // clang-format off
@@ -41,8 +41,10 @@ static void to_sequence(const std::string& value, proc_stat::sequence<T>& out)
         MIN_COUNT = 1,
     };
 
-    auto tokens = utils::split(value);
-    if (tokens.size() < MIN_COUNT)
+    utils::tokenizer tok(value);
+
+    string_view total;
+    if (!tok.next(total))
     {
         throw parser_error("Corrupted sequence - Unexpected tokens count",
                            value);
@@ -50,12 +52,13 @@ static void to_sequence(const std::string& value, proc_stat::sequence<T>& out)
 
     try
     {
-        utils::stot(tokens[TOTAL], out.total);
+        utils::stot(total, out.total);
 
-        for (size_t i = MIN_COUNT; i < tokens.size(); i++)
+        string_view token;
+        while (tok.next(token))
         {
             unsigned long long value;
-            utils::stot(tokens[i], value);
+            utils::stot(token, value);
             out.per_item.push_back(value);
         }
     }
@@ -69,7 +72,7 @@ static void to_sequence(const std::string& value, proc_stat::sequence<T>& out)
     }
 }
 
-static void to_cpu(const std::string& value, proc_stat::cpu& out)
+static void to_cpu(string_view value, proc_stat::cpu& out)
 {
     // Some examples:
     // clang-format off
@@ -93,8 +96,9 @@ static void to_cpu(const std::string& value, proc_stat::cpu& out)
         COUNT
     };
 
-    auto tokens = utils::split(value);
-    if (tokens.size() < MIN_COUNT || tokens.size() > COUNT)
+    std::array<string_view, COUNT> tokens;
+    size_t count = utils::split(value, tokens);
+    if (count < MIN_COUNT || count > COUNT)
     {
         throw parser_error("Corrupted cpu - Unexpected tokens count", value);
     }
@@ -106,32 +110,32 @@ static void to_cpu(const std::string& value, proc_stat::cpu& out)
         utils::stot(tokens[SYSTEM], out.system);
         utils::stot(tokens[IDLE], out.idle);
 
-        if (tokens.size() > IOWAIT)
+        if (count > IOWAIT)
         {
             utils::stot(tokens[IOWAIT], out.iowait);
         }
 
-        if (tokens.size() > IRQ)
+        if (count > IRQ)
         {
             utils::stot(tokens[IRQ], out.irq);
         }
 
-        if (tokens.size() > SOFTIRQ)
+        if (count > SOFTIRQ)
         {
             utils::stot(tokens[SOFTIRQ], out.softirq);
         }
 
-        if (tokens.size() > STEAL)
+        if (count > STEAL)
         {
             utils::stot(tokens[STEAL], out.steal);
         }
 
-        if (tokens.size() > GUEST)
+        if (count > GUEST)
         {
             utils::stot(tokens[GUEST], out.guest);
         }
 
-        if (tokens.size() > GUEST_NICE)
+        if (count > GUEST_NICE)
         {
             utils::stot(tokens[GUEST_NICE], out.guest_nice);
         }
@@ -146,7 +150,7 @@ static void to_cpu(const std::string& value, proc_stat::cpu& out)
     }
 }
 
-static void parse_cpu_total(const std::string& value, proc_stat& out)
+static void parse_cpu_total(string_view value, proc_stat& out)
 {
     proc_stat::cpu cpu;
     to_cpu(value, cpu);
@@ -154,47 +158,51 @@ static void parse_cpu_total(const std::string& value, proc_stat& out)
     out.cpus.total = cpu;
 }
 
-static void parse_cpu_single(const std::string& value, proc_stat& out)
+static void parse_cpu_single(string_view key, string_view value,
+                             proc_stat& out)
 {
+    static const size_t PREFIX_SIZE = 3; // "cpu"
+
     proc_stat::cpu cpu;
+    to_number("cpu", key.substr(PREFIX_SIZE), utils::base::decimal, cpu.id);
     to_cpu(value, cpu);
 
     out.cpus.per_item.push_back(cpu);
 }
 
-static void parse_intr(const std::string& value, proc_stat& out)
+static void parse_intr(string_view value, proc_stat& out)
 {
     to_sequence(value, out.intr);
 }
 
-static void parse_ctxt(const std::string& value, proc_stat& out)
+static void parse_ctxt(string_view value, proc_stat& out)
 {
     to_number("ctxt", value, utils::base::decimal, out.ctxt);
 }
 
-static void parse_btime(const std::string& value, proc_stat& out)
+static void parse_btime(string_view value, proc_stat& out)
 {
     time_t btime;
     to_number("btime", value, utils::base::decimal, btime);
     out.btime = std::chrono::system_clock::from_time_t(btime);
 }
 
-static void parse_processes(const std::string& value, proc_stat& out)
+static void parse_processes(string_view value, proc_stat& out)
 {
     to_number("processes", value, utils::base::decimal, out.processes);
 }
 
-static void parse_procs_running(const std::string& value, proc_stat& out)
+static void parse_procs_running(string_view value, proc_stat& out)
 {
     to_number("procs_running", value, utils::base::decimal, out.procs_running);
 }
 
-static void parse_procs_blocked(const std::string& value, proc_stat& out)
+static void parse_procs_blocked(string_view value, proc_stat& out)
 {
     to_number("procs_blocked", value, utils::base::decimal, out.procs_blocked);
 }
 
-static void parse_softirq(const std::string& value, proc_stat& out)
+static void parse_softirq(string_view value, proc_stat& out)
 {
     to_sequence(value, out.softirq);
 }
@@ -203,16 +211,21 @@ static void parse_softirq(const std::string& value, proc_stat& out)
 
 const char proc_stat_parser::DELIM = ' ';
 
-void proc_stat_parser::key_remap(std::string& key)
+string_view proc_stat_parser::key_remap(string_view key)
 {
-    if (key == "cpu")
+    static const string_view CPU("cpu");
+
+    if (key == CPU)
     {
-        key = "cpu_total";
+        return "cpu_total";
     }
-    else if (key.rfind("cpu", 0) == 0)
+
+    if (key.size() > CPU.size() && key.substr(0, CPU.size()) == CPU)
     {
-        key = "cpu_single";
+        return "cpu_single";
     }
+
+    return key;
 }
 
 // clang-format off
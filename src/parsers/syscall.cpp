@@ -24,6 +24,11 @@ namespace parsers {
 
 namespace {
 
+// The largest number of tokens, see 'COUNT_IN_SYSCALL' below
+const size_t MAX_TOKENS = 9;
+
+using syscall_tokens = std::array<string_view, MAX_TOKENS>;
+
 syscall parse_syscall_when_running() {
     syscall out{};
     out.state = syscall_state::running;
@@ -31,7 +36,7 @@ syscall parse_syscall_when_running() {
     return out;
 }
 
-syscall parse_syscall_when_blocked(const std::vector<std::string>& tokens) {
+syscall parse_syscall_when_blocked(const syscall_tokens& tokens) {
     syscall out{};
     out.state = syscall_state::blocked;
 
@@ -50,7 +55,7 @@ syscall parse_syscall_when_blocked(const std::vector<std::string>& tokens) {
     return out;
 }
 
-syscall parse_syscall_when_in_syscall(const std::vector<std::string>& tokens) {
+syscall parse_syscall_when_in_syscall(const syscall_tokens& tokens) {
     syscall out{};
     out.state = syscall_state::syscall;
 
@@ -105,8 +110,8 @@ syscall parse_syscall_line(const std::string& line)
 
     try
     {
-        auto tokens = utils::split(line, DELIM);
-        switch (tokens.size()) {
+        syscall_tokens tokens;
+        switch (utils::split(line, tokens, DELIM)) {
             case COUNT_RUNNING:
                 return parse_syscall_when_running();
             case COUNT_BLOCKED:
@@ -22,33 +22,57 @@ namespace pfs {
 namespace impl {
 namespace parsers {
 
-const char task_io_parser::DELIM = ':';
+namespace {
+
+void parse_rchar(string_view value, io_stats& out)
+{
+    to_number("rchar", value, utils::base::decimal, out.rchar);
+}
+
+void parse_wchar(string_view value, io_stats& out)
+{
+    to_number("wchar", value, utils::base::decimal, out.wchar);
+}
+
+void parse_syscr(string_view value, io_stats& out)
+{
+    to_number("syscr", value, utils::base::decimal, out.syscr);
+}
+
+void parse_syscw(string_view value, io_stats& out)
+{
+    to_number("syscw", value, utils::base::decimal, out.syscw);
+}
+
+void parse_read_bytes(string_view value, io_stats& out)
+{
+    to_number("read_bytes", value, utils::base::decimal, out.read_bytes);
+}
+
+void parse_write_bytes(string_view value, io_stats& out)
+{
+    to_number("write_bytes", value, utils::base::decimal, out.write_bytes);
+}
 
-task_io_parser::value_parsers task_io_parser::make_value_parsers() {
-    auto make_value_parser = [](const std::string& field,
-                                unsigned long io_stats::*member) {
-
-        auto parser = [field, member](const std::string& value, io_stats& out) {
-            to_number(field, value, utils::base::decimal, out.*member);
-        };
-
-        return std::make_pair(field, parser);
-    };
-
-    return {
-        make_value_parser("rchar",                 &io_stats::rchar),
-        make_value_parser("wchar",                 &io_stats::wchar),
-        make_value_parser("syscr",                 &io_stats::syscr),
-        make_value_parser("syscw",                 &io_stats::syscw),
-        make_value_parser("read_bytes",            &io_stats::read_bytes),
-        make_value_parser("write_bytes",           &io_stats::write_bytes),
-        make_value_parser("cancelled_write_bytes", &io_stats::cancelled_write_bytes),
-    };
+void parse_cancelled_write_bytes(string_view value, io_stats& out)
+{
+    to_number("cancelled_write_bytes", value, utils::base::decimal, out.cancelled_write_bytes);
 }
 
+} // anonymous namespace
+
+const char task_io_parser::DELIM = ':';
+
 // clang-format off
-const task_io_parser::value_parsers
-task_io_parser::PARSERS = task_io_parser::make_value_parsers();
+const task_io_parser::value_parsers task_io_parser::PARSERS = {
+    { "rchar", parse_rchar },
+    { "wchar", parse_wchar },
+    { "syscr", parse_syscr },
+    { "syscw", parse_syscw },
+    { "read_bytes", parse_read_bytes },
+    { "write_bytes", parse_write_bytes },
+    { "cancelled_write_bytes", parse_cancelled_write_bytes },
+};
 // clang-format on
 
 } // namespace parsers
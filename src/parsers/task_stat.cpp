@@ -0,0 +1,183 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <ctype.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#include "pfs/parser_error.hpp"
+#include "pfs/parsers/common.hpp"
+#include "pfs/parsers/task_stat.hpp"
+#include "pfs/utils.hpp"
+
+namespace pfs {
+namespace impl {
+namespace parsers {
+
+namespace {
+
+// A minimal scanner that mimics the fscanf conversions the stat file used to
+// be parsed with:
+// - '%c' reads the next char as is
+// - Integer conversions skip leading whitespaces
+// - Unsigned conversions accept a minus sign and negate the value
+// Once a conversion fails, all of the following ones are skipped, and
+// 'matches' holds the number of successful conversions.
+class stat_scanner
+{
+public:
+    explicit stat_scanner(string_view buffer)
+        : _ptr(buffer.begin()), _end(buffer.end()), _matches(0), _failed(false)
+    {}
+
+    stat_scanner& operator>>(char& out)
+    {
+        if (_failed || _ptr == _end)
+        {
+            _failed = true;
+            return *this;
+        }
+
+        out = *_ptr++;
+        ++_matches;
+        return *this;
+    }
+
+    template <typename T>
+    stat_scanner& operator>>(T& out)
+    {
+        if (_failed)
+        {
+            return *this;
+        }
+
+        while (_ptr != _end && isspace(static_cast<unsigned char>(*_ptr)))
+        {
+            ++_ptr;
+        }
+
+        bool negative = false;
+        if (std::is_unsigned<T>::value && _ptr != _end && *_ptr == '-')
+        {
+            negative = true;
+            ++_ptr;
+        }
+
+        auto result = utils::from_chars(_ptr, _end, out);
+        if (result.ec == std::errc::result_out_of_range)
+        {
+            // Out of range values saturate, like with strtoll/strtoull
+            bool below = std::is_signed<T>::value && *_ptr == '-';
+            out = below ? std::numeric_limits<T>::min()
+                        : std::numeric_limits<T>::max();
+        }
+        else if (result.ec != std::errc())
+        {
+            _failed = true;
+            return *this;
+        }
+        else if (negative)
+        {
+            out = static_cast<T>(0 - out);
+        }
+
+        _ptr = result.ptr;
+        ++_matches;
+        return *this;
+    }
+
+    int matches() const { return _matches; }
+
+    // The part of the buffer that wasn't consumed yet
+    string_view remaining() const
+    {
+        return string_view(_ptr, static_cast<size_t>(_end - _ptr));
+    }
+
+private:
+    const char* _ptr;
+    const char* _end;
+    int _matches;
+    bool _failed;
+};
+
+} // anonymous namespace
+
+task_stat parse_task_stat_line(string_view line)
+{
+    task_stat st;
+
+    // Consume PID and space delim
+    stat_scanner pid_scanner(line);
+    pid_scanner >> st.pid;
+    if (pid_scanner.matches() != 1)
+    {
+        throw parser_error("Couldn't read pid from stat", std::string(line));
+    }
+
+    line = pid_scanner.remaining();
+    utils::ltrim(line);
+
+    // Comm is the text between the outmost pair of parenthesis.
+    // It might contain parenthesis and whitespaces, but the rest of the fields
+    // are numeric, so the last ')' in the buffer must be the one closing it.
+    auto close_paren = line.rfind(')');
+    if (close_paren == string_view::npos || close_paren == 0)
+    {
+        throw parser_error("Corrupted stat - Malformed comm field",
+                           std::string(line));
+    }
+    st.comm = std::string(line.substr(1, close_paren - 1));
+
+    // Skip past comm: closing ')' + space separator before next token
+    static const size_t COMM_SUFFIX_SIZE = 2; // ')' + ' '
+    line.remove_prefix(std::min(line.size(), close_paren + COMM_SUFFIX_SIZE));
+
+    char state;
+
+    stat_scanner scanner(line);
+    scanner >> state >> st.ppid >> st.pgrp >> st.session >> st.tty_nr >>
+        st.tgpid >> st.flags >> st.minflt >> st.cminflt >> st.majflt >>
+        st.cmajflt >> st.utime >> st.stime >> st.cutime >> st.cstime >>
+        st.priority >> st.nice >> st.num_threads >> st.itrealvalue >>
+        st.starttime >> st.vsize >> st.rss >> st.rsslim >> st.startcode >>
+        st.endcode >> st.startstack >> st.kstkesp >> st.kstkeip >> st.signal >>
+        st.blocked >> st.sigignore >> st.sigcatch >> st.wchan >> st.nswap >>
+        st.cnswap >> st.exit_signal >> st.processor >> st.rt_priority >>
+        st.policy >> st.delayacct_blkio_ticks >> st.guest_time >>
+        st.cguest_time >> st.start_data >> st.end_data >> st.start_brk >>
+        st.arg_start >> st.arg_end >> st.env_start >> st.env_end >>
+        st.exit_code;
+
+    // We must have at least everything till 'cnswap'
+    static const int FIELDS_MIN = 35;
+    if (scanner.matches() < FIELDS_MIN)
+    {
+        throw parser_error("Corrupted stat - Not enough tokens",
+                           std::string(line));
+    }
+
+    st.state = parse_task_state(state);
+
+    return st;
+}
+
+} // namespace parsers
+} // namespace impl
+} // namespace pfs
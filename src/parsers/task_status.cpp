@@ -26,17 +26,17 @@ namespace parsers {
 
 namespace {
 
-void parse_name(const std::string& value, task_status& out)
+void parse_name(string_view value, task_status& out)
 {
-    out.name = value;
+    out.name = std::string(value);
 }
 
-void parse_umask(const std::string& value, task_status& out)
+void parse_umask(string_view value, task_status& out)
 {
     to_number("umask", value, utils::base::decimal, out.umask);
 }
 
-void parse_state(const std::string& value, task_status& out)
+void parse_state(string_view value, task_status& out)
 {
     // Format
     // clang-format off
@@ -54,32 +54,32 @@ void parse_state(const std::string& value, task_status& out)
     out.state = parse_task_state(value[0]);
 }
 
-void parse_tgid(const std::string& value, task_status& out)
+void parse_tgid(string_view value, task_status& out)
 {
     to_number("tgid", value, utils::base::decimal, out.tgid);
 }
 
-void parse_ngid(const std::string& value, task_status& out)
+void parse_ngid(string_view value, task_status& out)
 {
     to_number("ngid", value, utils::base::decimal, out.ngid);
 }
 
-void parse_pid(const std::string& value, task_status& out)
+void parse_pid(string_view value, task_status& out)
 {
     to_number("pid", value, utils::base::decimal, out.pid);
 }
 
-void parse_ppid(const std::string& value, task_status& out)
+void parse_ppid(string_view value, task_status& out)
 {
     to_number("ppid", value, utils::base::decimal, out.ppid);
 }
 
-void parse_tracer_pid(const std::string& value, task_status& out)
+void parse_tracer_pid(string_view value, task_status& out)
 {
     to_number("tracer_pid", value, utils::base::decimal, out.tracer_pid);
 }
 
-void to_uid_set(const std::string& value, task_status::uid_set& out)
+void to_uid_set(string_view value, task_status::uid_set& out)
 {
     enum token
     {
@@ -92,8 +92,8 @@ void to_uid_set(const std::string& value, task_status::uid_set& out)
 
     static const char DELIM = '\t';
 
-    auto tokens = utils::split(value, DELIM);
-    if (tokens.size() != COUNT)
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(value, tokens, DELIM) != COUNT)
     {
         throw parser_error("Corrupted uid set - Unexpected tokens count",
                            value);
@@ -120,22 +120,22 @@ void to_uid_set(const std::string& value, task_status::uid_set& out)
     }
 }
 
-void parse_uid(const std::string& value, task_status& out)
+void parse_uid(string_view value, task_status& out)
 {
     to_uid_set(value, out.uid);
 }
 
-void parse_gid(const std::string& value, task_status& out)
+void parse_gid(string_view value, task_status& out)
 {
     to_uid_set(value, out.gid);
 }
 
-void parse_fdsize(const std::string& value, task_status& out)
+void parse_fdsize(string_view value, task_status& out)
 {
     to_number("fd_size", value, utils::base::decimal, out.fd_size);
 }
 
-void parse_groups(const std::string& value, task_status& out)
+void parse_groups(string_view value, task_status& out)
 {
     // This is a valid state, not all users are attached to groups
     if (value.empty())
@@ -145,8 +145,9 @@ void parse_groups(const std::string& value, task_status& out)
 
     try
     {
-        auto tokens = utils::split(value);
-        for (const auto& token : tokens)
+        utils::tokenizer tok(value);
+        string_view token;
+        while (tok.next(token))
         {
             uid_t group;
             utils::stot(token, group);
@@ -163,14 +164,15 @@ void parse_groups(const std::string& value, task_status& out)
     }
 }
 
-void to_ns_ids_vector(const std::string& value, std::vector<pid_t>& out)
+void to_ns_ids_vector(string_view value, std::vector<pid_t>& out)
 {
     try
     {
         static const char DELIM = '\t';
 
-        auto tokens = utils::split(value, DELIM);
-        for (const auto& token : tokens)
+        utils::tokenizer tok(value, DELIM);
+        string_view token;
+        while (tok.next(token))
         {
             pid_t id;
             utils::stot(token, id);
@@ -186,107 +188,107 @@ void to_ns_ids_vector(const std::string& value, std::vector<pid_t>& out)
         throw parser_error("Corrupted id - Out of range", value);
     }
 }
-void parse_ns_tgid(const std::string& value, task_status& out)
+void parse_ns_tgid(string_view value, task_status& out)
 {
     to_ns_ids_vector(value, out.ns_tgid);
 }
 
-void parse_ns_pid(const std::string& value, task_status& out)
+void parse_ns_pid(string_view value, task_status& out)
 {
     to_ns_ids_vector(value, out.ns_pid);
 }
 
-void parse_ns_pgid(const std::string& value, task_status& out)
+void parse_ns_pgid(string_view value, task_status& out)
 {
     to_ns_ids_vector(value, out.ns_pgid);
 }
 
-void parse_ns_sid(const std::string& value, task_status& out)
+void parse_ns_sid(string_view value, task_status& out)
 {
     to_ns_ids_vector(value, out.ns_sid);
 }
 
-void parse_vm_peak(const std::string& value, task_status& out)
+void parse_vm_peak(string_view value, task_status& out)
 {
     utils::parse_memory_size("vm_peak", value, out.vm_peak);
 }
 
-void parse_vm_size(const std::string& value, task_status& out)
+void parse_vm_size(string_view value, task_status& out)
 {
     utils::parse_memory_size("vm_size", value, out.vm_size);
 }
 
-void parse_vm_lck(const std::string& value, task_status& out)
+void parse_vm_lck(string_view value, task_status& out)
 {
     utils::parse_memory_size("vm_lck", value, out.vm_lck);
 }
 
-void parse_vm_pin(const std::string& value, task_status& out)
+void parse_vm_pin(string_view value, task_status& out)
 {
     utils::parse_memory_size("vm_pin", value, out.vm_pin);
 }
 
-void parse_vm_hwm(const std::string& value, task_status& out)
+void parse_vm_hwm(string_view value, task_status& out)
 {
     utils::parse_memory_size("vm_hwm", value, out.vm_hwm);
 }
 
-void parse_vm_rss(const std::string& value, task_status& out)
+void parse_vm_rss(string_view value, task_status& out)
 {
     utils::parse_memory_size("vm_rss", value, out.vm_rss);
 }
 
-void parse_rss_anon(const std::string& value, task_status& out)
+void parse_rss_anon(string_view value, task_status& out)
 {
     utils::parse_memory_size("rss_anon", value, out.rss_anon);
 }
 
-void parse_rss_file(const std::string& value, task_status& out)
+void parse_rss_file(string_view value, task_status& out)
 {
     utils::parse_memory_size("rss_file", value, out.rss_file);
 }
 
-void parse_rss_shmem(const std::string& value, task_status& out)
+void parse_rss_shmem(string_view value, task_status& out)
 {
     utils::parse_memory_size("rss_shmem", value, out.rss_shmem);
 }
 
-void parse_vm_data(const std::string& value, task_status& out)
+void parse_vm_data(string_view value, task_status& out)
 {
     utils::parse_memory_size("vm_data", value, out.vm_data);
 }
 
-void parse_vm_stk(const std::string& value, task_status& out)
+void parse_vm_stk(string_view value, task_status& out)
 {
     utils::parse_memory_size("vm_stk", value, out.vm_stk);
 }
 
-void parse_vm_exe(const std::string& value, task_status& out)
+void parse_vm_exe(string_view value, task_status& out)
 {
     utils::parse_memory_size("vm_exe", value, out.vm_exe);
 }
 
-void parse_vm_lib(const std::string& value, task_status& out)
+void parse_vm_lib(string_view value, task_status& out)
 {
     utils::parse_memory_size("vm_lib", value, out.vm_lib);
 }
 
-void parse_vm_pte(const std::string& value, task_status& out)
+void parse_vm_pte(string_view value, task_status& out)
 {
     utils::parse_memory_size("vm_pte", value, out.vm_pte);
 }
 
-void parse_vm_swap(const std::string& value, task_status& out)
+void parse_vm_swap(string_view value, task_status& out)
 {
     utils::parse_memory_size("vm_swap", value, out.vm_swap);
 }
 
-void parse_huge_tlb_pages(const std::string& value, task_status& out)
+void parse_huge_tlb_pages(string_view value, task_status& out)
 {
     utils::parse_memory_size("huge_tlb_pages", value, out.huge_tlb_pages);
 }
 
-void to_boolean(const std::string& desc, const std::string& value, bool& out)
+void to_boolean(const std::string& desc, string_view value, bool& out)
 {
     if (value.empty())
     {
@@ -308,17 +310,17 @@ void to_boolean(const std::string& desc, const std::string& value, bool& out)
     }
 }
 
-void parse_core_dumping(const std::string& value, task_status& out)
+void parse_core_dumping(string_view value, task_status& out)
 {
     to_boolean("core_dumping", value, out.core_dumping);
 }
 
-void parse_threads(const std::string& value, task_status& out)
+void parse_threads(string_view value, task_status& out)
 {
     to_number("threads", value, utils::base::decimal, out.threads);
 }
 
-void parse_sig_q(const std::string& value, task_status& out)
+void parse_sig_q(string_view value, task_status& out)
 {
     enum token
     {
@@ -329,8 +331,8 @@ void parse_sig_q(const std::string& value, task_status& out)
 
     static const char DELIM = '/';
 
-    auto tokens = utils::split(value, DELIM);
-    if (tokens.size() != COUNT)
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(value, tokens, DELIM) != COUNT)
     {
         throw parser_error("Corrupted sig queue - Unexpected tokens count",
                            value);
@@ -356,72 +358,72 @@ void parse_sig_q(const std::string& value, task_status& out)
     }
 }
 
-void to_signal_mask(const std::string& desc, const std::string& value, signal_mask& mask)
+void to_signal_mask(const std::string& desc, string_view value, signal_mask& mask)
 {
     to_number(desc, value, utils::base::hex, mask.raw);
 }
 
-void parse_sig_pnd(const std::string& value, task_status& out)
+void parse_sig_pnd(string_view value, task_status& out)
 {
     to_signal_mask("sig_pnd", value, out.sig_pnd);
 }
 
-void parse_shd_pnd(const std::string& value, task_status& out)
+void parse_shd_pnd(string_view value, task_status& out)
 {
     to_signal_mask("shd_pnd", value, out.shd_pnd);
 }
 
-void parse_sig_blk(const std::string& value, task_status& out)
+void parse_sig_blk(string_view value, task_status& out)
 {
     to_signal_mask("sig_blk", value, out.sig_blk);
 }
 
-void parse_sig_ign(const std::string& value, task_status& out)
+void parse_sig_ign(string_view value, task_status& out)
 {
     to_signal_mask("sig_ign", value, out.sig_ign);
 }
 
-void parse_sig_cgt(const std::string& value, task_status& out)
+void parse_sig_cgt(string_view value, task_status& out)
 {
     to_signal_mask("sig_cgt", value, out.sig_cgt);
 }
 
-void to_capabilities_mask(const std::string& desc, const std::string& value, capabilities_mask& mask)
+void to_capabilities_mask(const std::string& desc, string_view value, capabilities_mask& mask)
 {
     to_number(desc, value, utils::base::hex, mask.raw);
 }
 
-void parse_cap_inh(const std::string& value, task_status& out)
+void parse_cap_inh(string_view value, task_status& out)
 {
     to_capabilities_mask("cap_inh", value, out.cap_inh);
 }
 
-void parse_cap_prm(const std::string& value, task_status& out)
+void parse_cap_prm(string_view value, task_status& out)
 {
     to_capabilities_mask("cap_prm", value, out.cap_prm);
 }
 
-void parse_cap_eff(const std::string& value, task_status& out)
+void parse_cap_eff(string_view value, task_status& out)
 {
     to_capabilities_mask("cap_eff", value, out.cap_eff);
 }
 
-void parse_cap_bnd(const std::string& value, task_status& out)
+void parse_cap_bnd(string_view value, task_status& out)
 {
     to_capabilities_mask("cap_bnd", value, out.cap_bnd);
 }
 
-void parse_cap_amb(const std::string& value, task_status& out)
+void parse_cap_amb(string_view value, task_status& out)
 {
     to_capabilities_mask("cap_amb", value, out.cap_amb);
 }
 
-void parse_no_new_privs(const std::string& value, task_status& out)
+void parse_no_new_privs(string_view value, task_status& out)
 {
     to_boolean("no_new_privs", value, out.no_new_privs);
 }
 
-void parse_seccomp(const std::string& value, task_status& out)
+void parse_seccomp(string_view value, task_status& out)
 {
     unsigned numeric;
     to_number("seccomp", value, utils::base::decimal, numeric);
@@ -436,12 +438,12 @@ void parse_seccomp(const std::string& value, task_status& out)
     out.seccomp_mode = mode;
 }
 
-void parse_voluntary_ctx_switches(const std::string& value, task_status& out)
+void parse_voluntary_ctx_switches(string_view value, task_status& out)
 {
     to_number("voluntary_ctxt_switches", value, utils::base::decimal, out.voluntary_ctxt_switches);
 }
 
-void parse_nonvoluntary_ctx_switches(const std::string& value, task_status& out)
+void parse_nonvoluntary_ctx_switches(string_view value, task_status& out)
 {
     to_number("nonvoluntary_ctxt_switches", value, utils::base::decimal, out.nonvoluntary_ctxt_switches);
 }
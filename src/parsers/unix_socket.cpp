@@ -27,7 +27,7 @@ namespace parsers {
 
 namespace {
 
-unix_socket::type parse_type(const std::string& type_str)
+unix_socket::type parse_type(string_view type_str)
 {
     int type_int;
     utils::stot(type_str, type_int, utils::base::hex);
@@ -42,7 +42,7 @@ unix_socket::type parse_type(const std::string& type_str)
     return type;
 }
 
-unix_socket::state parse_state(const std::string& state_str)
+unix_socket::state parse_state(string_view state_str)
 {
     int state_int;
     utils::stot(state_str, state_int);
@@ -60,7 +60,7 @@ unix_socket::state parse_state(const std::string& state_str)
 
 } // anonymous namespace
 
-unix_socket parse_unix_socket_line(const std::string& line)
+void parse_unix_socket_line_into(string_view line, unix_socket& sock)
 {
     // Some examples:
     // clang-format off
@@ -86,8 +86,9 @@ unix_socket parse_unix_socket_line(const std::string& line)
         COUNT
     };
 
-    auto tokens = utils::split(line);
-    if (tokens.size() < MIN_COUNT)
+    std::array<string_view, COUNT> tokens;
+    size_t count = utils::split(line, tokens);
+    if (count < MIN_COUNT)
     {
         throw parser_error(
             "Corrupted unix socket line - Unexpected token count", line);
@@ -95,8 +96,6 @@ unix_socket parse_unix_socket_line(const std::string& line)
 
     try
     {
-        unix_socket sock;
-
         utils::stot(tokens[SKBUFF], sock.skbuff, utils::base::hex);
 
         utils::stot(tokens[REF_COUNT], sock.ref_count, utils::base::hex);
@@ -111,12 +110,13 @@ unix_socket parse_unix_socket_line(const std::string& line)
 
         utils::stot(tokens[INODE], sock.inode);
 
-        if (tokens.size() > PATH) {
-            size_t path_start = line.find(tokens[PATH]);
-            sock.path = line.substr(path_start);
+        if (count > PATH) {
+            size_t path_start = tokens[PATH].data() - line.data();
+            sock.path.assign(line.data() + path_start,
+                             line.size() - path_start);
+        } else {
+            sock.path.clear();
         }
-
-        return sock;
     }
     catch (const std::invalid_argument& ex)
     {
@@ -128,6 +128,13 @@ unix_socket parse_unix_socket_line(const std::string& line)
     }
 }
 
+unix_socket parse_unix_socket_line(const std::string& line)
+{
+    unix_socket sock;
+    parse_unix_socket_line_into(line, sock);
+    return sock;
+}
+
 } // namespace parsers
 } // namespace impl
 } // namespace pfs
@@ -36,8 +36,8 @@ uptime parse_uptime_line(const std::string& line)
         COUNT
     };
 
-    auto tokens = utils::split(line);
-    if (tokens.size() != COUNT)
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(line, tokens) != COUNT)
     {
         throw parser_error("Corrupted uptime - Unexpected tokens count", line);
     }
@@ -49,8 +49,8 @@ uptime parse_uptime_line(const std::string& line)
         double system_time;
         double idle_time;
 
-        system_time = std::stod(tokens[SYSTEM_TIME]);
-        idle_time = std::stod(tokens[IDLE_TIME]);
+        system_time = std::stod(std::string(tokens[SYSTEM_TIME]));
+        idle_time = std::stod(std::string(tokens[IDLE_TIME]));
 
         system_uptime.system_time = std::chrono::duration_cast<
             std::chrono::steady_clock::duration
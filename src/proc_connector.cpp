@@ -0,0 +1,285 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include "pfs/proc_connector.hpp"
+
+namespace pfs {
+namespace impl {
+namespace proc_connector {
+
+namespace {
+
+// Large enough for a batch of events, each of which takes less than 100 bytes
+static const size_t RECV_BUFFER_SIZE = 16 * 1024;
+
+// Events are multicast to all the listeners as they happen, so a bigger
+// socket buffer absorbs bursts of process creation between two polls.
+// The kernel caps the size to net.core.rmem_max.
+static const int SOCKET_BUFFER_SIZE = 4 * 1024 * 1024;
+
+// The kernel acknowledges the subscription synchronously, so the ack is
+// expected to be queued as soon as the request is sent
+static const int ACK_TIMEOUT_MS = 1000;
+
+bool send_op(int fd, proc_cn_mcast_op op, uint32_t ack)
+{
+    char request[NLMSG_SPACE(sizeof(cn_msg) + sizeof(op))];
+    memset(request, 0, sizeof(request));
+
+    auto header        = reinterpret_cast<nlmsghdr*>(request);
+    header->nlmsg_len  = sizeof(request);
+    header->nlmsg_type = NLMSG_DONE;
+    header->nlmsg_pid  = 0;
+
+    auto msg    = static_cast<cn_msg*>(NLMSG_DATA(header));
+    msg->id.idx = CN_IDX_PROC;
+    msg->id.val = CN_VAL_PROC;
+    msg->ack    = ack;
+    msg->len    = sizeof(op);
+    memcpy(msg->data, &op, sizeof(op));
+
+    return send(fd, request, sizeof(request), 0) ==
+           static_cast<ssize_t>(sizeof(request));
+}
+
+using message_visitor =
+    std::function<void(const cn_msg& msg, const proc_event& event)>;
+
+// Hand every proc connector event in a datagram to the visitor
+void parse_datagram(const char* buffer, size_t size,
+                    const message_visitor& visit)
+{
+    auto header = reinterpret_cast<const nlmsghdr*>(buffer);
+    while (size >= sizeof(nlmsghdr) && header->nlmsg_len >= sizeof(nlmsghdr) &&
+           header->nlmsg_len <= size)
+    {
+        if (header->nlmsg_len >=
+            NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_event)))
+        {
+            auto msg = static_cast<const cn_msg*>(NLMSG_DATA(header));
+            if (msg->id.idx == CN_IDX_PROC && msg->id.val == CN_VAL_PROC)
+            {
+                proc_event event;
+                memcpy(&event, msg->data, sizeof(event));
+                visit(*msg, event);
+            }
+        }
+
+        size_t aligned = NLMSG_ALIGN(header->nlmsg_len);
+        if (aligned >= size)
+        {
+            break;
+        }
+        size -= aligned;
+        header = reinterpret_cast<const nlmsghdr*>(
+            reinterpret_cast<const char*>(header) + aligned);
+    }
+}
+
+// Wait for the kernel to acknowledge the subscription request.
+// The ack carries the ack number of the request plus one, and is multicast
+// to all the listeners, so the acks of other subscribers are skipped, along
+// with any events received in the meantime.
+bool wait_for_ack(int fd, uint32_t ack)
+{
+    char buffer[RECV_BUFFER_SIZE];
+    while (true)
+    {
+        pollfd pfd;
+        pfd.fd     = fd;
+        pfd.events = POLLIN;
+        int ready  = ::poll(&pfd, 1, ACK_TIMEOUT_MS);
+        if (ready < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (ready <= 0)
+        {
+            return false;
+        }
+
+        ssize_t bytes = recv(fd, buffer, sizeof(buffer), 0);
+        if (bytes < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN || errno == ENOBUFS)
+            {
+                continue;
+            }
+            return false;
+        }
+
+        bool acked   = false;
+        bool granted = false;
+        parse_datagram(buffer, static_cast<size_t>(bytes),
+                       [&](const cn_msg& msg, const proc_event& event) {
+                           if (event.what == proc_event::PROC_EVENT_NONE &&
+                               msg.ack == ack + 1)
+                           {
+                               acked   = true;
+                               granted = event.event_data.ack.err == 0;
+                           }
+                       });
+        if (acked)
+        {
+            return granted;
+        }
+    }
+}
+
+} // anonymous namespace
+
+int subscribe()
+{
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                    NETLINK_CONNECTOR);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    sockaddr_nl local;
+    memset(&local, 0, sizeof(local));
+    local.nl_family = AF_NETLINK;
+    local.nl_groups = CN_IDX_PROC;
+
+    socklen_t local_size = sizeof(local);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr*>(&local), &local_size) !=
+            0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // Best effort, the default size still works, only overflows sooner
+    (void)setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &SOCKET_BUFFER_SIZE,
+                     sizeof(SOCKET_BUFFER_SIZE));
+
+    // The port ID is unique per socket, which makes it a good ack number
+    uint32_t ack = local.nl_pid;
+    if (!send_op(fd, PROC_CN_MCAST_LISTEN, ack) || !wait_for_ack(fd, ack))
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+void unsubscribe(int fd)
+{
+    // The kernel counts the listeners, and only stops generating events once
+    // all of them explicitly unsubscribe
+    (void)send_op(fd, PROC_CN_MCAST_IGNORE, 0);
+    close(fd);
+}
+
+bool receive(int fd, const visitor& visit)
+{
+    bool complete = true;
+
+    char buffer[RECV_BUFFER_SIZE];
+    while (true)
+    {
+        ssize_t bytes = recv(fd, buffer, sizeof(buffer), 0);
+        if (bytes < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            // Events were dropped, but the ones that follow are still queued
+            if (errno == ENOBUFS)
+            {
+                complete = false;
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return complete;
+            }
+
+            throw std::system_error(errno, std::system_category(),
+                                    "Couldn't receive proc connector events");
+        }
+
+        parse_datagram(buffer, static_cast<size_t>(bytes),
+                       [&visit](const cn_msg&, const proc_event& event) {
+                           visit(event);
+                       });
+    }
+}
+
+bool parse_proc_event(const proc_event& event, process_event& out)
+{
+    out = process_event();
+
+    switch (event.what)
+    {
+        case proc_event::PROC_EVENT_FORK:
+        {
+            const auto& fork = event.event_data.fork;
+            if (fork.child_pid != fork.child_tgid)
+            {
+                return false; // A new thread
+            }
+            out.what       = process_event::type::fork;
+            out.pid        = fork.child_tgid;
+            out.parent_pid = fork.parent_tgid;
+            return true;
+        }
+
+        case proc_event::PROC_EVENT_EXEC:
+            // A thread that execs takes over the ID of the process
+            out.what = process_event::type::exec;
+            out.pid  = event.event_data.exec.process_tgid;
+            return true;
+
+        case proc_event::PROC_EVENT_EXIT:
+        {
+            const auto& exit = event.event_data.exit;
+            if (exit.process_pid != exit.process_tgid)
+            {
+                return false; // A thread
+            }
+            out.what      = process_event::type::exit;
+            out.pid       = exit.process_tgid;
+            out.exit_code = static_cast<int>(exit.exit_code);
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+} // namespace proc_connector
+} // namespace impl
+} // namespace pfs
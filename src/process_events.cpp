@@ -0,0 +1,277 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include <poll.h>
+
+#include <algorithm>
+#include <iterator>
+#include <system_error>
+
+#include "pfs/proc_connector.hpp"
+#include "pfs/process_events.hpp"
+#include "pfs/utils.hpp"
+
+namespace pfs {
+
+using namespace impl;
+
+namespace {
+
+std::string build_root(std::string root)
+{
+    utils::ensure_dir_terminator(root);
+    return root;
+}
+
+} // anonymous namespace
+
+process_events::process_events(const std::string& procfs_root)
+    : _procfs(procfs_root), _root(build_root(procfs_root))
+{
+    reconcile();
+}
+
+process_events::~process_events()
+{
+    if (_fd >= 0)
+    {
+        proc_connector::unsubscribe(_fd);
+    }
+}
+
+bool process_events::subscribe()
+{
+    if (_fd >= 0)
+    {
+        return true;
+    }
+
+    // Events carry the IDs of the initial PID namespace, which only the
+    // host's procfs reflects
+    if (_root != procfs::DEFAULT_ROOT)
+    {
+        return false;
+    }
+
+    _fd = proc_connector::subscribe();
+    if (_fd < 0)
+    {
+        return false;
+    }
+
+    reconcile();
+    return true;
+}
+
+size_t process_events::poll(int timeout_ms, const visitor& visit)
+{
+    if (_fd < 0)
+    {
+        return 0;
+    }
+
+    if (timeout_ms != 0)
+    {
+        pollfd pfd;
+        pfd.fd     = _fd;
+        pfd.events = POLLIN;
+        if (::poll(&pfd, 1, timeout_ms) < 0 && errno != EINTR)
+        {
+            throw std::system_error(errno, std::system_category(),
+                                    "Couldn't wait for proc connector events");
+        }
+    }
+
+    size_t changes = 0;
+    process_event event;
+    bool complete =
+        proc_connector::receive(_fd, [&](const proc_event& raw) {
+            if (proc_connector::parse_proc_event(raw, event) &&
+                apply(event, visit))
+            {
+                ++changes;
+            }
+        });
+
+    if (!complete)
+    {
+        changes += reconcile(visit);
+    }
+    else
+    {
+        // The last thread of a process whose exit is pending might have
+        // exited since, which isn't reported as the exit of the process
+        changes += apply_pending_exits(visit);
+    }
+
+    return changes;
+}
+
+size_t process_events::reconcile(const visitor& visit)
+{
+    // Before the rescan, so reaped processes are visited with their
+    // reported exit rather than a reconciled one
+    size_t changes = apply_pending_exits(visit);
+
+    auto pids = utils::enumerate_numeric_files(_root);
+
+    std::vector<int> exited;
+    std::set_difference(_pids.begin(), _pids.end(), pids.begin(), pids.end(),
+                        std::back_inserter(exited));
+
+    std::vector<int> started;
+    std::set_difference(pids.begin(), pids.end(), _pids.begin(), _pids.end(),
+                        std::back_inserter(started));
+
+    process_event event;
+    event.reconciled = true;
+
+    event.what = process_event::type::exit;
+    for (int pid : exited)
+    {
+        event.pid = pid;
+        changes += apply(event, visit) ? 1 : 0;
+    }
+
+    event.what = process_event::type::fork;
+    for (int pid : started)
+    {
+        if (is_zombie(pid))
+        {
+            continue;
+        }
+
+        event.pid = pid;
+        changes += apply(event, visit) ? 1 : 0;
+    }
+
+    return changes;
+}
+
+std::vector<task_ref> process_events::list_processes() const
+{
+    return task_ref::make_refs(_root,
+                               std::vector<int>(_pids.begin(), _pids.end()));
+}
+
+bool process_events::apply(const process_event& event, const visitor& visit)
+{
+    bool changed;
+    switch (event.what)
+    {
+        case process_event::type::fork:
+        {
+            // An ID is only reused once the previous process was reaped
+            auto pending = _pending_exits.find(event.pid);
+            if (pending != _pending_exits.end())
+            {
+                auto exit = pending->second;
+                _pending_exits.erase(pending);
+                _pids.erase(exit.pid);
+                if (visit)
+                {
+                    visit(exit);
+                }
+            }
+
+            changed = _pids.insert(event.pid).second;
+            break;
+        }
+
+        case process_event::type::exec:
+            // Also covers processes whose fork was lost
+            _pids.insert(event.pid);
+            _pending_exits.erase(event.pid);
+            changed = true;
+            break;
+
+        case process_event::type::exit:
+            // Reconciled exits are already known to be gone
+            if (event.reconciled || is_zombie(event.pid))
+            {
+                _pending_exits.erase(event.pid);
+                changed = _pids.erase(event.pid) != 0;
+            }
+            else
+            {
+                if (contains(event.pid))
+                {
+                    _pending_exits[event.pid] = event;
+                }
+                changed = false;
+            }
+            break;
+
+        default:
+            changed = false;
+            break;
+    }
+
+    if (changed && visit)
+    {
+        visit(event);
+    }
+    return changed;
+}
+
+size_t process_events::apply_pending_exits(const visitor& visit)
+{
+    size_t changes = 0;
+
+    auto iter = _pending_exits.begin();
+    while (iter != _pending_exits.end())
+    {
+        if (!is_zombie(iter->first))
+        {
+            ++iter;
+            continue;
+        }
+
+        auto event = iter->second;
+        iter       = _pending_exits.erase(iter);
+
+        if (_pids.erase(event.pid) != 0)
+        {
+            ++changes;
+            if (visit)
+            {
+                visit(event);
+            }
+        }
+    }
+
+    return changes;
+}
+
+bool process_events::is_zombie(int pid) const
+{
+    try
+    {
+        // The main thread of a process stays a zombie until all the other
+        // threads exit
+        auto stat = _procfs.get_task(pid).get_stat();
+        return (stat.state == task_state::zombie ||
+                stat.state == task_state::dead) &&
+               stat.num_threads <= 1;
+    }
+    catch (const std::system_error&)
+    {
+        return true; // Already reaped
+    }
+}
+
+} // namespace pfs
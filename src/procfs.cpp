@@ -14,6 +14,7 @@
  *  limitations under the License.
  */
 
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -21,6 +22,10 @@
 #include <iterator>
 #include <system_error>
 
+#include "pfs/defer.hpp"
+#include "pfs/parser_error.hpp"
+#include "pfs/parsers/common.hpp"
+
 #include "pfs/parsers/filesystems.hpp"
 #include "pfs/parsers/meminfo.hpp"
 #include "pfs/parsers/buddyinfo.hpp"
@@ -71,19 +76,204 @@ task procfs::get_task(int task_id) const
     return task(_root, task_id);
 }
 
-std::set<task> procfs::get_processes(task::task_filter filter) const
+std::set<task> procfs::get_processes(task::task_filter filter,
+                                     size_t threads) const
+{
+    auto ids = utils::enumerate_numeric_files(_root);
+    return task::filter_tasks(_root, ids, filter, threads);
+}
+
+std::vector<task_ref> procfs::list_processes() const
+{
+    return task_ref::make_refs(_root, utils::enumerate_numeric_files(_root));
+}
+
+namespace {
+
+bool is_task_gone(const std::system_error& err)
+{
+    return err.code() == std::errc::no_such_file_or_directory ||
+           err.code() == std::errc::no_such_process;
+}
+
+// Collect a single field of a task into 'out'.
+// Returns whether the field was collected. Fields might be unavailable, e.g.
+// when access to the file is denied, or when its content can't be parsed.
+// Throws if the task is gone.
+template <typename T, typename Getter>
+bool collect_field(Getter getter, T& out)
+{
+    try
+    {
+        out = getter();
+        return true;
+    }
+    catch (const std::system_error& err)
+    {
+        if (is_task_gone(err))
+        {
+            throw;
+        }
+        return false;
+    }
+    catch (const parser_error&)
+    {
+        return false;
+    }
+}
+
+} // anonymous namespace
+
+// The data collected for a single task, see 'procfs::snapshot'
+struct procfs::snapshot_entry
+{
+    bool alive         = false;
+    unsigned collected = 0;
+    task_stat stat;
+    task_status status;
+    io_stats io{};
+    mem_stats statm{};
+    std::vector<std::string> cmdline;
+    std::vector<mem_region> maps;
+};
+
+void procfs::collect_task(const task& unpinned, unsigned fields,
+                          string_pool& pool, snapshot_entry& out)
+{
+    try
+    {
+        auto t = unpinned.pin_directory();
+
+        if ((fields & task_fields::stat) &&
+            collect_field([&t] { return t.get_stat(); }, out.stat))
+        {
+            out.collected |= task_fields::stat;
+        }
+
+        if ((fields & task_fields::status) &&
+            collect_field([&t] { return t.get_status(); }, out.status))
+        {
+            out.collected |= task_fields::status;
+        }
+
+        if ((fields & task_fields::io) &&
+            collect_field([&t] { return t.get_io(); }, out.io))
+        {
+            out.collected |= task_fields::io;
+        }
+
+        if ((fields & task_fields::statm) &&
+            collect_field([&t] { return t.get_statm(); }, out.statm))
+        {
+            out.collected |= task_fields::statm;
+        }
+
+        if ((fields & task_fields::cmdline) &&
+            collect_field([&t] { return t.get_cmdline(); }, out.cmdline))
+        {
+            out.collected |= task_fields::cmdline;
+        }
+
+        if ((fields & task_fields::maps) &&
+            collect_field([&t, &pool] { return t.get_maps(&pool); }, out.maps))
+        {
+            out.collected |= task_fields::maps;
+        }
+
+        out.alive = true;
+    }
+    catch (const std::system_error& err)
+    {
+        if (!is_task_gone(err))
+        {
+            throw;
+        }
+    }
+}
+
+task_snapshot procfs::snapshot(unsigned fields, size_t threads) const
 {
-    std::set<task> tasks;
-    for (auto task_id : utils::enumerate_numeric_files(_root))
+    auto ids = utils::enumerate_numeric_files(_root);
+
+    // Every worker fills its own slots, and the slots are merged in order
+    // afterwards, so the output is the same for any number of threads
+    std::vector<snapshot_entry> entries(ids.size());
+    string_pool pool;
+    utils::parallel_for(ids.size(), threads, [&](size_t i) {
+        collect_task(get_task(ids[i]), fields, pool, entries[i]);
+    });
+
+    size_t alive = 0;
+    for (const auto& entry : entries)
+    {
+        alive += entry.alive ? 1 : 0;
+    }
+
+    task_snapshot out;
+    out.ids.reserve(alive);
+    out.collected.reserve(alive);
+    if (fields & task_fields::stat)
+    {
+        out.stat.reserve(alive);
+    }
+    if (fields & task_fields::status)
+    {
+        out.status.reserve(alive);
+    }
+    if (fields & task_fields::io)
+    {
+        out.io.reserve(alive);
+    }
+    if (fields & task_fields::statm)
+    {
+        out.statm.reserve(alive);
+    }
+    if (fields & task_fields::cmdline)
+    {
+        out.cmdline.reserve(alive);
+    }
+    if (fields & task_fields::maps)
+    {
+        out.maps.reserve(alive);
+    }
+
+    for (size_t i = 0; i < entries.size(); ++i)
     {
-        auto t = get_task(task_id);
-        if (!filter || filter(t) == filter::action::keep)
+        auto& entry = entries[i];
+        if (!entry.alive)
+        {
+            continue; // Task died during the snapshot, skip it
+        }
+
+        out.ids.push_back(ids[i]);
+        out.collected.push_back(entry.collected);
+        if (fields & task_fields::stat)
+        {
+            out.stat.push_back(std::move(entry.stat));
+        }
+        if (fields & task_fields::status)
+        {
+            out.status.push_back(std::move(entry.status));
+        }
+        if (fields & task_fields::io)
+        {
+            out.io.push_back(entry.io);
+        }
+        if (fields & task_fields::statm)
+        {
+            out.statm.push_back(entry.statm);
+        }
+        if (fields & task_fields::cmdline)
+        {
+            out.cmdline.push_back(std::move(entry.cmdline));
+        }
+        if (fields & task_fields::maps)
         {
-            tasks.emplace(std::move(t));
+            out.maps.push_back(std::move(entry.maps));
         }
     }
 
-    return tasks;
+    return out;
 }
 
 net procfs::get_net(int task_id) const
@@ -91,6 +281,120 @@ net procfs::get_net(int task_id) const
     return get_task(task_id).get_net();
 }
 
+namespace {
+
+// Collect the socket fds of a process.
+// Returns false if the process is gone.
+bool collect_socket_fds(const std::string& root, int pid,
+                        socket_owner_index::process_sockets& out)
+{
+    static const std::string FDS_DIR("/fd/");
+    static const std::string CURRENT_DIR(".");
+
+    // Large enough for any socket link, longer targets aren't sockets anyway
+    static const size_t LINK_BUFFER_SIZE = 64;
+
+    auto path = root + std::to_string(pid) + FDS_DIR;
+    int fds_dirfd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fds_dirfd < 0)
+    {
+        if (errno == EACCES)
+        {
+            return true;
+        }
+        if (errno == ENOENT || errno == ESRCH)
+        {
+            return false;
+        }
+        throw std::system_error(errno, std::system_category(),
+                                "Couldn't open fd directory");
+    }
+    defer close_fds_dir([fds_dirfd] { close(fds_dirfd); });
+
+    auto handle = [&out, fds_dirfd](const char* name) {
+        char link[LINK_BUFFER_SIZE];
+        auto bytes = readlinkat(fds_dirfd, name, link, sizeof(link));
+        if (bytes < 0)
+        {
+            return; // The fd was closed in the meantime
+        }
+
+        ino64_t inode;
+        if (!parsers::parse_socket_link(string_view(link, bytes), inode))
+        {
+            return;
+        }
+
+        int fd;
+        if (utils::parse_numeric_file_name(name, fd))
+        {
+            out.emplace_back(fd, inode);
+        }
+    };
+
+    try
+    {
+        utils::iterate_files(CURRENT_DIR, false /* include_dots */, handle,
+                             fds_dirfd);
+    }
+    catch (const std::system_error& err)
+    {
+        if (is_task_gone(err))
+        {
+            return false;
+        }
+        throw;
+    }
+
+    return true;
+}
+
+} // anonymous namespace
+
+socket_owner_index procfs::get_socket_owners(size_t threads) const
+{
+    socket_owner_index index;
+    refresh_socket_owners(index, threads);
+    return index;
+}
+
+bool procfs::refresh_socket_owners(socket_owner_index& index,
+                                   size_t threads) const
+{
+    auto ids = utils::enumerate_numeric_files(_root);
+
+    bool changed = index.retain(ids);
+    changed |= rescan_socket_owners(index, ids, threads);
+    return changed;
+}
+
+bool procfs::rescan_socket_owners(socket_owner_index& index,
+                                  const std::vector<int>& pids,
+                                  size_t threads) const
+{
+    // Workers only read the fds, the index is updated afterwards in order
+    std::vector<socket_owner_index::process_sockets> sockets(pids.size());
+    // Not a vector<bool>, since the workers write to it concurrently
+    std::vector<char> alive(pids.size(), false);
+    utils::parallel_for(pids.size(), threads, [&](size_t i) {
+        alive[i] = collect_socket_fds(_root, pids[i], sockets[i]);
+    });
+
+    bool changed = false;
+    for (size_t i = 0; i < pids.size(); ++i)
+    {
+        if (alive[i])
+        {
+            changed |= index.update(pids[i], std::move(sockets[i]));
+        }
+        else
+        {
+            changed |= index.remove(pids[i]);
+        }
+    }
+    return changed;
+}
+
 std::vector<zone> procfs::get_buddyinfo() const
 {
     static const std::string BUDDYINFO_FILE("buddyinfo");
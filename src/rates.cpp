@@ -0,0 +1,268 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <stdexcept>
+
+#include "pfs/rates.hpp"
+
+namespace pfs {
+
+using namespace impl;
+
+namespace {
+
+double seconds_between(rate_clock::time_point previous,
+                       rate_clock::time_point current)
+{
+    return std::chrono::duration<double>(current - previous).count();
+}
+
+double per_second(unsigned long long previous, unsigned long long current,
+                  double seconds)
+{
+    return counter_delta(previous, current) / seconds;
+}
+
+cpu_usage calculate_usage(const proc_stat::cpu& previous,
+                          const proc_stat::cpu& current)
+{
+    auto user    = counter_delta(previous.user, current.user);
+    auto nice    = counter_delta(previous.nice, current.nice);
+    auto system  = counter_delta(previous.system, current.system);
+    auto idle    = counter_delta(previous.idle, current.idle);
+    auto iowait  = counter_delta(previous.iowait, current.iowait);
+    auto irq     = counter_delta(previous.irq, current.irq);
+    auto softirq = counter_delta(previous.softirq, current.softirq);
+    auto steal   = counter_delta(previous.steal, current.steal);
+
+    // Guest time is already accounted for in user and nice
+    double total = static_cast<double>(user + nice + system + idle + iowait +
+                                       irq + softirq + steal);
+
+    cpu_usage usage;
+    if (total == 0)
+    {
+        return usage;
+    }
+
+    usage.user       = user / total;
+    usage.nice       = nice / total;
+    usage.system     = system / total;
+    usage.idle       = idle / total;
+    usage.iowait     = iowait / total;
+    usage.irq        = irq / total;
+    usage.softirq    = softirq / total;
+    usage.steal      = steal / total;
+    usage.guest      = counter_delta(previous.guest, current.guest) / total;
+    usage.guest_nice =
+        counter_delta(previous.guest_nice, current.guest_nice) / total;
+    return usage;
+}
+
+} // anonymous namespace
+
+bool cpu_rate_tracker::update(const proc_stat& stat)
+{
+    _cpus.begin();
+    for (size_t i = 0; i < stat.cpus.per_item.size(); ++i)
+    {
+        const auto& cpu = stat.cpus.per_item[i];
+        _cpus.add(cpu.id >= 0 ? cpu.id : static_cast<int>(i), cpu);
+    }
+
+    _per_cpu.clear();
+    _cpus.commit([this](int id, const proc_stat::cpu& previous,
+                        const proc_stat::cpu& current) {
+        _per_cpu.push_back(calculate_usage(previous, current));
+        _per_cpu.back().cpu = id;
+    });
+
+    bool has_rates = _has_previous;
+    if (has_rates)
+    {
+        _total = calculate_usage(_previous_total, stat.cpus.total);
+    }
+
+    _previous_total = stat.cpus.total;
+    _has_previous   = true;
+    return has_rates;
+}
+
+task_rate_tracker::task_rate_tracker(long ticks_per_second)
+    : _ticks_per_second(static_cast<double>(
+          ticks_per_second > 0 ? ticks_per_second : sysconf(_SC_CLK_TCK)))
+{}
+
+bool task_rate_tracker::update(const task_snapshot& snapshot,
+                               rate_clock::time_point now)
+{
+    if (snapshot.collected.size() != snapshot.size())
+    {
+        throw std::invalid_argument("Snapshot columns are inconsistent");
+    }
+
+    if (snapshot.stat.size() != snapshot.size())
+    {
+        throw std::invalid_argument("Snapshot doesn't include stat");
+    }
+
+    bool has_io_column = snapshot.io.size() == snapshot.size();
+
+    _tasks.begin();
+    for (size_t i = 0; i < snapshot.size(); ++i)
+    {
+        // Without stat, the task can't be told apart from a recycled ID
+        if (!(snapshot.collected[i] & task_fields::stat))
+        {
+            continue;
+        }
+
+        const auto& stat = snapshot.stat[i];
+
+        counters sample;
+        sample.utime  = stat.utime;
+        sample.stime  = stat.stime;
+        sample.has_io = has_io_column &&
+                        (snapshot.collected[i] & task_fields::io);
+        sample.io     = sample.has_io ? snapshot.io[i] : io_stats{};
+
+        _tasks.add(key(snapshot.ids[i], stat.starttime), sample);
+    }
+
+    double seconds = seconds_between(_previous_time, now);
+    bool has_rates = _has_previous && seconds > 0;
+
+    _rates.clear();
+    _tasks.commit([&](const key& task, const counters& previous,
+                      const counters& current) {
+        if (!has_rates)
+        {
+            return;
+        }
+
+        double cpu_seconds = _ticks_per_second * seconds;
+
+        task_rates rates{};
+        rates.pid        = task.first;
+        rates.starttime  = task.second;
+        rates.user_cpu   = counter_delta(previous.utime, current.utime) /
+                         cpu_seconds;
+        rates.system_cpu = counter_delta(previous.stime, current.stime) /
+                           cpu_seconds;
+
+        rates.has_io = previous.has_io && current.has_io;
+        if (rates.has_io)
+        {
+            const auto& prev = previous.io;
+            const auto& curr = current.io;
+
+            rates.rchar       = per_second(prev.rchar, curr.rchar, seconds);
+            rates.wchar       = per_second(prev.wchar, curr.wchar, seconds);
+            rates.syscr       = per_second(prev.syscr, curr.syscr, seconds);
+            rates.syscw       = per_second(prev.syscw, curr.syscw, seconds);
+            rates.read_bytes  = per_second(prev.read_bytes, curr.read_bytes,
+                                           seconds);
+            rates.write_bytes = per_second(prev.write_bytes, curr.write_bytes,
+                                           seconds);
+            rates.cancelled_write_bytes =
+                per_second(prev.cancelled_write_bytes,
+                           curr.cancelled_write_bytes, seconds);
+        }
+
+        _rates.push_back(rates);
+    });
+
+    _previous_time = now;
+    _has_previous  = true;
+    return has_rates;
+}
+
+bool block_rate_tracker::update(
+    const std::vector<std::pair<dev_t, block_stat>>& stats,
+    rate_clock::time_point now)
+{
+    // The kernel always counts in 512 bytes sectors, regardless of the
+    // actual sector size of the device
+    static const double SECTOR_SIZE = 512;
+    static const double MS_PER_SECOND = 1000;
+
+    _devices.begin();
+    for (const auto& device : stats)
+    {
+        _devices.add(device.first, device.second);
+    }
+
+    double seconds = seconds_between(_previous_time, now);
+    bool has_rates = _has_previous && seconds > 0;
+
+    _rates.clear();
+    _devices.commit([&](dev_t dev, const block_stat& previous,
+                        const block_stat& current) {
+        if (!has_rates)
+        {
+            return;
+        }
+
+        auto read_ios  = counter_delta(previous.read_ios, current.read_ios);
+        auto write_ios = counter_delta(previous.write_ios, current.write_ios);
+
+        block_rates rates{};
+        rates.dev       = dev;
+        rates.read_ios  = read_ios / seconds;
+        rates.write_ios = write_ios / seconds;
+        rates.read_bytes =
+            counter_delta(previous.read_sectors, current.read_sectors) *
+            SECTOR_SIZE / seconds;
+        rates.write_bytes =
+            counter_delta(previous.write_sectors, current.write_sectors) *
+            SECTOR_SIZE / seconds;
+        rates.discard_ios = per_second(previous.discard_ios,
+                                       current.discard_ios, seconds);
+        rates.flush_ios   = per_second(previous.flush_ios, current.flush_ios,
+                                       seconds);
+
+        if (read_ios > 0)
+        {
+            rates.read_await = static_cast<double>(counter_delta(
+                                   previous.read_ticks, current.read_ticks)) /
+                               read_ios;
+        }
+
+        if (write_ios > 0)
+        {
+            rates.write_await = static_cast<double>(counter_delta(
+                                    previous.write_ticks, current.write_ticks)) /
+                                write_ios;
+        }
+
+        double elapsed_ms = seconds * MS_PER_SECOND;
+        rates.utilization = std::min(
+            1.0, counter_delta(previous.io_ticks, current.io_ticks) / elapsed_ms);
+        rates.queue_depth =
+            counter_delta(previous.time_in_queue, current.time_in_queue) /
+            elapsed_ms;
+
+        _rates.push_back(rates);
+    });
+
+    _previous_time = now;
+    _has_previous  = true;
+    return has_rates;
+}
+
+} // namespace pfs
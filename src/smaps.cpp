@@ -14,13 +14,14 @@
  *  limitations under the License.
  */
 
-#include <fstream>
+#include <algorithm>
+#include <array>
 #include <functional>
-#include <optional>
 #include <string>
 #include <unordered_map>
 
 #include "pfs/parser_error.hpp"
+#include "pfs/parsers/kv_file_parser.hpp"
 #include "pfs/parsers/maps.hpp"
 #include "pfs/parsers/smaps.hpp"
 #include "pfs/types.hpp"
@@ -32,193 +33,318 @@ namespace parsers {
 
 namespace {
 
-void parse_size(const std::string& value, mem_map& out)
+void parse_size(string_view value, mem_map& out)
 {
     utils::parse_memory_size("size", value, out.size);
 }
 
-void parse_kernel_page_size(const std::string& value, mem_map& out)
+void parse_kernel_page_size(string_view value, mem_map& out)
 {
     utils::parse_memory_size("kernel_page_size", value, out.kernel_page_size);
 }
 
-void parse_mmu_page_size(const std::string& value, mem_map& out)
+void parse_mmu_page_size(string_view value, mem_map& out)
 {
     utils::parse_memory_size("mmu_page_size", value, out.mmu_page_size);
 }
 
-void parse_rss(const std::string& value, mem_map& out)
+void parse_rss(string_view value, mem_map& out)
 {
     utils::parse_memory_size("rss", value, out.rss);
 }
 
-void parse_pss(const std::string& value, mem_map& out)
+void parse_pss(string_view value, mem_map& out)
 {
     utils::parse_memory_size("pss", value, out.pss);
 }
 
-void parse_pss_dirty(const std::string& value, mem_map& out)
+void parse_pss_dirty(string_view value, mem_map& out)
 {
     utils::parse_memory_size("pss_dirty", value, out.pss_dirty);
 }
 
-void parse_shared_clean(const std::string& value, mem_map& out)
+void parse_pss_anon(string_view value, mem_map& out)
+{
+    utils::parse_memory_size("pss_anon", value, out.pss_anon);
+}
+
+void parse_pss_file(string_view value, mem_map& out)
+{
+    utils::parse_memory_size("pss_file", value, out.pss_file);
+}
+
+void parse_pss_shmem(string_view value, mem_map& out)
+{
+    utils::parse_memory_size("pss_shmem", value, out.pss_shmem);
+}
+
+void parse_shared_clean(string_view value, mem_map& out)
 {
     utils::parse_memory_size("shared_clean", value, out.shared_clean);
 }
 
-void parse_shared_dirty(const std::string& value, mem_map& out)
+void parse_shared_dirty(string_view value, mem_map& out)
 {
     utils::parse_memory_size("shared_dirty", value, out.shared_dirty);
 }
 
-void parse_private_clean(const std::string& value, mem_map& out)
+void parse_private_clean(string_view value, mem_map& out)
 {
     utils::parse_memory_size("private_clean", value, out.private_clean);
 }
 
-void parse_private_dirty(const std::string& value, mem_map& out)
+void parse_private_dirty(string_view value, mem_map& out)
 {
     utils::parse_memory_size("private_dirty", value, out.private_dirty);
 }
 
-void parse_referenced(const std::string& value, mem_map& out)
+void parse_referenced(string_view value, mem_map& out)
 {
     utils::parse_memory_size("referenced", value, out.referenced);
 }
 
-void parse_anonymous(const std::string& value, mem_map& out)
+void parse_anonymous(string_view value, mem_map& out)
 {
     utils::parse_memory_size("anonymous", value, out.anonymous);
 }
 
-void parse_ksm(const std::string& value, mem_map& out)
+void parse_ksm(string_view value, mem_map& out)
 {
     utils::parse_memory_size("ksm", value, out.ksm);
 }
 
-void parse_lazy_free(const std::string& value, mem_map& out)
+void parse_lazy_free(string_view value, mem_map& out)
 {
     utils::parse_memory_size("lazy_free", value, out.lazy_free);
 }
 
-void parse_anon_huge_pages(const std::string& value, mem_map& out)
+void parse_anon_huge_pages(string_view value, mem_map& out)
 {
     utils::parse_memory_size("anon_huge_pages", value, out.anon_huge_pages);
 }
 
-void parse_shmem_pmd_mapped(const std::string& value, mem_map& out)
+void parse_shmem_pmd_mapped(string_view value, mem_map& out)
 {
     utils::parse_memory_size("shmem_pmd_mapped", value, out.shmem_pmd_mapped);
 }
 
-void parse_file_pmd_mapped(const std::string& value, mem_map& out)
+void parse_file_pmd_mapped(string_view value, mem_map& out)
 {
     utils::parse_memory_size("file_pmd_mapped", value, out.file_pmd_mapped);
 }
 
-void parse_shared_hugetlb(const std::string& value, mem_map& out)
+void parse_shared_hugetlb(string_view value, mem_map& out)
 {
     utils::parse_memory_size("shared_hugetlb", value, out.shared_hugetlb);
 }
 
-void parse_private_hugetlb(const std::string& value, mem_map& out)
+void parse_private_hugetlb(string_view value, mem_map& out)
 {
     utils::parse_memory_size("private_hugetlb", value, out.private_hugetlb);
 }
 
-void parse_swap(const std::string& value, mem_map& out)
+void parse_swap(string_view value, mem_map& out)
 {
     utils::parse_memory_size("swap", value, out.swap);
 }
 
-void parse_swap_pss(const std::string& value, mem_map& out)
+void parse_swap_pss(string_view value, mem_map& out)
 {
     utils::parse_memory_size("swap_pss", value, out.swap_pss);
 }
 
-void parse_locked(const std::string& value, mem_map& out)
+void parse_locked(string_view value, mem_map& out)
 {
     utils::parse_memory_size("locked", value, out.locked);
 }
 
-void parse_thp_eligible(const std::string& value, mem_map& out)
+void parse_thp_eligible(string_view value, mem_map& out)
 {
     int thp_eligible = 0;
     utils::stot(value, thp_eligible);
     out.thp_eligible = thp_eligible != 0;
 }
 
-void parse_vm_flags(const std::string& value, mem_map& out)
-{
-    out.vm_flags = utils::split(value);
-}
-
-using value_parser =
-    std::function<void(const std::string& value, mem_map& out)>;
-using value_parsers = std::unordered_map<std::string, value_parser>;
-
-const value_parsers parsers = {{"Size", parse_size},
-                               {"KernelPageSize", parse_kernel_page_size},
-                               {"MMUPageSize", parse_mmu_page_size},
-                               {"Rss", parse_rss},
-                               {"Pss", parse_pss},
-                               {"Pss_Dirty", parse_pss_dirty},
-                               {"Shared_Clean", parse_shared_clean},
-                               {"Shared_Dirty", parse_shared_dirty},
-                               {"Private_Clean", parse_private_clean},
-                               {"Private_Dirty", parse_private_dirty},
-                               {"Referenced", parse_referenced},
-                               {"Anonymous", parse_anonymous},
-                               {"KSM", parse_ksm},
-                               {"LazyFree", parse_lazy_free},
-                               {"AnonHugePages", parse_anon_huge_pages},
-                               {"ShmemPmdMapped", parse_shmem_pmd_mapped},
-                               {"FilePmdMapped", parse_file_pmd_mapped},
-                               {"Shared_Hugetlb", parse_shared_hugetlb},
-                               {"Private_Hugetlb", parse_private_hugetlb},
-                               {"Swap", parse_swap},
-                               {"SwapPss", parse_swap_pss},
-                               {"Locked", parse_locked},
-                               {"THPeligible", parse_thp_eligible},
-                               {"VmFlags", parse_vm_flags}};
+static const size_t VM_FLAG_CODE_LEN = 2;
+static const size_t LETTERS          = 26;
+static const int8_t UNKNOWN_VM_FLAG  = -1;
 
-} // namespace
+// Maps the two-letter VmFlags codes to their vm_flag, using a direct lookup
+class vm_flag_table
+{
+public:
+    vm_flag_table()
+    {
+        struct entry
+        {
+            const char* code;
+            vm_flag flag;
+        };
+
+        // clang-format off
+        static const entry entries[] = {
+            {"rd", vm_flag::readable},     {"wr", vm_flag::writable},
+            {"ex", vm_flag::executable},   {"sh", vm_flag::shared},
+            {"mr", vm_flag::may_read},     {"mw", vm_flag::may_write},
+            {"me", vm_flag::may_execute},  {"ms", vm_flag::may_share},
+            {"gd", vm_flag::grows_down},   {"pf", vm_flag::pfn_map},
+            {"dw", vm_flag::deny_write},   {"lo", vm_flag::locked},
+            {"io", vm_flag::io},           {"sr", vm_flag::seq_read},
+            {"rr", vm_flag::rand_read},    {"dc", vm_flag::dont_copy},
+            {"de", vm_flag::dont_expand},  {"lf", vm_flag::lock_on_fault},
+            {"ac", vm_flag::account},      {"nr", vm_flag::no_reserve},
+            {"ht", vm_flag::huge_tlb},     {"sf", vm_flag::sync},
+            {"ar", vm_flag::arch_1},       {"wf", vm_flag::wipe_on_fork},
+            {"dd", vm_flag::dont_dump},    {"bt", vm_flag::arm64_bti},
+            {"mp", vm_flag::mpx},          {"sd", vm_flag::soft_dirty},
+            {"mm", vm_flag::mixed_map},    {"hg", vm_flag::huge_page},
+            {"nh", vm_flag::no_huge_page}, {"mg", vm_flag::mergeable},
+            {"um", vm_flag::uffd_missing}, {"uw", vm_flag::uffd_wp},
+            {"ss", vm_flag::shadow_stack}, {"sl", vm_flag::sealed},
+            {"mt", vm_flag::arm64_mte},    {"ui", vm_flag::uffd_minor},
+        };
+        // clang-format on
+
+        _slots.fill(UNKNOWN_VM_FLAG);
+        for (const auto& entry : entries)
+        {
+            _slots[slot(entry.code[0], entry.code[1])] =
+                static_cast<int8_t>(entry.flag);
+        }
+    }
+
+    bool find(string_view code, vm_flag& flag) const
+    {
+        if (code.size() != VM_FLAG_CODE_LEN || !is_lower(code[0]) || !is_lower(code[1]))
+        {
+            return false;
+        }
+
+        int8_t value = _slots[slot(code[0], code[1])];
+        if (value == UNKNOWN_VM_FLAG)
+        {
+            return false;
+        }
+
+        flag = static_cast<vm_flag>(value);
+        return true;
+    }
+
+private:
+    static bool is_lower(char c) { return c >= 'a' && c <= 'z'; }
+
+    static size_t slot(char first, char second)
+    {
+        return (first - 'a') * LETTERS + (second - 'a');
+    }
 
-std::vector<mem_map> parse_smaps(const std::string& path)
+    std::array<int8_t, LETTERS * LETTERS> _slots;
+};
+
+const vm_flag_table vm_flag_codes;
+
+void parse_vm_flags(string_view value, mem_map& out)
 {
-    static const char MEM_REGION_DELIM = '-';
+    out.vm_flags = vm_flags_mask();
+    out.unknown_vm_flags.clear();
 
-    std::ifstream in(path);
-    if (!in)
+    utils::tokenizer tok(value);
+    string_view code;
+    while (tok.next(code))
     {
-        throw parser_error("Couldn't open file", path);
+        vm_flag flag = vm_flag::readable;
+        if (vm_flag_codes.find(code, flag))
+        {
+            out.vm_flags.set(flag);
+        }
+        else
+        {
+            out.unknown_vm_flags.emplace_back(code);
+        }
     }
+}
+
+// clang-format off
+const kv_key_table<mem_map> parsers = {
+    {"Size", parse_size},
+    {"KernelPageSize", parse_kernel_page_size},
+    {"MMUPageSize", parse_mmu_page_size},
+    {"Rss", parse_rss},
+    {"Pss", parse_pss},
+    {"Pss_Dirty", parse_pss_dirty},
+    {"Pss_Anon", parse_pss_anon},
+    {"Pss_File", parse_pss_file},
+    {"Pss_Shmem", parse_pss_shmem},
+    {"Shared_Clean", parse_shared_clean},
+    {"Shared_Dirty", parse_shared_dirty},
+    {"Private_Clean", parse_private_clean},
+    {"Private_Dirty", parse_private_dirty},
+    {"Referenced", parse_referenced},
+    {"Anonymous", parse_anonymous},
+    {"KSM", parse_ksm},
+    {"LazyFree", parse_lazy_free},
+    {"AnonHugePages", parse_anon_huge_pages},
+    {"ShmemPmdMapped", parse_shmem_pmd_mapped},
+    {"FilePmdMapped", parse_file_pmd_mapped},
+    {"Shared_Hugetlb", parse_shared_hugetlb},
+    {"Private_Hugetlb", parse_private_hugetlb},
+    {"Swap", parse_swap},
+    {"SwapPss", parse_swap_pss},
+    {"Locked", parse_locked},
+    {"THPeligible", parse_thp_eligible},
+    {"VmFlags", parse_vm_flags},
+};
+// clang-format on
+
+// Prepare the object for the next region, keeping the capacity of the flags
+void reset(mem_map& map)
+{
+    auto unknown_flags = std::move(map.unknown_vm_flags);
+    unknown_flags.clear();
+
+    map                  = mem_map();
+    map.unknown_vm_flags = std::move(unknown_flags);
+}
+
+// Parse the regions one by one, calling 'handle' for every region.
+// The handler may move from the region, as it's reset right afterwards.
+template <typename Handler>
+void parse_smaps_regions(const std::string& path, int dirfd, string_pool* pool,
+                         Handler handle)
+{
+    static const char MEM_REGION_DELIM = '-';
+
+    utils::line_reader in(path, dirfd);
 
-    std::vector<mem_map> smaps;
     mem_map current;
+    bool has_region = false;
+
+    // Reused for all the lines, to avoid allocating per line
     std::string line;
-    while (std::getline(in, line))
+
+    while (in.next(line))
     {
         if (line.find(MEM_REGION_DELIM) != std::string::npos)
         {
             // Memory region line (mapping header)
-            if (current.region.start_address != 0 && current.region.end_address != 0)
+            if (has_region)
             {
-                smaps.push_back(std::move(current));
+                handle(current);
+                reset(current);
             }
 
-            current.region = parse_maps_line(line);
+            current.region = parse_maps_line(line, pool);
+            has_region     = true;
             continue;
         }
 
-        if (current.region.start_address == 0 && current.region.end_address == 0)
+        if (!has_region)
         {
             throw parser_error("Corrupted block - Missing header", line);
         }
 
-        std::string key, value;
-        std::tie(key, value) = utils::split_once(line, ':');
+        string_view key, value;
+        std::tie(key, value) = utils::split_once(string_view(line), ':');
         if (key.empty())
         {
             throw parser_error("Corrupted line - Missing key", line);
@@ -227,22 +353,117 @@ std::vector<mem_map> parse_smaps(const std::string& path)
         utils::rtrim(key);
         utils::ltrim(value);
 
-        auto iter = parsers.find(key);
-        if (iter != parsers.end())
+        size_t index = parsers.find(key);
+        if (index != kv_key_table<mem_map>::npos)
         {
-            auto& parser = iter->second;
-            parser(value, current);
+            parsers.parser(index)(value, current);
         }
     }
 
-    if (current.region.start_address != 0 && current.region.end_address != 0)
+    if (has_region)
     {
-        smaps.push_back(std::move(current));
+        handle(current);
     }
+}
 
+// Add up the sizes of a region, the same way smaps_rollup does
+void accumulate(mem_map& total, const mem_map& map)
+{
+    if (total.region.end_address == 0)
+    {
+        total.region.start_address = map.region.start_address;
+    }
+    total.region.start_address =
+        std::min(total.region.start_address, map.region.start_address);
+    total.region.end_address =
+        std::max(total.region.end_address, map.region.end_address);
+
+    total.size             += map.size;
+    total.rss              += map.rss;
+    total.pss              += map.pss;
+    total.pss_dirty        += map.pss_dirty;
+    total.pss_anon         += map.pss_anon;
+    total.pss_file         += map.pss_file;
+    total.pss_shmem        += map.pss_shmem;
+    total.shared_clean     += map.shared_clean;
+    total.shared_dirty     += map.shared_dirty;
+    total.private_clean    += map.private_clean;
+    total.private_dirty    += map.private_dirty;
+    total.referenced       += map.referenced;
+    total.anonymous        += map.anonymous;
+    total.ksm              += map.ksm;
+    total.lazy_free        += map.lazy_free;
+    total.anon_huge_pages  += map.anon_huge_pages;
+    total.shmem_pmd_mapped += map.shmem_pmd_mapped;
+    total.file_pmd_mapped  += map.file_pmd_mapped;
+    total.shared_hugetlb   += map.shared_hugetlb;
+    total.private_hugetlb  += map.private_hugetlb;
+    total.swap             += map.swap;
+    total.swap_pss         += map.swap_pss;
+    total.locked           += map.locked;
+}
+
+} // namespace
+
+std::vector<mem_map> parse_smaps(const std::string& path, int dirfd,
+                                 string_pool* pool)
+{
+    std::vector<mem_map> smaps;
+    parse_smaps_regions(path, dirfd, pool, [&smaps](mem_map& map) {
+        smaps.push_back(std::move(map));
+    });
     return smaps;
 }
 
+void for_each_smaps(const std::string& path,
+                    const std::function<void(const mem_map&)>& visitor,
+                    int dirfd)
+{
+    parse_smaps_regions(path, dirfd, nullptr,
+                        [&visitor](const mem_map& map) { visitor(map); });
+}
+
+mem_map parse_smaps_rollup(const std::string& path, int dirfd)
+{
+    mem_map rollup;
+    size_t regions = 0;
+    parse_smaps_regions(path, dirfd, nullptr, [&](mem_map& map) {
+        rollup = std::move(map);
+        ++regions;
+    });
+
+    // Kernel threads have no memory, and their rollup is empty
+    if (regions > 1)
+    {
+        throw parser_error("Corrupted smaps rollup - Multiple regions", path);
+    }
+
+    return rollup;
+}
+
+mem_map sum_smaps(const std::string& path, int dirfd)
+{
+    mem_map total;
+    parse_smaps_regions(path, dirfd, nullptr,
+                        [&total](const mem_map& map) { accumulate(total, map); });
+    return total;
+}
+
+std::unordered_map<std::string, mem_map>
+sum_smaps_by_pathname(const std::string& path, int dirfd)
+{
+    std::unordered_map<std::string, mem_map> totals;
+    parse_smaps_regions(path, dirfd, nullptr, [&totals](const mem_map& map) {
+        auto& total = totals[map.region.pathname];
+        if (total.region.end_address == 0)
+        {
+            total.region.pathname = map.region.pathname;
+        }
+        accumulate(total, map);
+    });
+    return totals;
+}
+
 } // namespace parsers
 } // namespace impl
 } // namespace pfs
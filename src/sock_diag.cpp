@@ -0,0 +1,288 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include <linux/inet_diag.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <vector>
+
+#include "pfs/defer.hpp"
+#include "pfs/parser_error.hpp"
+#include "pfs/sock_diag.hpp"
+
+namespace pfs {
+namespace impl {
+namespace sock_diag {
+
+namespace {
+
+// Large enough for any single dump message the kernel sends
+static const size_t RECV_BUFFER_SIZE = 64 * 1024;
+
+// A bytecode program that accepts sockets whose local port equals 'port'.
+// Every comparison is an op followed by an op that holds the port.
+// A match moves on to the next comparison, and running off the end of the
+// program accepts the socket. A mismatch jumps 4 bytes past the end of the
+// program, which rejects it.
+std::vector<inet_diag_bc_op> build_port_filter(uint16_t port)
+{
+    static const unsigned char CODES[] = {INET_DIAG_BC_S_GE,
+                                          INET_DIAG_BC_S_LE};
+    static const unsigned short COMPARISON_SIZE = 2 * sizeof(inet_diag_bc_op);
+    static const unsigned short REJECT_OFFSET   = 4;
+
+    std::vector<inet_diag_bc_op> program;
+    unsigned short remaining = sizeof(CODES) * COMPARISON_SIZE;
+    for (auto code : CODES)
+    {
+        inet_diag_bc_op comparison;
+        comparison.code = code;
+        comparison.yes  = COMPARISON_SIZE;
+        comparison.no   = remaining + REJECT_OFFSET;
+        program.push_back(comparison);
+
+        inet_diag_bc_op value;
+        value.code = INET_DIAG_BC_NOP;
+        value.yes  = 0;
+        value.no   = port;
+        program.push_back(value);
+
+        remaining -= COMPARISON_SIZE;
+    }
+    return program;
+}
+
+// Both keep the address words in network byte order, same as procfs
+ipv6 to_ipv6(const __be32 (&addr)[4])
+{
+    return ipv6{{addr[0], addr[1], addr[2], addr[3]}};
+}
+
+std::vector<char> build_request(int family, int protocol,
+                                const net_socket_query& query)
+{
+    static const uint32_t ALL_STATES = ~0u;
+
+    std::vector<inet_diag_bc_op> bytecode;
+    if (query.local_port != 0)
+    {
+        bytecode = build_port_filter(query.local_port);
+    }
+    size_t bytecode_size = bytecode.size() * sizeof(inet_diag_bc_op);
+
+    size_t size = NLMSG_SPACE(sizeof(inet_diag_req_v2));
+    if (!bytecode.empty())
+    {
+        size += RTA_SPACE(bytecode_size);
+    }
+
+    std::vector<char> request(size, 0);
+
+    auto header         = reinterpret_cast<nlmsghdr*>(request.data());
+    header->nlmsg_len   = static_cast<uint32_t>(size);
+    header->nlmsg_type  = SOCK_DIAG_BY_FAMILY;
+    header->nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+
+    auto body            = static_cast<inet_diag_req_v2*>(NLMSG_DATA(header));
+    body->sdiag_family   = static_cast<uint8_t>(family);
+    body->sdiag_protocol = static_cast<uint8_t>(protocol);
+    body->idiag_states   = query.states != 0 ? query.states : ALL_STATES;
+
+    if (!bytecode.empty())
+    {
+        auto attr = reinterpret_cast<rtattr*>(
+            request.data() + NLMSG_SPACE(sizeof(inet_diag_req_v2)));
+        attr->rta_type = INET_DIAG_REQ_BYTECODE;
+        attr->rta_len =
+            static_cast<unsigned short>(RTA_LENGTH(bytecode_size));
+        memcpy(RTA_DATA(attr), bytecode.data(), bytecode_size);
+    }
+
+    return request;
+}
+
+} // anonymous namespace
+
+bool query_sockets(int family, int protocol, const net_socket_query& query,
+                   const visitor& visit)
+{
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (fd < 0)
+    {
+        return false;
+    }
+    defer close_fd([fd] { close(fd); });
+
+    auto request = build_request(family, protocol, query);
+
+    sockaddr_nl kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+
+    if (sendto(fd, request.data(), request.size(), 0,
+               reinterpret_cast<sockaddr*>(&kernel), sizeof(kernel)) < 0)
+    {
+        return false;
+    }
+
+    std::vector<char> buffer(RECV_BUFFER_SIZE);
+    net_socket sock;
+    size_t slot = 0;
+    while (true)
+    {
+        ssize_t bytes = recv(fd, buffer.data(), buffer.size(), 0);
+        if (bytes < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            if (slot == 0)
+            {
+                return false;
+            }
+            throw std::system_error(errno, std::system_category(),
+                                    "Couldn't receive sock_diag response");
+        }
+
+        size_t remaining = static_cast<size_t>(bytes);
+        auto header      = reinterpret_cast<const nlmsghdr*>(buffer.data());
+        while (remaining >= sizeof(nlmsghdr) &&
+               header->nlmsg_len >= sizeof(nlmsghdr) &&
+               header->nlmsg_len <= remaining)
+        {
+            if (header->nlmsg_type == NLMSG_DONE)
+            {
+                return true;
+            }
+
+            if (header->nlmsg_type == NLMSG_ERROR)
+            {
+                if (slot == 0)
+                {
+                    return false;
+                }
+
+                auto error = static_cast<const nlmsgerr*>(NLMSG_DATA(header));
+                throw std::system_error(-error->error, std::system_category(),
+                                        "Couldn't dump sockets over sock_diag");
+            }
+
+            if (header->nlmsg_type == SOCK_DIAG_BY_FAMILY &&
+                header->nlmsg_len >= NLMSG_LENGTH(sizeof(inet_diag_msg)))
+            {
+                auto msg =
+                    static_cast<const inet_diag_msg*>(NLMSG_DATA(header));
+                parse_inet_diag_msg(*msg, protocol, slot++, sock);
+                if (!visit(sock))
+                {
+                    return true;
+                }
+            }
+
+            size_t aligned = NLMSG_ALIGN(header->nlmsg_len);
+            if (aligned >= remaining)
+            {
+                break;
+            }
+            remaining -= aligned;
+            header = reinterpret_cast<const nlmsghdr*>(
+                reinterpret_cast<const char*>(header) + aligned);
+        }
+    }
+}
+
+void parse_inet_diag_msg(const inet_diag_msg& msg, int protocol, size_t slot,
+                         net_socket& out)
+{
+    switch (msg.idiag_family)
+    {
+        case AF_INET:
+            out.local_ip  = ip(ipv4(msg.id.idiag_src[0]));
+            out.remote_ip = ip(ipv4(msg.id.idiag_dst[0]));
+            break;
+
+        case AF_INET6:
+            out.local_ip  = ip(to_ipv6(msg.id.idiag_src));
+            out.remote_ip = ip(to_ipv6(msg.id.idiag_dst));
+            break;
+
+        default:
+            throw parser_error("Corrupted inet_diag message - Illegal family",
+                               std::to_string(msg.idiag_family));
+    }
+
+    out.slot        = slot;
+    out.local_port  = ntohs(msg.id.idiag_sport);
+    out.remote_port = ntohs(msg.id.idiag_dport);
+
+    auto state = static_cast<net_socket::net_state>(msg.idiag_state);
+    if (state < net_socket::net_state::established ||
+        state > net_socket::net_state::closing)
+    {
+        throw parser_error("Corrupted inet_diag message - Illegal state",
+                           std::to_string(msg.idiag_state));
+    }
+    out.socket_net_state = state;
+
+    // For listening TCP sockets the write queue holds the backlog limit,
+    // while procfs reports an empty transmit queue
+    bool listening = protocol == IPPROTO_TCP &&
+                     state == net_socket::net_state::listen;
+    out.tx_queue = listening ? 0 : msg.idiag_wqueue;
+    out.rx_queue = msg.idiag_rqueue;
+
+    auto timer = static_cast<net_socket::timer>(msg.idiag_timer);
+    if (timer < net_socket::timer::none ||
+        timer > net_socket::timer::zero_window)
+    {
+        throw parser_error("Corrupted inet_diag message - Illegal timer",
+                           std::to_string(msg.idiag_timer));
+    }
+    out.timer_active = timer;
+
+    // The kernel reports milliseconds, procfs reports clock ticks
+    static const size_t TICKS_PER_SECOND =
+        static_cast<size_t>(sysconf(_SC_CLK_TCK));
+    static const size_t MS_PER_SECOND = 1000;
+    out.timer_expire_jiffies = static_cast<size_t>(msg.idiag_expires) *
+                               TICKS_PER_SECOND / MS_PER_SECOND;
+
+    // 'idiag_retrans' is the retransmit count when the retransmit timer is
+    // pending, and the probe count for the other timers
+    bool retransmit = timer == net_socket::timer::retransmit;
+    out.retransmits = retransmit ? msg.idiag_retrans : 0;
+    out.timeouts    = retransmit ? 0 : msg.idiag_retrans;
+
+    out.uid       = msg.idiag_uid;
+    out.inode     = msg.idiag_inode;
+    out.ref_count = 0;
+    out.skbuff    = 0;
+}
+
+} // namespace sock_diag
+} // namespace impl
+} // namespace pfs
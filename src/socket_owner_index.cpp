@@ -0,0 +1,134 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#include <algorithm>
+
+#include "pfs/socket_owner_index.hpp"
+
+namespace pfs {
+
+const std::vector<socket_owner>& socket_owner_index::find(ino64_t inode) const
+{
+    static const std::vector<socket_owner> NO_OWNERS;
+
+    auto iter = _owners.find(inode);
+    return iter != _owners.end() ? iter->second : NO_OWNERS;
+}
+
+bool socket_owner_index::update(int pid, process_sockets sockets)
+{
+    std::sort(sockets.begin(), sockets.end());
+
+    auto& current = _processes[pid];
+    if (current == sockets)
+    {
+        return false;
+    }
+
+    // Both lists are sorted, so a single merge finds the fds that were
+    // closed (only in 'current') and opened (only in 'sockets')
+    auto old_iter = current.begin();
+    auto new_iter = sockets.begin();
+    while (old_iter != current.end() || new_iter != sockets.end())
+    {
+        if (new_iter == sockets.end() ||
+            (old_iter != current.end() && *old_iter < *new_iter))
+        {
+            remove_owner(old_iter->second, socket_owner{pid, old_iter->first});
+            ++old_iter;
+        }
+        else if (old_iter == current.end() || *new_iter < *old_iter)
+        {
+            add_owner(new_iter->second, socket_owner{pid, new_iter->first});
+            ++new_iter;
+        }
+        else
+        {
+            ++old_iter;
+            ++new_iter;
+        }
+    }
+
+    current = std::move(sockets);
+    return true;
+}
+
+bool socket_owner_index::remove(int pid)
+{
+    auto iter = _processes.find(pid);
+    if (iter == _processes.end())
+    {
+        return false;
+    }
+
+    for (const auto& socket : iter->second)
+    {
+        remove_owner(socket.second, socket_owner{pid, socket.first});
+    }
+
+    _processes.erase(iter);
+    return true;
+}
+
+bool socket_owner_index::retain(const std::vector<int>& pids)
+{
+    std::vector<int> gone;
+    for (const auto& process : _processes)
+    {
+        if (!std::binary_search(pids.begin(), pids.end(), process.first))
+        {
+            gone.push_back(process.first);
+        }
+    }
+
+    for (int pid : gone)
+    {
+        remove(pid);
+    }
+
+    return !gone.empty();
+}
+
+void socket_owner_index::add_owner(ino64_t inode, socket_owner owner)
+{
+    auto& owners = _owners[inode];
+    owners.insert(std::lower_bound(owners.begin(), owners.end(), owner),
+                  owner);
+}
+
+void socket_owner_index::remove_owner(ino64_t inode, socket_owner owner)
+{
+    auto iter = _owners.find(inode);
+    if (iter == _owners.end())
+    {
+        return;
+    }
+
+    auto& owners = iter->second;
+    auto pos = std::lower_bound(owners.begin(), owners.end(), owner);
+    if (pos != owners.end() && *pos == owner)
+    {
+        owners.erase(pos);
+    }
+
+    if (owners.empty())
+    {
+        _owners.erase(iter);
+    }
+}
+
+} // namespace pfs
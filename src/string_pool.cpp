@@ -0,0 +1,148 @@
+/*
+ *  Copyright 2020-present Daniel Trugman
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <ostream>
+
+#include "pfs/string_pool.hpp"
+
+namespace pfs {
+
+// =============================================================
+// Shared string
+// =============================================================
+
+shared_string::shared_string(const char* str) : shared_string(std::string(str))
+{}
+
+shared_string::shared_string(const std::string& str)
+    : _str(str.empty() ? nullptr : std::make_shared<const std::string>(str))
+{}
+
+shared_string::shared_string(std::string&& str)
+    : _str(str.empty() ? nullptr
+                       : std::make_shared<const std::string>(std::move(str)))
+{}
+
+const std::string& shared_string::str() const
+{
+    static const std::string EMPTY;
+    return _str ? *_str : EMPTY;
+}
+
+bool shared_string::shares_storage(const shared_string& other) const
+{
+    return _str == other._str;
+}
+
+bool operator==(const shared_string& lhs, const shared_string& rhs)
+{
+    return lhs.shares_storage(rhs) || lhs.str() == rhs.str();
+}
+
+bool operator==(const shared_string& lhs, const std::string& rhs)
+{
+    return lhs.str() == rhs;
+}
+
+bool operator==(const std::string& lhs, const shared_string& rhs)
+{
+    return lhs == rhs.str();
+}
+
+bool operator==(const shared_string& lhs, const char* rhs)
+{
+    return lhs.str() == rhs;
+}
+
+bool operator!=(const shared_string& lhs, const shared_string& rhs)
+{
+    return !(lhs == rhs);
+}
+
+bool operator!=(const shared_string& lhs, const std::string& rhs)
+{
+    return !(lhs == rhs);
+}
+
+bool operator!=(const std::string& lhs, const shared_string& rhs)
+{
+    return !(lhs == rhs);
+}
+
+bool operator!=(const shared_string& lhs, const char* rhs)
+{
+    return !(lhs == rhs);
+}
+
+std::ostream& operator<<(std::ostream& out, const shared_string& str)
+{
+    return out << str.str();
+}
+
+// =============================================================
+// String pool
+// =============================================================
+
+size_t string_pool::view_hash::operator()(impl::string_view str) const
+{
+    // FNV-1a
+    static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+    static const uint64_t FNV_PRIME        = 1099511628211ULL;
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (char c : str)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= FNV_PRIME;
+    }
+    return static_cast<size_t>(hash);
+}
+
+shared_string string_pool::intern(impl::string_view str)
+{
+    if (str.empty())
+    {
+        return shared_string();
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto iter = _strings.find(str);
+    if (iter != _strings.end())
+    {
+        return shared_string(iter->second);
+    }
+
+    auto stored = std::make_shared<const std::string>(str.data(), str.size());
+    _strings.emplace(impl::string_view(*stored), stored);
+    return shared_string(std::move(stored));
+}
+
+size_t string_pool::size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _strings.size();
+}
+
+void string_pool::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _strings.clear();
+}
+
+} // namespace pfs
@@ -18,11 +18,14 @@
 #include <fcntl.h>
 #include <inttypes.h>
 #include <linux/limits.h>
+#include <poll.h>
 #include <stddef.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <system_error>
 
 #include "pfs/defer.hpp"
@@ -35,7 +38,9 @@
 #include "pfs/parsers/smaps.hpp"
 #include "pfs/parsers/syscall.hpp"
 #include "pfs/parsers/task_io.hpp"
+#include "pfs/parsers/task_stat.hpp"
 #include "pfs/parsers/task_status.hpp"
+#include "pfs/procfs.hpp"
 #include "pfs/task.hpp"
 #include "pfs/utils.hpp"
 
@@ -43,9 +48,36 @@ namespace pfs {
 
 using namespace impl;
 
-task::task(const std::string& procfs_root, int id)
+// The state shared by all the copies of a pinned task
+struct task::handle
+{
+    int dirfd                    = -1;
+    int pidfd                    = -1; // Only available for some processes
+    bool has_starttime           = false;
+    unsigned long long starttime = 0;
+
+    handle() = default;
+    handle(const handle&) = delete;
+    handle& operator=(const handle&) = delete;
+
+    ~handle()
+    {
+        if (pidfd >= 0)
+        {
+            close(pidfd);
+        }
+
+        if (dirfd >= 0)
+        {
+            close(dirfd);
+        }
+    }
+};
+
+task::task(const std::string& procfs_root, int id,
+           std::shared_ptr<const handle> pinned)
     : _id(id), _procfs_root(procfs_root),
-      _task_root(build_task_root(procfs_root, id))
+      _task_root(build_task_root(procfs_root, id)), _handle(std::move(pinned))
 {}
 
 std::string task::build_task_root(const std::string& procfs_root, int id)
@@ -53,6 +85,79 @@ std::string task::build_task_root(const std::string& procfs_root, int id)
     return procfs_root + std::to_string(id) + '/';
 }
 
+std::set<task> task::filter_tasks(const std::string& procfs_root,
+                                  const std::vector<int>& ids,
+                                  const task_filter& filter, size_t threads)
+{
+    std::vector<task> candidates;
+    candidates.reserve(ids.size());
+    for (auto id : ids)
+    {
+        candidates.emplace_back(task(procfs_root, id));
+    }
+
+    // Every worker writes to its own slots, and the results are merged in
+    // order afterwards, so the output is the same for any number of threads.
+    // Once a task stops the iteration, the output ends with it, even if
+    // other workers already got to later tasks.
+    std::vector<char> keep(candidates.size(), true);
+    std::atomic<size_t> end(candidates.size());
+    if (filter)
+    {
+        utils::parallel_for(candidates.size(), threads, [&](size_t i) {
+            if (i >= end.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+
+            auto act = filter(candidates[i]);
+            keep[i]  = filter::is_kept(act);
+            if (filter::is_last(act))
+            {
+                size_t current = end.load();
+                while (i + 1 < current &&
+                       !end.compare_exchange_weak(current, i + 1))
+                {
+                }
+            }
+        });
+    }
+
+    std::set<task> tasks;
+    for (size_t i = 0; i < end.load(); ++i)
+    {
+        if (keep[i])
+        {
+            tasks.emplace_hint(tasks.end(), std::move(candidates[i]));
+        }
+    }
+
+    return tasks;
+}
+
+int task::dirfd() const
+{
+    return _handle ? _handle->dirfd : AT_FDCWD;
+}
+
+std::string task::file_path(const std::string& file) const
+{
+    return _handle ? file : _task_root + file;
+}
+
+std::shared_ptr<const int> task::pinned_dirfd() const
+{
+    // Shares the ownership of the whole handle
+    return _handle ? std::shared_ptr<const int>(_handle, &_handle->dirfd)
+                   : nullptr;
+}
+
+unsigned long long task::start_time() const
+{
+    return _handle && _handle->has_starttime ? _handle->starttime
+                                             : get_stat().starttime;
+}
+
 bool task::operator<(const task& rhs) const
 {
     return _id < rhs._id;
@@ -75,75 +180,234 @@ const std::string& task::dir() const
     return _task_root;
 }
 
+std::shared_ptr<task::handle> task::open_handle() const
+{
+    auto pinned = std::make_shared<handle>();
+
+    if (_handle)
+    {
+        // Never go back through the path, which might refer to a different
+        // task by now
+        pinned->dirfd = fcntl(_handle->dirfd, F_DUPFD_CLOEXEC, 0);
+        if (pinned->dirfd < 0)
+        {
+            throw std::system_error(errno, std::system_category(),
+                                    "Couldn't duplicate task directory");
+        }
+
+        if (_handle->pidfd >= 0)
+        {
+            pinned->pidfd = fcntl(_handle->pidfd, F_DUPFD_CLOEXEC, 0);
+            if (pinned->pidfd < 0)
+            {
+                throw std::system_error(errno, std::system_category(),
+                                        "Couldn't duplicate pidfd");
+            }
+        }
+
+        pinned->starttime     = _handle->starttime;
+        pinned->has_starttime = _handle->has_starttime;
+        return pinned;
+    }
+
+    pinned->dirfd = open(_task_root.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (pinned->dirfd < 0)
+    {
+        throw std::system_error(errno, std::system_category(),
+                                "Couldn't open task directory");
+    }
+
+    return pinned;
+}
+
+task task::pin_directory() const
+{
+    if (_handle)
+    {
+        return *this; // Already pinned, share the handle
+    }
+
+    return task(_procfs_root, _id, open_handle());
+}
+
+task task::pin() const
+{
+    static const std::string STAT_FILE("stat");
+
+    if (_handle && _handle->has_starttime)
+    {
+        return *this; // Already pinned, share the handle
+    }
+
+    // Pinned directories (see 'pin_directory') are upgraded through a copy
+    // of their handle, so the task is still the same one
+    auto pinned = open_handle();
+    task out(_procfs_root, _id, pinned);
+
+    // Read through the pinned directory, so that it's the same task
+    pinned->starttime     = out.get_stat().starttime;
+    pinned->has_starttime = true;
+
+#ifdef SYS_pidfd_open
+    // Pids are only meaningful for processes under the default root,
+    // e.g. not for threads, or for a procfs mounted somewhere else.
+    if (pinned->pidfd < 0 && _procfs_root == procfs::DEFAULT_ROOT)
+    {
+        // Failures aren't fatal, e.g. ENOSYS on old kernels.
+        // We fall back to checking the pinned directory.
+        int pidfd = static_cast<int>(::syscall(SYS_pidfd_open, _id, 0));
+        if (pidfd >= 0)
+        {
+            pinned->pidfd = pidfd;
+
+            // The id might have been recycled before the pidfd was opened.
+            // If the pinned task is still alive now, then it's the same one.
+            if (faccessat(pinned->dirfd, STAT_FILE.c_str(), F_OK, 0) != 0)
+            {
+                throw std::system_error(errno, std::system_category(),
+                                        "Task died while pinning");
+            }
+        }
+    }
+#endif
+
+    return out;
+}
+
+bool task::is_pinned() const
+{
+    return _handle != nullptr;
+}
+
+bool task::is_alive() const
+{
+    if (_handle && _handle->pidfd >= 0)
+    {
+        // A pidfd becomes readable once the process exits
+        struct pollfd pfd = {_handle->pidfd, POLLIN, 0};
+        int ready = poll(&pfd, 1, 0 /* timeout */);
+        if (ready < 0)
+        {
+            throw std::system_error(errno, std::system_category(),
+                                    "Couldn't poll pidfd");
+        }
+
+        return ready == 0;
+    }
+
+    // Files under a pinned directory disappear once the task is gone
+    static const std::string STAT_FILE("stat");
+    auto path = file_path(STAT_FILE);
+
+    return faccessat(dirfd(), path.c_str(), F_OK, 0) == 0;
+}
+
+bool task::same_process(const task& other) const
+{
+    if (_id != other._id)
+    {
+        return false;
+    }
+
+    // The start times of pinned tasks are cached, and comparing them says
+    // nothing about whether the task is still alive
+    if (!is_alive() || !other.is_alive())
+    {
+        return false;
+    }
+
+    try
+    {
+        return start_time() == other.start_time();
+    }
+    catch (const std::system_error&)
+    {
+        return false; // One of the tasks is dead
+    }
+}
+
 std::vector<cgroup> task::get_cgroups() const
 {
     static const std::string CGROUP_FILE("cgroup");
-    auto path = _task_root + CGROUP_FILE;
+    auto path = file_path(CGROUP_FILE);
 
     std::vector<cgroup> output;
     parsers::parse_file_lines(path, std::back_inserter(output),
-                             parsers::parse_cgroup_line);
+                              parsers::parse_cgroup_line, nullptr, 0, dirfd());
     return output;
 }
 
 std::string task::get_exe(bool resolve) const
 {
     static const std::string EXE_FILE("exe");
-    auto path = _task_root + EXE_FILE;
+    if (!resolve)
+    {
+        return _task_root + EXE_FILE;
+    }
 
-    return resolve ? utils::readlink(path) : path;
+    return utils::readlink(file_path(EXE_FILE), dirfd());
 }
 
 std::string task::get_cwd() const
 {
     static const std::string CWD_FILE("cwd");
-    auto path = _task_root + CWD_FILE;
+    auto path = file_path(CWD_FILE);
 
-    return utils::readlink(path);
+    return utils::readlink(path, dirfd());
 }
 
 std::string task::get_root() const
 {
     static const std::string ROOT_FILE("root");
-    auto path = _task_root + ROOT_FILE;
+    auto path = file_path(ROOT_FILE);
 
-    return utils::readlink(path);
+    return utils::readlink(path, dirfd());
 }
 
 std::string task::get_comm() const
 {
     static const std::string COMM_FILE("comm");
-    auto path = _task_root + COMM_FILE;
+    auto path = file_path(COMM_FILE);
 
-    return utils::readline(path);
+    return utils::readline(path, dirfd());
 }
 
 std::vector<std::string> task::get_cmdline(size_t max_size) const
 {
     static const std::string CMDLINE_FILE("cmdline");
-    auto path = _task_root + CMDLINE_FILE;
+    auto path = file_path(CMDLINE_FILE);
+
+    auto raw = utils::readfile(path, max_size, true, dirfd());
 
-    auto raw = utils::readfile(path, max_size);
-    return utils::split(raw, '\0', true /* keep_empty */);
+    std::vector<std::string> cmdline;
+    utils::tokenizer tok(raw, '\0', true /* keep_empty */);
+    string_view arg;
+    while (tok.next(arg))
+    {
+        cmdline.emplace_back(arg);
+    }
+    return cmdline;
 }
 
 std::unordered_map<std::string, std::string>
 task::get_environ(size_t max_size) const
 {
     static const std::string ENVIRON_FILE("environ");
-    auto path = _task_root + ENVIRON_FILE;
+    auto path = file_path(ENVIRON_FILE);
 
-    auto raw    = utils::readfile(path, max_size);
-    auto tokens = utils::split(raw, '\0');
+    auto raw = utils::readfile(path, max_size, true, dirfd());
 
     std::unordered_map<std::string, std::string> environ;
-    for (const auto& token : tokens)
+    utils::tokenizer tok(raw, '\0');
+    string_view token;
+    while (tok.next(token))
     {
         static const char KEY_VALUE_DELIM('=');
         size_t delim = token.find(KEY_VALUE_DELIM);
-        if (delim != std::string::npos)
+        if (delim != string_view::npos)
         {
-            environ.emplace(token.substr(0, delim), token.substr(delim + 1));
+            environ.emplace(std::string(token.substr(0, delim)),
+                            std::string(token.substr(delim + 1)));
         }
     }
     return environ;
@@ -151,142 +415,50 @@ task::get_environ(size_t max_size) const
 
 io_stats task::get_io() const {
     static const std::string IO_FILE("io");
-    auto path = _task_root + IO_FILE;
+    auto path = file_path(IO_FILE);
 
-    return parsers::task_io_parser().parse(path);
+    return parsers::task_io_parser().parse(path, {}, dirfd());
 }
 
 task_stat task::get_stat() const
 {
     static const std::string STAT_FILE("stat");
-    auto path = _task_root + STAT_FILE;
+    auto path = file_path(STAT_FILE);
 
-    FILE* fp = fopen(path.c_str(), "r");
-    if (!fp)
+    int fd = openat(dirfd(), path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
     {
         throw std::system_error(errno, std::system_category(),
                                 "Couldn't open file");
     }
-    defer close_fp([fp] { fclose(fp); });
-
-    task_stat st;
-
-    // Consume PID and space delim
-    int matches = fscanf(fp, "%d ", &st.pid);
-    if (matches != 1)
-    {
-        throw std::runtime_error("Couldn't read pid from stat");
-    }
-
-    // Consume comm while making sure we handle correctly
-    // - Values that contain paranthesis '(' and/or ')' inside the value
-    // - Values that contain whitespaces inside the value
+    defer close_fd([fd] { close(fd); });
 
-    long pre_comm = ftell(fp);
+    // The stat line is ~300 bytes long on a typical system, and a bit over
+    // 1KB in the worst case: a 64 chars comm and 51 fields of up to 20 digits.
+    // The kernel generates the whole file on the first read, so a single
+    // read() usually suffices. Keep reading to handle regular files as well.
+    static const size_t STAT_BUFFER_SIZE = 4096;
+    char buffer[STAT_BUFFER_SIZE];
 
-    // https://elixir.bootlin.com/linux/v6.4.1/source/fs/proc/array.c#L99
-    static const size_t COMM_LEN_MAX = 66; // Actual comm (64) + parenthesis (2)
-    st.comm.resize(COMM_LEN_MAX);
-    size_t bytes = fread(&st.comm[0], 1, st.comm.size(), fp);
-    if (bytes != st.comm.size())
+    size_t total = 0;
+    while (total < sizeof(buffer))
     {
-        throw std::runtime_error("Couldn't read comm from stat");
-    }
+        ssize_t bytes = read(fd, buffer + total, sizeof(buffer) - total);
+        if (bytes < 0)
+        {
+            throw std::system_error(errno, std::system_category(),
+                                    "Couldn't read file");
+        }
 
-    // Reassign comm as the text between the outmost pair of parenthesis
-    auto close_paren = st.comm.find_last_of(')');
-    if (close_paren == std::string::npos || close_paren == 0)
-    {
-        throw std::runtime_error("Corrupted stat - Malformed comm field");
-    }
-    st.comm = st.comm.substr(1, close_paren - 1);
-
-    // Skip past comm: closing ')' + space separator before next token
-    //     +|----|++
-    // ... (<comm>) <next> ...
-    //    ^
-    // pre-comm
-    static const size_t COMM_SUFFIX_SIZE = 2; // ')' + ' '
-    if (fseek(fp, pre_comm + close_paren + COMM_SUFFIX_SIZE, SEEK_SET) != 0)
-    {
-        throw std::runtime_error("Couldn't seek past comm in stat");
-    }
+        if (bytes == 0)
+        {
+            break;
+        }
 
-    char state;
-
-    matches = fscanf(
-        fp,
-        "%c "   // state
-        "%d "   // ppid
-        "%d "   // pgrp
-        "%lld " // session
-        "%lld " // tty_nr
-        "%d "   // tgpid
-        "%llu " // flags
-        "%llu " // minflt
-        "%llu " // cminflt
-        "%llu " // majflt
-        "%llu " // cmajflt
-        "%llu " // utime
-        "%llu " // stime
-        "%lld " // cutime
-        "%lld " // cstime
-        "%lld " // priority
-        "%lld " // nice
-        "%lld " // num_threads
-        "%llu " // itrealvalue
-        "%llu " // starttime
-        "%llu " // vsize
-        "%llu " // rss
-        "%llu " // rsslim
-        "%llu " // startcode
-        "%llu " // endcode
-        "%llu " // startstack
-        "%llu " // kstkesp
-        "%llu " // kstkeip
-        "%llu " // signal
-        "%llu " // blocked
-        "%llu " // sigignore
-        "%llu " // sigcatch
-        "%llu " // wchan
-        "%llu " // nswap
-        "%llu " // cnswap
-        "%lld " // exit_signal
-        "%lld " // processor
-        "%llu " // rt_priority
-        "%llu " // policy
-        "%llu " // delayacct_blkio_ticks
-        "%llu " // guest_time
-        "%lld " // cguest_time
-        "%llu " // start_data
-        "%llu " // end_data
-        "%llu " // start_brk
-        "%llu " // arg_start
-        "%llu " // arg_end
-        "%llu " // env_start
-        "%llu " // env_end
-        "%llu ",// exit_code
-        &state, &st.ppid, &st.pgrp, &st.session, &st.tty_nr, &st.tgpid,
-        &st.flags, &st.minflt, &st.cminflt, &st.majflt, &st.cmajflt, &st.utime,
-        &st.stime, &st.cutime, &st.cstime, &st.priority, &st.nice,
-        &st.num_threads, &st.itrealvalue, &st.starttime, &st.vsize, &st.rss,
-        &st.rsslim, &st.startcode, &st.endcode, &st.startstack, &st.kstkesp,
-        &st.kstkeip, &st.signal, &st.blocked, &st.sigignore, &st.sigcatch,
-        &st.wchan, &st.nswap, &st.cnswap, &st.exit_signal, &st.processor,
-        &st.rt_priority, &st.policy, &st.delayacct_blkio_ticks, &st.guest_time,
-        &st.cguest_time, &st.start_data, &st.end_data, &st.start_brk,
-        &st.arg_start, &st.arg_end, &st.env_start, &st.env_end, &st.exit_code);
-
-    // We must have at least everything till 'cnswap'
-    static const int FIELDS_MIN = 35;
-    if (matches < FIELDS_MIN)
-    {
-        throw std::runtime_error("Corrupted stat - Not enough tokens");
+        total += static_cast<size_t>(bytes);
     }
 
-    st.state = parsers::parse_task_state(state);
-
-    return st;
+    return parsers::parse_task_stat_line(string_view(buffer, total));
 }
 
 mem_stats task::get_statm() const
@@ -304,11 +476,11 @@ mem_stats task::get_statm() const
     };
 
     static const std::string STATM_FILE("statm");
-    auto path = _task_root + STATM_FILE;
+    auto path = file_path(STATM_FILE);
 
-    auto line   = utils::readline(path);
-    auto tokens = utils::split(line);
-    if (tokens.size() != COUNT)
+    auto line = utils::readline(path, dirfd());
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(line, tokens) != COUNT)
     {
         throw parser_error("Corrupted statm - Unexpected tokens count", line);
     }
@@ -340,75 +512,138 @@ mem_stats task::get_statm() const
 task_status task::get_status(const std::set<std::string>& keys) const
 {
     static const std::string STATUS_FILE("status");
-    auto path = _task_root + STATUS_FILE;
+    auto path = file_path(STATUS_FILE);
 
-    return parsers::task_status_parser().parse(path, keys);
+    return parsers::task_status_parser().parse(path, keys, dirfd());
 }
 
 syscall task::get_syscall() const
 {
     static const std::string SYSCALL_FILE("syscall");
-    auto path = _task_root + SYSCALL_FILE;
+    auto path = file_path(SYSCALL_FILE);
 
-    auto line = utils::readline(path);
+    auto line = utils::readline(path, dirfd());
     return parsers::parse_syscall_line(line);
 }
 
-std::vector<mem_region> task::get_maps() const
+std::vector<mem_region> task::get_maps(string_pool* pool) const
 {
     static const std::string MAPS_FILE("maps");
-    auto path = _task_root + MAPS_FILE;
+    auto path = file_path(MAPS_FILE);
+
+    auto parser = [pool](const std::string& line) {
+        return parsers::parse_maps_line(line, pool);
+    };
 
     std::vector<mem_region> output;
-    parsers::parse_file_lines(path, std::back_inserter(output),
-                              parsers::parse_maps_line);
+    parsers::parse_file_lines(path, std::back_inserter(output), parser,
+                              nullptr, 0, dirfd());
     return output;
 }
 
-std::vector<mem_map> task::get_smaps() const
+std::vector<mem_map> task::get_smaps(string_pool* pool) const
 {
     static const std::string MAPS_FILE("smaps");
-    auto path = _task_root + MAPS_FILE;
+    auto path = file_path(MAPS_FILE);
+
+    return parsers::parse_smaps(path, dirfd(), pool);
+}
+
+mem_region_index task::get_maps_index(string_pool* pool) const
+{
+    mem_region_index index;
+    refresh_maps_index(index, pool);
+    return index;
+}
+
+bool task::refresh_maps_index(mem_region_index& index, string_pool* pool) const
+{
+    static const std::string MAPS_FILE("maps");
+    auto path = file_path(MAPS_FILE);
+
+    utils::read_buffer_lease buffer;
+    return index.update(buffer->read(path, dirfd()), pool);
+}
 
-    return parsers::parse_smaps(path);
+mem_map task::get_smaps_rollup() const
+{
+    static const std::string SMAPS_ROLLUP_FILE("smaps_rollup");
+    auto path = file_path(SMAPS_ROLLUP_FILE);
+
+    return parsers::parse_smaps_rollup(path, dirfd());
+}
+
+mem_map task::sum_smaps() const
+{
+    static const std::string MAPS_FILE("smaps");
+    auto path = file_path(MAPS_FILE);
+
+    return parsers::sum_smaps(path, dirfd());
+}
+
+std::unordered_map<std::string, mem_map> task::sum_smaps_by_pathname() const
+{
+    static const std::string MAPS_FILE("smaps");
+    auto path = file_path(MAPS_FILE);
+
+    return parsers::sum_smaps_by_pathname(path, dirfd());
 }
 
 mem task::get_mem() const
 {
     static const std::string MEM_FILE("mem");
-    auto path = _task_root + MEM_FILE;
+    auto path = file_path(MEM_FILE);
 
-    return mem(path);
+    // process_vm_readv addresses the task by its ID, which a pinned task
+    // doesn't rely on, and which only makes sense under the default root
+    bool by_id = !_handle && _procfs_root == procfs::DEFAULT_ROOT;
+    pid_t pid  = by_id ? _id : INVALID_PID;
+
+    return mem(path, dirfd(), pid);
+}
+
+pagemap task::get_pagemap() const
+{
+    static const std::string PAGEMAP_FILE("pagemap");
+    auto path = file_path(PAGEMAP_FILE);
+
+    return pagemap(path, dirfd());
 }
 
 std::vector<mount> task::get_mountinfo() const
 {
     static const std::string MOUNTINFO_FILE("mountinfo");
-    auto path = _task_root + MOUNTINFO_FILE;
+    auto path = file_path(MOUNTINFO_FILE);
 
     std::vector<mount> output;
     parsers::parse_file_lines(path, std::back_inserter(output),
-                              parsers::parse_mountinfo_line);
+                              parsers::parse_mountinfo_line, nullptr, 0,
+                              dirfd());
     return output;
 }
 
 size_t task::count_fds() const
 {
     static const std::string FDS_DIR("fd/");
-    auto path = _task_root + FDS_DIR;
+    auto path = file_path(FDS_DIR);
 
-    return utils::count_files(path);
+    return utils::count_files(path, false /* include_dots */, dirfd());
 }
 
 std::unordered_map<int, fd> task::get_fds() const
 {
     static const std::string FDS_DIR("fd/");
-    auto path = _task_root + FDS_DIR;
+    auto path = file_path(FDS_DIR);
+
+    // The links of the returned fds are always reported by their full path,
+    // but the fds of a pinned task access them through its directory
+    auto fds_root = _task_root + FDS_DIR;
+    auto pinned   = pinned_dirfd();
 
     std::unordered_map<int, fd> fds;
-    for (const auto& num : utils::enumerate_numeric_files(path))
+    for (const auto& num : utils::enumerate_numeric_files(path, dirfd()))
     {
-        fds.emplace(num, fd(path, num));
+        fds.emplace(num, fd(fds_root, num, pinned));
     }
 
     return fds;
@@ -416,11 +651,27 @@ std::unordered_map<int, fd> task::get_fds() const
 
 std::set<ino64_t> task::get_fds_inodes() const
 {
-    std::set<ino64_t> inodes;
+    static const std::string FDS_DIR("fd/");
+    auto path = file_path(FDS_DIR);
+
+    int fds_dirfd = openat(dirfd(), path.c_str(), O_DIRECTORY | O_CLOEXEC);
+    if (fds_dirfd == -1)
+    {
+        throw std::system_error(errno, std::system_category(),
+                                "Couldn't open fd directory");
+    }
+    defer close_dirfd([fds_dirfd] { close(fds_dirfd); });
 
-    for (auto& fd : get_fds())
+    std::set<ino64_t> inodes;
+    for (const auto& num : utils::enumerate_numeric_files(".", fds_dirfd))
     {
-        inodes.insert(fd.second.get_target_stat().st_ino);
+        struct stat st;
+        if (fstatat(fds_dirfd, std::to_string(num).c_str(), &st, 0) != 0)
+        {
+            throw std::system_error(errno, std::system_category(),
+                                    "Couldn't stat target");
+        }
+        inodes.insert(st.st_ino);
     }
 
     return inodes;
@@ -428,36 +679,36 @@ std::set<ino64_t> task::get_fds_inodes() const
 
 net task::get_net() const
 {
-    return net(_task_root);
+    return net(_task_root, pinned_dirfd());
 }
 
 ino64_t task::get_ns(const std::string& ns) const
 {
     static const std::string NS_DIR("ns/");
-    auto path = _task_root + NS_DIR + ns;
+    auto path = file_path(NS_DIR + ns);
 
-    return utils::get_inode(path);
+    return utils::get_inode(path, dirfd());
 }
 
 std::unordered_map<std::string, ino64_t> task::get_ns() const
 {
     static const std::string NS_DIR("ns/");
-    auto path = _task_root + NS_DIR;
+    auto path = file_path(NS_DIR);
 
-    int dirfd = open(path.c_str(), O_DIRECTORY | O_CLOEXEC);
-    if (dirfd == -1)
+    int ns_dirfd = openat(dirfd(), path.c_str(), O_DIRECTORY | O_CLOEXEC);
+    if (ns_dirfd == -1)
     {
         throw std::system_error(errno, std::system_category(),
                                 "Couldn't open ns directory");
     }
-    defer close_dirfd([dirfd] { close(dirfd); });
+    defer close_dirfd([ns_dirfd] { close(ns_dirfd); });
 
     std::unordered_map<std::string, ino64_t> ns;
 
     for (const auto& file :
-         utils::enumerate_files(path, /* include_dots */ false))
+         utils::enumerate_files(path, /* include_dots */ false, dirfd()))
     {
-        ns.emplace(file, utils::get_inode(file, dirfd));
+        ns.emplace(file, utils::get_inode(file, ns_dirfd));
     }
 
     return ns;
@@ -473,58 +724,88 @@ task task::get_task(int id) const
     return task(path, id);
 }
 
-std::set<task> task::get_tasks(task_filter filter) const
+std::set<task> task::get_tasks(task_filter filter, size_t threads) const
 {
     static const std::string TASKS_DIR("task/");
     auto path = _task_root + TASKS_DIR;
 
-    std::set<task> threads;
+    auto ids = utils::enumerate_numeric_files(file_path(TASKS_DIR), dirfd());
 
-    for (auto thread_id : utils::enumerate_numeric_files(path))
-    {
-        // Important, see README note about collecting information
-        // about threads to understand why we pass 'path' as the root dir.
-        task t(path, thread_id);
-        if (!filter || filter(t) == filter::action::keep)
-        {
-            threads.emplace(std::move(t));
-        }
-    }
+    // Important, see README note about collecting information
+    // about threads to understand why we pass 'path' as the root dir.
+    return filter_tasks(path, ids, filter, threads);
+}
+
+std::vector<task_ref> task::list_tasks() const
+{
+    static const std::string TASKS_DIR("task/");
+    auto path = _task_root + TASKS_DIR;
+
+    auto ids = utils::enumerate_numeric_files(file_path(TASKS_DIR), dirfd());
 
-    return threads;
+    // Same as 'get_tasks', the references use 'path' as their root dir
+    return task_ref::make_refs(path, ids);
 }
 
 std::vector<id_map> task::get_uid_map() const
 {
     static const std::string UID_MAP_FILE("uid_map");
-    auto path = _task_root + UID_MAP_FILE;
+    auto path = file_path(UID_MAP_FILE);
 
     std::vector<id_map> output;
     parsers::parse_file_lines(path, std::back_inserter(output),
-                              parsers::parse_id_map_line);
+                              parsers::parse_id_map_line, nullptr, 0, dirfd());
     return output;
 }
 
 std::vector<id_map> task::get_gid_map() const
 {
     static const std::string GID_MAP_FILE("gid_map");
-    auto path = _task_root + GID_MAP_FILE;
+    auto path = file_path(GID_MAP_FILE);
 
     std::vector<id_map> output;
     parsers::parse_file_lines(path, std::back_inserter(output),
-                              parsers::parse_id_map_line);
+                              parsers::parse_id_map_line, nullptr, 0, dirfd());
     return output;
 }
 
 uint32_t task::get_sessionid() const
 {
     static const std::string SESSION_ID_FILE("sessionid");
-    auto path = _task_root + SESSION_ID_FILE;
+    auto path = file_path(SESSION_ID_FILE);
 
-    auto line = utils::readline(path);
+    auto line = utils::readline(path, dirfd());
     uint32_t session_id;
     parsers::to_number(SESSION_ID_FILE, line, utils::base::decimal, session_id);
     return session_id;
 }
 
+task_ref::task_ref(std::shared_ptr<const std::string> root, int id)
+    : _root(std::move(root)), _id(id)
+{}
+
+std::vector<task_ref> task_ref::make_refs(const std::string& root,
+                                          const std::vector<int>& ids)
+{
+    auto shared_root = std::make_shared<const std::string>(root);
+
+    std::vector<task_ref> refs;
+    refs.reserve(ids.size());
+    for (auto id : ids)
+    {
+        refs.push_back(task_ref(shared_root, id));
+    }
+    return refs;
+}
+
+std::string task_ref::dir() const
+{
+    return task::build_task_root(*_root, _id);
+}
+
+task task_ref::get() const
+{
+    return task(*_root, _id);
+}
+
 } // namespace pfs
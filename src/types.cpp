@@ -53,6 +53,82 @@ bool signal_mask::operator==(const signal_mask& rhs) const
     return raw == rhs.raw;
 }
 
+// =============================================================
+// VM flags mask
+// =============================================================
+
+vm_flags_mask::vm_flags_mask(raw_type raw) : raw(raw) {}
+
+bool vm_flags_mask::is_set(vm_flag flag) const
+{
+    return raw & (raw_type(1) << static_cast<unsigned>(flag));
+}
+
+void vm_flags_mask::set(vm_flag flag)
+{
+    raw |= (raw_type(1) << static_cast<unsigned>(flag));
+}
+
+bool vm_flags_mask::operator==(const vm_flags_mask& rhs) const
+{
+    return raw == rhs.raw;
+}
+
+// =============================================================
+// Pagemap entry
+// =============================================================
+
+namespace {
+
+// See Documentation/admin-guide/mm/pagemap.rst
+static const unsigned PAGEMAP_PRESENT_BIT    = 63;
+static const unsigned PAGEMAP_SWAPPED_BIT    = 62;
+static const unsigned PAGEMAP_FILE_BIT       = 61;
+static const unsigned PAGEMAP_EXCLUSIVE_BIT  = 56;
+static const unsigned PAGEMAP_SOFT_DIRTY_BIT = 55;
+
+static const pagemap_entry::raw_type PAGEMAP_PFN_MASK =
+    (pagemap_entry::raw_type(1) << PAGEMAP_SOFT_DIRTY_BIT) - 1;
+
+bool is_bit_set(pagemap_entry::raw_type raw, unsigned bit)
+{
+    return (raw >> bit) & 1;
+}
+
+} // anonymous namespace
+
+pagemap_entry::pagemap_entry(raw_type raw) : raw(raw) {}
+
+bool pagemap_entry::is_present() const
+{
+    return is_bit_set(raw, PAGEMAP_PRESENT_BIT);
+}
+
+bool pagemap_entry::is_swapped() const
+{
+    return is_bit_set(raw, PAGEMAP_SWAPPED_BIT);
+}
+
+bool pagemap_entry::is_soft_dirty() const
+{
+    return is_bit_set(raw, PAGEMAP_SOFT_DIRTY_BIT);
+}
+
+bool pagemap_entry::is_exclusive() const
+{
+    return is_bit_set(raw, PAGEMAP_EXCLUSIVE_BIT);
+}
+
+bool pagemap_entry::is_file_or_shared_anon() const
+{
+    return is_bit_set(raw, PAGEMAP_FILE_BIT);
+}
+
+uint64_t pagemap_entry::pfn() const
+{
+    return is_present() ? (raw & PAGEMAP_PFN_MASK) : 0;
+}
+
 // =============================================================
 // IP
 // =============================================================
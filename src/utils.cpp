@@ -15,16 +15,21 @@
  */
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <linux/limits.h>
 #include <stddef.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include <algorithm>
-#include <fstream>
+#include <atomic>
+#include <exception>
+#include <mutex>
 #include <string>
 #include <system_error>
+#include <thread>
 
 #include "pfs/defer.hpp"
 #include "pfs/parser_error.hpp"
@@ -35,71 +40,297 @@ namespace pfs {
 namespace impl {
 namespace utils {
 
-size_t iterate_files(const std::string& dir, bool include_dots,
-                     std::function<void(const char*)> handle)
+namespace {
+
+// Set the high bit of every byte in 'x' whose value is in the range (lo, hi)
+// See "Determine if a word has a byte between m and n" in Bit Twiddling Hacks.
+uint64_t bytes_between(uint64_t x, uint64_t lo, uint64_t hi)
 {
-    static const char DOTFILE_PREFIX = '.';
+    static const uint64_t ONES  = 0x0101010101010101ULL;
+    static const uint64_t HIGHS = 0x8080808080808080ULL;
+    static const uint64_t LOWS  = 0x7f7f7f7f7f7f7f7fULL;
 
-    size_t count = 0;
+    return (ONES * (127 + hi) - (x & LOWS)) & ~x &
+           ((x & LOWS) + ONES * (127 - lo)) & HIGHS;
+}
+
+} // anonymous namespace
+
+bool parse_hex32(const char* first, uint32_t& out)
+{
+    static const size_t HEX32_DIGITS = 8;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    static const uint64_t HIGHS = 0x8080808080808080ULL;
+
+    // First char is loaded into the least significant byte
+    uint64_t x;
+    memcpy(&x, first, HEX32_DIGITS);
+
+    uint64_t valid = bytes_between(x, '0' - 1, '9' + 1) |
+                     bytes_between(x, 'A' - 1, 'F' + 1) |
+                     bytes_between(x, 'a' - 1, 'f' + 1);
+    if (valid != HIGHS)
+    {
+        return false;
+    }
+
+    // Letters have the 0x40 bit set, digits don't, so:
+    // '0'-'9' -> 0x0-0x9, 'A'-'F' / 'a'-'f' -> 0x1-0x6 + 9 = 0xA-0xF
+    uint64_t nibbles = (x & 0x0f0f0f0f0f0f0f0fULL) +
+                       ((x >> 6) & 0x0101010101010101ULL) * 9;
+
+    // Merge pairs of nibbles into bytes, bytes into words, words into dwords.
+    // Lower addresses (i.e. lower bits) hold the more significant digits.
+    nibbles = ((nibbles & 0x000f000f000f000fULL) << 4) |
+              ((nibbles >> 8) & 0x000f000f000f000fULL);
+    nibbles = ((nibbles & 0x000000ff000000ffULL) << 8) |
+              ((nibbles >> 16) & 0x000000ff000000ffULL);
+    nibbles = ((nibbles & 0x000000000000ffffULL) << 16) |
+              ((nibbles >> 32) & 0x000000000000ffffULL);
+
+    out = static_cast<uint32_t>(nibbles);
+    return true;
+#else
+    uint32_t value = 0;
+    for (size_t i = 0; i < HEX32_DIGITS; ++i)
+    {
+        unsigned digit = digit_value(first[i]);
+        if (digit >= static_cast<unsigned>(base::hex))
+        {
+            return false;
+        }
+
+        value = (value << 4) | digit;
+    }
+
+    out = value;
+    return true;
+#endif
+}
+
+void parallel_for(size_t count, size_t threads,
+                  const std::function<void(size_t)>& handle)
+{
+    threads = std::min(threads, count);
+    if (threads <= 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            handle(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::mutex error_lock;
+    std::exception_ptr error;
+
+    auto worker = [&] {
+        size_t i;
+        while (!failed && (i = next.fetch_add(1)) < count)
+        {
+            try
+            {
+                handle(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_lock);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    try
+    {
+        for (size_t i = 1; i < threads; ++i)
+        {
+            workers.emplace_back(worker);
+        }
+    }
+    catch (...)
+    {
+        // Couldn't spawn all the workers, make do with the ones we have
+    }
+
+    worker();
+
+    for (auto& t : workers)
+    {
+        t.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+namespace {
+
+// Large enough to list most directories, e.g. /proc, in a few syscalls
+const size_t DIRENT_BUFFER_SIZE = 64 * 1024;
+
+// Enough for the nesting depth of the iterations in practice
+const size_t DIRENT_BUFFER_POOL_SIZE_MAX = 2;
+
+std::vector<std::unique_ptr<char[]>>& dirent_buffer_pool()
+{
+    static thread_local std::vector<std::unique_ptr<char[]>> pool;
+    return pool;
+}
+
+// Borrow a getdents64 buffer from the calling thread's pool, the same way
+// 'read_buffer_lease' does, so nested iterations get distinct buffers
+class dirent_buffer_lease
+{
+public:
+    dirent_buffer_lease()
+    {
+        auto& pool = dirent_buffer_pool();
+        if (pool.empty())
+        {
+            _buffer.reset(new char[DIRENT_BUFFER_SIZE]);
+        }
+        else
+        {
+            _buffer = std::move(pool.back());
+            pool.pop_back();
+        }
+    }
+
+    ~dirent_buffer_lease()
+    {
+        auto& pool = dirent_buffer_pool();
+        if (pool.size() < DIRENT_BUFFER_POOL_SIZE_MAX)
+        {
+            pool.push_back(std::move(_buffer));
+        }
+    }
+
+    dirent_buffer_lease(const dirent_buffer_lease&) = delete;
+    dirent_buffer_lease& operator=(const dirent_buffer_lease&) = delete;
+
+    char* get() const { return _buffer.get(); }
 
-    DIR* dp = opendir(dir.c_str());
-    if (!dp)
+private:
+    std::unique_ptr<char[]> _buffer;
+};
+
+// Call 'handle' with the name of every entry in the directory.
+// Dot files (including '.' and '..') are skipped unless 'include_dots'.
+// A template, so the internal callers don't pay for a std::function call
+// per entry.
+template <typename Handler>
+size_t for_each_dirent(const std::string& dir, bool include_dots, int dirfd,
+                       Handler handle)
+{
+    static const char DOTFILE_PREFIX = '.';
+
+    int fd = openat(dirfd, dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
     {
         throw std::system_error(errno, std::system_category(),
                                 "Couldn't open dir");
     }
-    defer close_dp([dp] { closedir(dp); });
+    defer close_fd([fd] { close(fd); });
 
-    struct dirent* entry;
-    while ((entry = readdir(dp)))
+    dirent_buffer_lease buffer;
+
+    size_t count = 0;
+    while (true)
     {
-        // It's safe to access index 0.
-        // It's either a valid char or a null-terminator.
-        if (entry->d_name[0] == DOTFILE_PREFIX && !include_dots)
+        long bytes =
+            ::syscall(SYS_getdents64, fd, buffer.get(), DIRENT_BUFFER_SIZE);
+        if (bytes < 0)
         {
-            continue;
+            throw std::system_error(errno, std::system_category(),
+                                    "Couldn't read dir");
         }
 
-        ++count;
+        if (bytes == 0)
+        {
+            break;
+        }
 
-        if (handle)
+        for (long offset = 0; offset < bytes;)
         {
-            handle(entry->d_name);
+            // The kernel fills the same layout as glibc's dirent64
+            auto entry =
+                reinterpret_cast<const struct dirent64*>(buffer.get() + offset);
+            offset += entry->d_reclen;
+
+            const char* name = entry->d_name;
+
+            // It's safe to access index 0.
+            // It's either a valid char or a null-terminator.
+            if (name[0] == DOTFILE_PREFIX && !include_dots)
+            {
+                continue;
+            }
+
+            ++count;
+            handle(name);
         }
     }
 
     return count;
 }
 
-size_t count_files(const std::string& dir, bool include_dots)
+} // anonymous namespace
+
+size_t iterate_files(const std::string& dir, bool include_dots,
+                     std::function<void(const char*)> handle, int dirfd)
 {
-    return iterate_files(dir, include_dots, nullptr);
+    if (!handle)
+    {
+        return count_files(dir, include_dots, dirfd);
+    }
+
+    return for_each_dirent(dir, include_dots, dirfd, handle);
 }
 
-std::set<std::string> enumerate_files(const std::string& dir, bool include_dots)
+size_t count_files(const std::string& dir, bool include_dots, int dirfd)
+{
+    return for_each_dirent(dir, include_dots, dirfd, [](const char*) {});
+}
+
+std::set<std::string> enumerate_files(const std::string& dir, bool include_dots,
+                                      int dirfd)
 {
     std::set<std::string> files;
     auto handle = [&files](const char* name) { files.emplace(name); };
 
-    (void)iterate_files(dir, include_dots, handle);
+    (void)for_each_dirent(dir, include_dots, dirfd, handle);
     return files;
 }
 
-std::set<int> enumerate_numeric_files(const std::string& dir)
+std::vector<int> enumerate_numeric_files(const std::string& dir, int dirfd)
 {
-    std::set<int> files;
+    std::vector<int> files;
     auto handle = [&files](const char* name) {
-        try
+        int num;
+        if (parse_numeric_file_name(name, num))
         {
-            files.insert(std::stoi(name));
-        }
-        catch (const std::logic_error&)
-        {
-            // Do nothing, not a numeric file name
+            files.push_back(num);
         }
     };
 
-    (void)iterate_files(dir, false /* include_dots */, handle);
+    (void)for_each_dirent(dir, false /* include_dots */, dirfd, handle);
+
+    // Procfs lists tasks and fds in ascending order, so this rarely sorts
+    if (!std::is_sorted(files.begin(), files.end()))
+    {
+        std::sort(files.begin(), files.end());
+    }
     return files;
 }
 
@@ -133,10 +364,29 @@ std::string readlink(const std::string& link, int dirfd)
     return buffer;
 }
 
-std::string readfile(const std::string& file, size_t max_bytes,
-                     bool trim_newline)
+namespace {
+
+// Buffers larger than this aren't kept in the pool, so that reading a huge
+// file once doesn't pin its memory for the lifetime of the thread
+const size_t READ_BUFFER_POOL_CAPACITY_MAX = 1024 * 1024;
+
+// Enough for the nesting depth of the readers in practice
+const size_t READ_BUFFER_POOL_SIZE_MAX = 4;
+
+std::vector<std::unique_ptr<read_buffer>>& read_buffer_pool()
 {
-    int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    static thread_local std::vector<std::unique_ptr<read_buffer>> pool;
+    return pool;
+}
+
+} // anonymous namespace
+
+const size_t read_buffer::INITIAL_SIZE;
+
+string_view read_buffer::read(const std::string& file, int dirfd,
+                              size_t max_size)
+{
+    int fd = openat(dirfd, file.c_str(), O_RDONLY | O_CLOEXEC);
     if (fd < 0)
     {
         throw std::system_error(errno, std::system_category(),
@@ -144,41 +394,110 @@ std::string readfile(const std::string& file, size_t max_bytes,
     }
     defer close_fd([fd] { close(fd); });
 
-    std::string buffer;
-    buffer.resize(max_bytes);
+    if (_storage.empty())
+    {
+        _storage.resize(INITIAL_SIZE);
+    }
 
-    ssize_t bytes_read = read(fd, &buffer[0], max_bytes);
-    if (bytes_read < 0)
+    size_t total = 0;
+    while (total < max_size)
     {
-        throw std::system_error(errno, std::system_category(),
-                                "Couldn't read file");
+        if (total == _storage.size())
+        {
+            _storage.resize(_storage.size() * 2);
+        }
+
+        size_t count = std::min(_storage.size(), max_size) - total;
+        ssize_t bytes = ::read(fd, &_storage[total], count);
+        if (bytes < 0)
+        {
+            throw std::system_error(errno, std::system_category(),
+                                    "Couldn't read file");
+        }
+
+        if (bytes == 0)
+        {
+            break;
+        }
+
+        total += static_cast<size_t>(bytes);
+    }
+
+    return string_view(_storage.data(), total);
+}
+
+read_buffer_lease::read_buffer_lease()
+{
+    auto& pool = read_buffer_pool();
+    if (pool.empty())
+    {
+        _buffer.reset(new read_buffer());
+    }
+    else
+    {
+        _buffer = std::move(pool.back());
+        pool.pop_back();
     }
-    buffer.resize(bytes_read);
+}
+
+read_buffer_lease::~read_buffer_lease()
+{
+    auto& pool = read_buffer_pool();
+    if (_buffer->capacity() <= READ_BUFFER_POOL_CAPACITY_MAX &&
+        pool.size() < READ_BUFFER_POOL_SIZE_MAX)
+    {
+        pool.push_back(std::move(_buffer));
+    }
+}
+
+std::string readfile(const std::string& file, size_t max_bytes,
+                     bool trim_newline, int dirfd)
+{
+    read_buffer_lease buffer;
+    auto content = buffer->read(file, dirfd, max_bytes);
 
     static const char NEWLINE('\n');
-    while (trim_newline && !buffer.empty() && buffer.back() == NEWLINE)
+    while (trim_newline && !content.empty() && content.back() == NEWLINE)
     {
-        buffer.pop_back();
+        content.remove_suffix(1);
     }
 
-    return buffer;
+    return std::string(content);
 }
 
-std::string readline(const std::string& file)
+std::string readline(const std::string& file, int dirfd)
 {
-    std::ifstream in(file);
-    if (!in)
+    read_buffer_lease buffer;
+    auto content = buffer->read(file, dirfd);
+    if (content.empty())
     {
-        throw std::runtime_error("Couldn't open file");
+        throw parser_error("Couldn't read line from file", file);
     }
 
-    std::string line;
-    if (!std::getline(in, line))
+    static const char NEWLINE('\n');
+    auto newline = content.find(NEWLINE);
+    if (newline != string_view::npos)
     {
-        throw std::runtime_error("Couldn't read line from file");
+        content.remove_suffix(content.size() - newline);
     }
 
-    return line;
+    return std::string(content);
+}
+
+line_reader::line_reader(const std::string& file, int dirfd)
+    : _buffer(), _lines(_buffer->read(file, dirfd), '\n', true /* keep_empty */)
+{}
+
+bool line_reader::next(std::string& line)
+{
+    string_view view;
+    if (!_lines.next(view))
+    {
+        return false;
+    }
+
+    line.assign(view.data(), view.size());
+    return true;
 }
 
 std::vector<std::string> split(const std::string& buffer, char delim,
@@ -254,6 +573,21 @@ std::pair<std::string, std::string> split_once(const std::string& buffer,
     }
 }
 
+std::pair<string_view, string_view> split_once(string_view buffer,
+                                               char delim)
+{
+    size_t index = buffer.find(delim);
+    if (index == string_view::npos)
+    {
+        return std::make_pair(buffer, string_view());
+    }
+    else
+    {
+        return std::make_pair(buffer.substr(0, index),
+                              buffer.substr(index + 1));
+    }
+}
+
 void ltrim(std::string& str)
 {
     static const auto COMPARE = [](unsigned char c) {
@@ -279,6 +613,35 @@ void trim(std::string& str)
     rtrim(str);
 }
 
+void ltrim(string_view& str)
+{
+    size_t count = 0;
+    while (count < str.size() && std::isspace(static_cast<unsigned char>(str[count])))
+    {
+        ++count;
+    }
+
+    str.remove_prefix(count);
+}
+
+void rtrim(string_view& str)
+{
+    size_t count = 0;
+    while (count < str.size() &&
+           std::isspace(static_cast<unsigned char>(str[str.size() - count - 1])))
+    {
+        ++count;
+    }
+
+    str.remove_suffix(count);
+}
+
+void trim(string_view& str)
+{
+    ltrim(str);
+    rtrim(str);
+}
+
 void ensure_dir_terminator(std::string& dir_path)
 {
     static const char DIR_SEPARATOR('/');
@@ -289,14 +652,23 @@ void ensure_dir_terminator(std::string& dir_path)
     }
 }
 
-ip parse_ipv4_address(const std::string& ip_address_str)
+ip parse_ipv4_address(string_view ip_address_str)
 {
+    static const size_t HEX_BYTE_LEN = 8;
+
     ipv4 raw;
-    utils::stot(ip_address_str, raw, utils::base::hex);
+
+    // Addresses are always fixed width, use the fast path when possible
+    if (ip_address_str.size() != HEX_BYTE_LEN ||
+        !utils::parse_hex32(ip_address_str.data(), raw))
+    {
+        utils::stot(ip_address_str, raw, utils::base::hex);
+    }
+
     return ip(raw);
 }
 
-ip parse_ipv6_address(const std::string& ip_address_str)
+ip parse_ipv6_address(string_view ip_address_str)
 {
     static const size_t HEX_BYTE_LEN = 8;
 
@@ -305,13 +677,17 @@ ip parse_ipv6_address(const std::string& ip_address_str)
     for (size_t i = 0; i < raw.size(); ++i)
     {
         auto nibble = ip_address_str.substr(i * HEX_BYTE_LEN, HEX_BYTE_LEN);
-        utils::stot(nibble, raw[i], utils::base::hex);
+        if (nibble.size() != HEX_BYTE_LEN ||
+            !utils::parse_hex32(nibble.data(), raw[i]))
+        {
+            utils::stot(nibble, raw[i], utils::base::hex);
+        }
     }
 
     return ip(raw);
 }
 
-std::pair<ip, uint16_t> parse_address(const std::string& address_str)
+std::pair<ip, uint16_t> parse_address(string_view address_str)
 {
     enum token
     {
@@ -324,8 +700,8 @@ std::pair<ip, uint16_t> parse_address(const std::string& address_str)
 
     static const char DELIM = ':';
 
-    auto tokens = utils::split(address_str, DELIM);
-    if (tokens.size() != COUNT)
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(address_str, tokens, DELIM) != COUNT)
     {
         throw parser_error(
             "Corrupted net socket address - Unexpected token counts",
@@ -354,7 +730,7 @@ std::pair<ip, uint16_t> parse_address(const std::string& address_str)
     return std::make_pair(addr, port);
 }
 
-void parse_memory_size(const std::string& desc, const std::string& value, uint64_t& out)
+void parse_memory_size(const std::string& desc, string_view value, uint64_t& out)
 {
     enum token
     {
@@ -363,8 +739,8 @@ void parse_memory_size(const std::string& desc, const std::string& value, uint64
         COUNT
     };
 
-    auto tokens = utils::split(value);
-    if (tokens.size() != COUNT)
+    std::array<string_view, COUNT> tokens;
+    if (utils::split(value, tokens) != COUNT)
     {
         throw parser_error("Corrupted " + desc + " - Unexpected tokens count",
                            value);
@@ -1,6 +1,7 @@
 #include "catch.hpp"
 #include "test_utils.hpp"
 
+#include "pfs/parsers/task_stat.hpp"
 #include "pfs/procfs.hpp"
 
 TEST_CASE("Parse task stat", "[task][stat]")
@@ -150,7 +151,7 @@ TEST_CASE("Parse task stat", "[task][stat]")
         test_dir.create_file("1/stat", content);
         REQUIRE_THROWS_WITH(
             pfs::procfs(root_path).get_task(1).get_stat(),
-            "Corrupted stat - Malformed comm field");
+            Catch::StartsWith("Corrupted stat - Malformed comm field"));
     }
 
     SECTION("Malformed comm - missing closing parenthesis")
@@ -166,6 +167,65 @@ TEST_CASE("Parse task stat", "[task][stat]")
         test_dir.create_file("1/stat", content);
         REQUIRE_THROWS_WITH(
             pfs::procfs(root_path).get_task(1).get_stat(),
-            "Corrupted stat - Malformed comm field");
+            Catch::StartsWith("Corrupted stat - Malformed comm field"));
+    }
+}
+
+TEST_CASE("Parse task stat line", "[task][stat]")
+{
+    using pfs::impl::parsers::parse_task_stat_line;
+
+    SECTION("Comm with parenthesis and whitespaces")
+    {
+        const std::string content{
+            "1234 (a) (b) c) R 1 1234 1234 0 -1 4194560 10 0 0 0 3 4 0 0 20 0 "
+            "1 0 5000 1000 200 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 "
+            "0 0 0 0 0 0 0 0 0 0 0 0 0 0\n"};
+
+        auto stat = parse_task_stat_line(content);
+        REQUIRE(stat.pid == 1234);
+        REQUIRE(stat.comm == "a) (b) c");
+        REQUIRE(stat.state == pfs::task_state::running);
+        REQUIRE(stat.ppid == 1);
+        REQUIRE(stat.tgpid == -1);
+        REQUIRE(stat.utime == 3);
+        REQUIRE(stat.stime == 4);
+        REQUIRE(stat.starttime == 5000);
+        REQUIRE(stat.rsslim == 18446744073709551615UL);
+        REQUIRE(stat.exit_signal == 17);
+        REQUIRE(stat.exit_code == 0);
+    }
+
+    SECTION("Only the mandatory fields")
+    {
+        // Old kernels stop right after 'cnswap'
+        const std::string content{
+            "1 (init) S 0 1 1 0 -1 4194560 10 20 30 40 50 60 70 80 20 0 1 0 "
+            "90 100 110 120 1 2 3 4 5 6 7 8 9 10 11 12"};
+
+        auto stat = parse_task_stat_line(content);
+        REQUIRE(stat.comm == "init");
+        REQUIRE(stat.cstime == 80);
+        REQUIRE(stat.starttime == 90);
+        REQUIRE(stat.cnswap == 12);
+        REQUIRE(stat.exit_signal == 0);
+        REQUIRE(stat.processor == 0);
+        REQUIRE(stat.exit_code == 0);
+    }
+
+    SECTION("Not enough fields")
+    {
+        const std::string content{
+            "1 (init) S 0 1 1 0 -1 4194560 10 20 30 40 50 60 70 80 20 0 1 0 "
+            "90 100 110 120 1 2 3 4 5 6 7 8 9 10 11"};
+
+        REQUIRE_THROWS_WITH(parse_task_stat_line(content),
+                            Catch::StartsWith("Corrupted stat - Not enough tokens"));
+    }
+
+    SECTION("Missing pid")
+    {
+        REQUIRE_THROWS_WITH(parse_task_stat_line("(init) S 0"),
+                            Catch::StartsWith("Couldn't read pid from stat"));
     }
 }
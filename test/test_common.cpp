@@ -73,3 +73,17 @@ TEST_CASE("Parse uid_map", "[common][uid_map]")
     REQUIRE(idmap.id_outside_ns == expected.id_outside_ns);
     REQUIRE(idmap.length == expected.length);
 }
+
+TEST_CASE("Parse socket link", "[common][fd]")
+{
+    ino64_t inode = 0;
+    REQUIRE(parse_socket_link("socket:[15979]", inode));
+    REQUIRE(inode == 15979);
+
+    REQUIRE_FALSE(parse_socket_link("pipe:[15979]", inode));
+    REQUIRE_FALSE(parse_socket_link("/dev/null", inode));
+    REQUIRE_FALSE(parse_socket_link("socket:[]", inode));
+    REQUIRE_FALSE(parse_socket_link("socket:[12a]", inode));
+    REQUIRE_FALSE(parse_socket_link("socket:[123", inode));
+    REQUIRE(inode == 15979);
+}
@@ -194,3 +194,30 @@ TEST_CASE("Parse maps", "[task][maps]")
     REQUIRE(region.inode == inode);
     REQUIRE(region.pathname == pathname);
 }
+
+TEST_CASE("Parse maps with a string pool", "[task][maps]")
+{
+    pfs::string_pool pool;
+
+    auto first = parse_maps_line(
+        "7f0b476c6000-7f0b476c7000 r--p 00027000 fd:00 2097554    /lib/ld.so",
+        &pool);
+    auto second = parse_maps_line(
+        "7f0b476c7000-7f0b476c8000 rw-p 00028000 fd:00 2097554    /lib/ld.so",
+        &pool);
+    auto anonymous =
+        parse_maps_line("7f0b476c8000-7f0b476c9000 rw-p 00000000 00:00 0", &pool);
+
+    REQUIRE(first.pathname == "/lib/ld.so");
+    REQUIRE(first.pathname.shares_storage(second.pathname));
+    REQUIRE(anonymous.pathname.empty());
+    REQUIRE(pool.size() == 1);
+
+    SECTION("Pathname is kept verbatim")
+    {
+        auto region = parse_maps_line(
+            "7f0b476c6000-7f0b476c7000 r--p 00000000 fd:00 42    /tmp/a  b ",
+            &pool);
+        REQUIRE(region.pathname == "/tmp/a  b");
+    }
+}
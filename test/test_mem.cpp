@@ -1,10 +1,19 @@
 #include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 
 #include "catch.hpp"
 
 #include <optional>
 #include <type_traits>
 
+#include "pfs/defer.hpp"
 #include "pfs/procfs.hpp"
 
 static_assert(!std::is_copy_constructible<pfs::mem>::value,
@@ -75,3 +84,227 @@ TEST_CASE("Move mem transfers ownership without double-close", "[mem][move]")
     auto extracted = mem2.read(static_cast<loff_t>(secret_offset), secret.size());
     REQUIRE(secret == extracted);
 }
+
+TEST_CASE("Read mem in batches", "[mem][read]")
+{
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    // Three pages, the middle of which is an unmapped hole
+    auto pages = static_cast<uint8_t*>(
+        mmap(nullptr, 3 * page_size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    REQUIRE(pages != MAP_FAILED);
+    pfs::impl::defer unmap_pages([&] { munmap(pages, 3 * page_size); });
+    for (size_t i = 0; i < 3 * page_size; ++i)
+    {
+        if (i < page_size || i >= 2 * page_size)
+        {
+            pages[i] = static_cast<uint8_t>(i % 251);
+        }
+    }
+    REQUIRE(munmap(pages + page_size, page_size) == 0);
+
+    auto address = [](const void* ptr) {
+        // Cast first to size_t to avoid sign expansion of the pointer value
+        return static_cast<uint64_t>(reinterpret_cast<size_t>(ptr));
+    };
+
+    std::vector<uint8_t> first(16), adjacent(16), crossing(32), in_hole(8),
+        after_hole(64);
+
+    std::vector<pfs::mem::read_request> requests = {
+        {address(pages), first.data(), first.size()},
+        {address(pages + 16), adjacent.data(), adjacent.size()},
+        {address(pages + page_size - 8), crossing.data(), crossing.size()},
+        {address(pages + page_size + 8), in_hole.data(), in_hole.size()},
+        {address(pages + 2 * page_size), after_hole.data(), after_hole.size()},
+    };
+
+    // Unpinned tasks read using process_vm_readv, pinned ones using preadv
+    bool pinned = GENERATE(false, true);
+    INFO("Pinned: " << pinned);
+
+    auto self       = pfs::procfs().get_task();
+    auto mem        = pinned ? self.pin().get_mem() : self.get_mem();
+    auto bytes_read = mem.read_batch(requests);
+
+    REQUIRE(bytes_read == std::vector<size_t>{16, 16, 8, 0, 64});
+    REQUIRE(std::equal(first.begin(), first.end(), pages));
+    REQUIRE(std::equal(adjacent.begin(), adjacent.end(), pages + 16));
+    REQUIRE(std::equal(crossing.begin(), crossing.begin() + 8,
+                       pages + page_size - 8));
+    REQUIRE(std::equal(after_hole.begin(), after_hole.end(),
+                       pages + 2 * page_size));
+}
+
+TEST_CASE("Read pagemap and sparse mem", "[mem][pagemap]")
+{
+    const size_t page_size = pfs::pagemap::page_size();
+    const size_t pages     = 4;
+
+    auto region_start = static_cast<uint8_t*>(
+        mmap(nullptr, pages * page_size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    REQUIRE(region_start != MAP_FAILED);
+    pfs::impl::defer unmap_pages(
+        [&] { munmap(region_start, pages * page_size); });
+
+    // Only touch the first and third pages
+    memset(region_start, 'a', page_size);
+    memset(region_start + 2 * page_size, 'c', page_size);
+
+    pfs::mem_region region;
+    region.start_address = reinterpret_cast<size_t>(region_start);
+    region.end_address   = region.start_address + pages * page_size;
+
+    auto self    = pfs::procfs().get_task();
+    auto pagemap = self.get_pagemap();
+
+    SECTION("Entries")
+    {
+        auto entries = pagemap.read(region);
+        REQUIRE(entries.size() == pages);
+        REQUIRE(entries[0].is_present());
+        REQUIRE_FALSE(entries[1].is_present());
+        REQUIRE(entries[2].is_present());
+        REQUIRE_FALSE(entries[3].is_present());
+        REQUIRE(entries[0].is_exclusive());
+
+        auto summary = pagemap.summarize(region);
+        REQUIRE(summary.pages == pages);
+        REQUIRE(summary.present == 2);
+        REQUIRE(summary.swapped == 0);
+    }
+
+    SECTION("Sparse read")
+    {
+        auto mem    = self.get_mem();
+        auto chunks = mem.read_sparse(region, pagemap);
+        REQUIRE(chunks.size() == 2);
+
+        REQUIRE(chunks[0].address == region.start_address);
+        REQUIRE(chunks[0].data == std::vector<uint8_t>(page_size, 'a'));
+
+        REQUIRE(chunks[1].address == region.start_address + 2 * page_size);
+        REQUIRE(chunks[1].data == std::vector<uint8_t>(page_size, 'c'));
+    }
+}
+
+TEST_CASE("Scan mem", "[mem][scan]")
+{
+    const size_t page_size = pfs::pagemap::page_size();
+
+    // Three pages, the middle of which is an unmapped hole
+    auto pages = static_cast<uint8_t*>(
+        mmap(nullptr, 3 * page_size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    REQUIRE(pages != MAP_FAILED);
+    pfs::impl::defer unmap_pages([&] { munmap(pages, 3 * page_size); });
+    REQUIRE(munmap(pages + page_size, page_size) == 0);
+
+    auto address = [](const void* ptr) {
+        return static_cast<uint64_t>(reinterpret_cast<size_t>(ptr));
+    };
+
+    auto place = [](uint8_t* at, const std::string& str) {
+        memcpy(at, str.data(), str.size());
+    };
+
+    // Crosses the boundary of the 64 byte chunks
+    place(pages + 60, "needle");
+    // Overlapping occurrences of both patterns
+    place(pages + 200, "needleedle");
+    // Right before the hole, and right after it
+    place(pages + page_size - 6, "needle");
+    place(pages + 2 * page_size, std::string("\0edl", 4));
+
+    pfs::mem_region first;
+    first.start_address = address(pages);
+    first.end_address   = address(pages + page_size);
+    first.perm.can_read = true;
+
+    pfs::mem_region with_hole = first;
+    with_hole.end_address     = address(pages + 3 * page_size);
+
+    std::vector<std::string> patterns = {"needle", std::string("edl", 3),
+                                         std::string("\0edl", 4)};
+
+    size_t threads = GENERATE(1, 4);
+    INFO("Threads: " << threads);
+
+    auto mem = pfs::procfs().get_task().get_mem();
+
+    SECTION("Matches across chunks")
+    {
+        auto matches = mem.scan({first}, {"needle", "edl"}, threads, 64);
+
+        std::vector<std::pair<uint64_t, size_t>> found;
+        for (const auto& match : matches)
+        {
+            found.emplace_back(match.address - address(pages), match.pattern);
+        }
+
+        REQUIRE(found == std::vector<std::pair<uint64_t, size_t>>{
+                             {60, 0},
+                             {62, 1},
+                             {200, 0},
+                             {202, 1},
+                             {206, 1},
+                             {page_size - 6, 0},
+                             {page_size - 4, 1},
+                         });
+    }
+
+    SECTION("Holes and unreadable regions are skipped")
+    {
+        pfs::mem_region unreadable = first;
+        unreadable.perm.can_read   = false;
+
+        auto matches = mem.scan({with_hole, unreadable}, patterns, threads, 64);
+        REQUIRE(matches.size() == 9);
+        REQUIRE(matches[7].address == address(pages + 2 * page_size));
+        REQUIRE(matches[7].pattern == 2);
+        REQUIRE(matches[8].address == address(pages + 2 * page_size + 1));
+        REQUIRE(matches[8].pattern == 1);
+    }
+
+    SECTION("No patterns")
+    {
+        REQUIRE(mem.scan({first}, {}).empty());
+    }
+
+    SECTION("Empty patterns are rejected")
+    {
+        REQUIRE_THROWS_AS(mem.scan({first}, {"needle", ""}),
+                          std::invalid_argument);
+    }
+}
+
+TEST_CASE("Scan mem of a task that exited", "[mem][scan]")
+{
+    pid_t child = fork();
+    REQUIRE(child >= 0);
+    if (child == 0)
+    {
+        pause();
+        _exit(0);
+    }
+
+    auto mem = pfs::procfs().get_task(child).get_mem();
+    REQUIRE(kill(child, SIGKILL) == 0);
+    REQUIRE(waitpid(child, nullptr, 0) == child);
+
+    // Once the address space is gone, reads come up empty, which must stop
+    // the scan rather than skip the region a page at a time
+    pfs::mem_region huge;
+    huge.start_address = 0x10000;
+    huge.end_address   = huge.start_address + (uint64_t(64) << 30);
+    huge.perm.can_read = true;
+
+    auto start   = std::chrono::steady_clock::now();
+    auto matches = mem.scan({huge, huge}, {"needle"}, GENERATE(1, 2));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    REQUIRE(matches.empty());
+    REQUIRE(elapsed < std::chrono::seconds(2));
+}
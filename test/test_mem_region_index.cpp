@@ -0,0 +1,92 @@
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+#include "pfs/mem_region_index.hpp"
+#include "pfs/procfs.hpp"
+
+namespace {
+
+pfs::mem_region make_region(uint64_t start, uint64_t end, const char* pathname)
+{
+    pfs::mem_region region;
+    region.start_address = start;
+    region.end_address   = end;
+    region.pathname      = pathname;
+    return region;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Memory region index lookup", "[task][maps]")
+{
+    // Unsorted on purpose, with a gap between the second and third regions
+    pfs::mem_region_index index({
+        make_region(0x3000, 0x4000, "c"),
+        make_region(0x1000, 0x2000, "a"),
+        make_region(0x2000, 0x2800, "b"),
+    });
+
+    REQUIRE(index.size() == 3);
+    REQUIRE(index.regions()[0].pathname == "a");
+    REQUIRE(index.regions()[2].pathname == "c");
+
+    REQUIRE(index.find(0x0fff) == nullptr);
+    REQUIRE(index.find(0x1000)->pathname == "a");
+    REQUIRE(index.find(0x1fff)->pathname == "a");
+    REQUIRE(index.find(0x2000)->pathname == "b");
+    REQUIRE(index.find(0x2800) == nullptr);
+    REQUIRE(index.find(0x2fff) == nullptr);
+    REQUIRE(index.find(0x3abc)->pathname == "c");
+    REQUIRE(index.find(0x4000) == nullptr);
+
+    pfs::mem_region_index empty;
+    REQUIRE(empty.empty());
+    REQUIRE(empty.find(0x1000) == nullptr);
+}
+
+TEST_CASE("Memory region index refresh", "[task][maps]")
+{
+    // clang-format off
+    const std::string maps =
+        "00400000-00452000 r-xp 00000000 08:02 173521 /usr/bin/dbus-daemon\n"
+        "00651000-00652000 r--p 00051000 08:02 173521 /usr/bin/dbus-daemon\n"
+        "7fff96532000-7fff96535000 r--p 00000000 00:00 0 [vvar]\n";
+    // clang-format on
+
+    temp_dir test_dir{};
+    test_dir.create_file("1/maps", maps);
+
+    auto task = pfs::procfs(test_dir.get_root()).get_task(1);
+
+    auto index = task.get_maps_index();
+    REQUIRE(index.size() == 3);
+    REQUIRE(index.find(0x00400100)->perm.can_execute);
+    REQUIRE(index.find(0x7fff96534000)->pathname == "[vvar]");
+
+    SECTION("Unchanged maps aren't parsed again")
+    {
+        REQUIRE_FALSE(task.refresh_maps_index(index));
+        REQUIRE(index.size() == 3);
+    }
+
+    SECTION("Changed maps are parsed again")
+    {
+        test_dir.create_file(
+            "1/maps",
+            maps + "7fff96535000-7fff96537000 r-xp 00000000 00:00 0 [vdso]\n");
+
+        REQUIRE(task.refresh_maps_index(index));
+        REQUIRE(index.size() == 4);
+        REQUIRE(index.find(0x7fff96536000)->pathname == "[vdso]");
+    }
+}
+
+TEST_CASE("Memory region index of the current process", "[task][maps]")
+{
+    auto index = pfs::procfs().get_task().get_maps_index();
+
+    auto address = reinterpret_cast<uint64_t>(&make_region);
+    auto region  = index.find(address);
+    REQUIRE(region != nullptr);
+    REQUIRE(region->perm.can_execute);
+}
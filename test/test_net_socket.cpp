@@ -1,10 +1,21 @@
+#include <arpa/inet.h>
+#include <linux/inet_diag.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <map>
 #include <sstream>
 
 #include "catch.hpp"
 #include "test_utils.hpp"
 
+#include "pfs/defer.hpp"
 #include "pfs/parsers/net_socket.hpp"
 #include "pfs/parser_error.hpp"
+#include "pfs/procfs.hpp"
+#include "pfs/sock_diag.hpp"
 
 using namespace pfs::impl::parsers;
 
@@ -106,3 +117,311 @@ TEST_CASE("Parse net socket", "[net][net_socket]")
     REQUIRE(socket.ref_count == expected.ref_count);
     REQUIRE(socket.skbuff == expected.skbuff);
 }
+
+TEST_CASE("Visit net sockets", "[net][net_socket]")
+{
+    using state = pfs::net_socket::net_state;
+
+    temp_dir root;
+    root.create_file(
+        "1/net/tcp",
+        "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when "
+        "retrnsmt   uid  timeout inode\n"
+        "   0: 00000000:006F 00000000:0000 0A 00000000:00000000 00:00000000 "
+        "00000000     0        0 15734 1 ffff9f55b1421800 100 0 0 10 0\n"
+        "   1: 3500007F:0035 00000000:0000 0A 00000000:00000000 00:00000000 "
+        "00000000   101        0 15989 1 ffff9f55b1420800 100 0 0 10 0\n"
+        "   2: 0F02000A:0016 0202000A:DA94 01 0000002C:00000000 01:00000014 "
+        "00000000     0        0 71261 4 ffff9f55b1420000 20 4 25 10 -1\n");
+    root.create_file(
+        "1/net/unix",
+        "Num       RefCount Protocol Flags    Type St Inode Path\n"
+        "ffff8db2fd23a400: 00000003 00000000 00000000 0001 03 16757\n"
+        "ffff8db2f3d35c00: 00000003 00000000 00000000 0001 03 17525 "
+        "/var/run/dbus/system_bus_socket\n");
+
+    auto net = pfs::procfs(root.get_root()).get_net(1);
+
+    SECTION("TCP")
+    {
+        std::map<state, size_t> states;
+        std::vector<ino64_t> inodes;
+        net.for_each_tcp([&](const pfs::net_socket& socket) {
+            ++states[socket.socket_net_state];
+            inodes.push_back(socket.inode);
+        });
+
+        REQUIRE(states == std::map<state, size_t>{{state::established, 1},
+                                                  {state::listen, 2}});
+
+        std::vector<ino64_t> expected;
+        for (const auto& socket : net.get_tcp())
+        {
+            expected.push_back(socket.inode);
+        }
+        REQUIRE(inodes == expected);
+    }
+
+    SECTION("Line filter")
+    {
+        // Look for the listening socket on port 53, without parsing the rest
+        auto line_filter = [](pfs::impl::string_view line) {
+            if (pfs::net::peek_state(line) != state::listen ||
+                pfs::net::peek_local_port(line) != 53)
+            {
+                return pfs::filter::action::drop;
+            }
+            return pfs::filter::action::keep_and_stop;
+        };
+
+        auto sockets = net.get_tcp(nullptr, line_filter);
+        REQUIRE(sockets.size() == 1);
+        REQUIRE(sockets[0].inode == 15989);
+    }
+
+    SECTION("Unix")
+    {
+        std::vector<std::string> paths;
+        net.for_each_unix([&](const pfs::unix_socket& socket) {
+            paths.push_back(socket.path);
+        });
+
+        REQUIRE(paths ==
+                std::vector<std::string>{"", "/var/run/dbus/system_bus_socket"});
+    }
+}
+
+TEST_CASE("Peek net socket columns", "[net][net_socket]")
+{
+    std::string line =
+        "   3: 0F02000A:0016 0202000A:DA94 01 0000002C:00000000 01:00000014 "
+        "00000000     0        0 71261 4 ffff9f55b1420000 20 4 25 10 -1";
+    REQUIRE(parse_net_socket_state(line) ==
+            pfs::net_socket::net_state::established);
+    REQUIRE(parse_net_socket_local_port(line) == 0x16);
+
+    std::string line6 =
+        "   0: 00000000000000000000000000000000:006F "
+        "00000000000000000000000000000000:0000 0A 00000000:00000000 "
+        "00:00000000 00000000     0        0 15737 1 ffff9f55bdb91980 100 0 0 "
+        "10 0";
+    REQUIRE(parse_net_socket_state(line6) ==
+            pfs::net_socket::net_state::listen);
+    REQUIRE(parse_net_socket_local_port(line6) == 0x6F);
+
+    REQUIRE_THROWS_AS(parse_net_socket_state("   0: 0100007F:0035"),
+                      pfs::parser_error);
+    REQUIRE_THROWS_AS(parse_net_socket_state("   0: 0100007F:0035 0 FF"),
+                      pfs::parser_error);
+    REQUIRE_THROWS_AS(parse_net_socket_local_port("   0: 0100007F"),
+                      pfs::parser_error);
+}
+
+TEST_CASE("Parse inet_diag message", "[net][net_socket]")
+{
+    using pfs::impl::sock_diag::parse_inet_diag_msg;
+
+    inet_diag_msg msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.idiag_family    = AF_INET;
+    msg.idiag_state     = 10; // TCP_LISTEN
+    msg.id.idiag_sport  = htons(53);
+    msg.id.idiag_src[0] = htonl(0x7F000035); // 127.0.0.53
+    msg.idiag_rqueue    = 2;
+    msg.idiag_wqueue    = 4096; // The backlog limit of a listener
+    msg.idiag_uid       = 101;
+    msg.idiag_inode     = 15989;
+
+    pfs::net_socket socket;
+    parse_inet_diag_msg(msg, IPPROTO_TCP, 3, socket);
+    REQUIRE(socket.slot == 3);
+    REQUIRE(socket.local_ip == pfs::ip(htonl(0x7F000035)));
+    REQUIRE(socket.local_ip.to_string() == "127.0.0.53");
+    REQUIRE(socket.local_port == 53);
+    REQUIRE(socket.remote_ip == pfs::ip(pfs::ipv4(0)));
+    REQUIRE(socket.remote_port == 0);
+    REQUIRE(socket.socket_net_state == pfs::net_socket::net_state::listen);
+    REQUIRE(socket.tx_queue == 0);
+    REQUIRE(socket.rx_queue == 2);
+    REQUIRE(socket.timer_active == pfs::net_socket::timer::none);
+    REQUIRE(socket.uid == 101);
+    REQUIRE(socket.inode == 15989);
+
+    SECTION("Timers")
+    {
+        msg.idiag_family    = AF_INET6;
+        msg.idiag_state     = 1; // TCP_ESTABLISHED
+        msg.idiag_timer     = 1; // Retransmit
+        msg.idiag_expires   = 1000;
+        msg.idiag_retrans   = 5;
+        msg.id.idiag_src[0] = 0;
+        msg.id.idiag_src[3] = htonl(1); // ::1
+
+        parse_inet_diag_msg(msg, IPPROTO_TCP, 0, socket);
+        REQUIRE(socket.local_ip.to_string() == "::1");
+        REQUIRE(socket.tx_queue == 4096);
+        REQUIRE(socket.timer_active == pfs::net_socket::timer::retransmit);
+        REQUIRE(socket.timer_expire_jiffies ==
+                static_cast<size_t>(sysconf(_SC_CLK_TCK)));
+        REQUIRE(socket.retransmits == 5);
+        REQUIRE(socket.timeouts == 0);
+    }
+
+    SECTION("Corrupted")
+    {
+        msg.idiag_state = 12; // TCP_NEW_SYN_RECV is reported as SYN_RECV
+        REQUIRE_THROWS_AS(parse_inet_diag_msg(msg, IPPROTO_TCP, 0, socket),
+                          pfs::parser_error);
+
+        msg.idiag_state  = 10;
+        msg.idiag_family = AF_UNIX;
+        REQUIRE_THROWS_AS(parse_inet_diag_msg(msg, IPPROTO_TCP, 0, socket),
+                          pfs::parser_error);
+    }
+}
+
+TEST_CASE("Query loopback sockets", "[net][net_socket]")
+{
+    using state   = pfs::net_socket::net_state;
+    using backend = pfs::net::socket_backend;
+
+    auto inode_of = [](int fd) {
+        struct stat st;
+        REQUIRE(fstat(fd, &st) == 0);
+        return static_cast<ino64_t>(st.st_ino);
+    };
+
+    auto find = [](const std::vector<pfs::net_socket>& sockets,
+                   ino64_t inode) -> const pfs::net_socket* {
+        for (const auto& socket : sockets)
+        {
+            if (socket.inode == inode)
+            {
+                return &socket;
+            }
+        }
+        return nullptr;
+    };
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len   = sizeof(addr);
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(listener >= 0);
+    pfs::impl::defer close_listener([listener] { close(listener); });
+    REQUIRE(bind(listener, reinterpret_cast<sockaddr*>(&addr), addr_len) == 0);
+    REQUIRE(listen(listener, 1) == 0);
+    REQUIRE(getsockname(listener, reinterpret_cast<sockaddr*>(&addr),
+                        &addr_len) == 0);
+    uint16_t port = ntohs(addr.sin_port);
+
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(client >= 0);
+    pfs::impl::defer close_client([client] { close(client); });
+    REQUIRE(connect(client, reinterpret_cast<sockaddr*>(&addr), addr_len) ==
+            0);
+
+    sockaddr_in client_addr;
+    socklen_t client_addr_len = sizeof(client_addr);
+    REQUIRE(getsockname(client, reinterpret_cast<sockaddr*>(&client_addr),
+                        &client_addr_len) == 0);
+    uint16_t client_port = ntohs(client_addr.sin_port);
+
+    int server = accept(listener, nullptr, nullptr);
+    REQUIRE(server >= 0);
+    pfs::impl::defer close_server([server] { close(server); });
+
+    auto procfs_net = pfs::procfs().get_net();
+    auto net        = pfs::procfs().get_net();
+    net.set_socket_backend(GENERATE(backend::procfs, backend::netlink));
+
+    SECTION("All sockets")
+    {
+        auto expected = procfs_net.get_tcp();
+        auto sockets  = net.get_tcp();
+
+        for (int fd : {listener, client, server})
+        {
+            auto socket = find(sockets, inode_of(fd));
+            auto other  = find(expected, inode_of(fd));
+            REQUIRE(socket);
+            REQUIRE(other);
+            REQUIRE(socket->local_ip == other->local_ip);
+            REQUIRE(socket->local_port == other->local_port);
+            REQUIRE(socket->remote_ip == other->remote_ip);
+            REQUIRE(socket->remote_port == other->remote_port);
+            REQUIRE(socket->socket_net_state == other->socket_net_state);
+            REQUIRE(socket->uid == other->uid);
+        }
+
+        auto socket = find(sockets, inode_of(listener));
+        REQUIRE(socket->local_ip.to_string() == "127.0.0.1");
+        REQUIRE(socket->local_port == port);
+        REQUIRE(socket->socket_net_state == state::listen);
+    }
+
+    SECTION("Query")
+    {
+        pfs::net_socket_query query;
+        query.local_port = port;
+
+        auto sockets = net.get_tcp(query);
+        REQUIRE(sockets.size() == 2);
+        REQUIRE(find(sockets, inode_of(listener)));
+        REQUIRE(find(sockets, inode_of(server)));
+
+        query.states = pfs::net_socket_query::state_bit(state::established);
+        sockets      = net.get_tcp(query);
+        REQUIRE(sockets.size() == 1);
+        REQUIRE(sockets[0].inode == inode_of(server));
+        REQUIRE(sockets[0].remote_port == client_port);
+    }
+
+    SECTION("Visit")
+    {
+        size_t found = 0;
+        auto listener_inode = inode_of(listener);
+        net.for_each_tcp([&](const pfs::net_socket& socket) {
+            found += socket.inode == listener_inode;
+        });
+        REQUIRE(found == 1);
+    }
+}
+
+TEST_CASE("Netlink backend falls back to procfs", "[net][net_socket]")
+{
+    // The net namespace of a fake root can't be queried over netlink
+    temp_dir root;
+    root.create_file(
+        "1/net/tcp",
+        "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when "
+        "retrnsmt   uid  timeout inode\n"
+        "   0: 00000000:006F 00000000:0000 0A 00000000:00000000 00:00000000 "
+        "00000000     0        0 15734 1 ffff9f55b1421800 100 0 0 10 0\n"
+        "   1: 0F02000A:0016 0202000A:DA94 01 0000002C:00000000 01:00000014 "
+        "00000000     0        0 71261 4 ffff9f55b1420000 20 4 25 10 -1\n");
+
+    auto net = pfs::procfs(root.get_root()).get_net(1);
+    net.set_socket_backend(pfs::net::socket_backend::netlink);
+    REQUIRE(net.get_socket_backend() == pfs::net::socket_backend::netlink);
+
+    auto sockets = net.get_tcp();
+    REQUIRE(sockets.size() == 2);
+    REQUIRE(sockets[0].ref_count == 1);
+
+    pfs::net_socket_query query;
+    query.local_port = 0x16;
+    sockets          = net.get_tcp(query);
+    REQUIRE(sockets.size() == 1);
+    REQUIRE(sockets[0].inode == 71261);
+
+    query.local_port = 0;
+    query.states = pfs::net_socket_query::state_bit(
+        pfs::net_socket::net_state::listen);
+    sockets = net.get_tcp(query);
+    REQUIRE(sockets.size() == 1);
+    REQUIRE(sockets[0].inode == 15734);
+}
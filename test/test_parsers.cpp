@@ -2,6 +2,7 @@
 #include "test_utils.hpp"
 
 #include "pfs/defer.hpp"
+#include "pfs/parsers/kv_file_parser.hpp"
 #include "pfs/parsers/lines.hpp"
 
 using namespace pfs::impl::parsers;
@@ -106,7 +107,198 @@ TEST_CASE("Parse lines functionality", "[parsers]")
         };
     }
 
+    SECTION("Stop")
+    {
+        content  = {"a", "b", "stop", "c"};
+        expected = {"a", "b"};
+        filter = [](const std::string& entry) {
+            return entry == "stop" ? pfs::filter::action::stop : pfs::filter::action::keep;
+        };
+    }
+
+    SECTION("Keep and stop")
+    {
+        content  = {"a", "x", "b", "c"};
+        expected = {"a", "b"};
+        filter = [](const std::string& entry) {
+            if (entry == "x")
+            {
+                return pfs::filter::action::drop;
+            }
+            return entry == "b" ? pfs::filter::action::keep_and_stop : pfs::filter::action::keep;
+        };
+    }
+
     file = create_temp_file(content);
     parse_file_lines(file, std::back_inserter(output), parser, filter, skipped);
     REQUIRE(output == expected);
 }
+
+TEST_CASE("Parse lines with a line filter", "[parsers]")
+{
+    std::vector<std::string> content = {"header", "1", "x", "2", "3", "4"};
+
+    std::string file = create_temp_file(content);
+    pfs::impl::defer unlink_temp_file([&file] { unlink(file.c_str()); });
+
+    // Throws on "x", so the line filter must drop it before it's parsed
+    size_t parsed = 0;
+    auto parser = [&parsed](const std::string& line) {
+        ++parsed;
+        return std::stoi(line);
+    };
+
+    std::vector<int> output;
+    line_filter raw_filter = [](pfs::impl::string_view line) {
+        if (line == "x")
+        {
+            return pfs::filter::action::drop;
+        }
+        return line == "3" ? pfs::filter::action::keep_and_stop
+                           : pfs::filter::action::keep;
+    };
+
+    SECTION("Drop and keep and stop")
+    {
+        parse_file_lines(file, std::back_inserter(output), parser, nullptr, 1,
+                         AT_FDCWD, raw_filter);
+        REQUIRE(output == std::vector<int>{1, 2, 3});
+        REQUIRE(parsed == 3);
+    }
+
+    SECTION("Stop")
+    {
+        raw_filter = [](pfs::impl::string_view line) {
+            return line == "x" ? pfs::filter::action::stop
+                               : pfs::filter::action::keep;
+        };
+
+        parse_file_lines(file, std::back_inserter(output), parser, nullptr, 1,
+                         AT_FDCWD, raw_filter);
+        REQUIRE(output == std::vector<int>{1});
+        REQUIRE(parsed == 1);
+    }
+
+    SECTION("Along with a filter")
+    {
+        std::function<pfs::filter::action(const int&)> filter =
+            [](const int& value) {
+                return value == 2 ? pfs::filter::action::drop
+                                  : pfs::filter::action::keep;
+            };
+
+        parse_file_lines(file, std::back_inserter(output), parser, filter, 1,
+                         AT_FDCWD, raw_filter);
+        REQUIRE(output == std::vector<int>{1, 3});
+        REQUIRE(parsed == 3);
+    }
+}
+
+TEST_CASE("Parse lines with a visitor", "[parsers]")
+{
+    std::vector<std::string> content = {"header", "1", "", "2", "3"};
+
+    std::string file = create_temp_file(content);
+    pfs::impl::defer unlink_temp_file([&file] { unlink(file.c_str()); });
+
+    // Every line is parsed into the same record
+    obj record(0);
+    obj::default_ctor = 0;
+    obj::copy_ctor    = 0;
+
+    auto parser = [](pfs::impl::string_view line, obj& out) {
+        out._x = std::stoul(std::string(line));
+    };
+
+    std::vector<size_t> visited;
+    std::vector<const obj*> addresses;
+    auto visitor = [&](const obj& entry) {
+        visited.push_back(entry._x);
+        addresses.push_back(&entry);
+    };
+
+    parse_file_lines(file, record, parser, visitor, 1);
+
+    REQUIRE(visited == std::vector<size_t>{1, 2, 3});
+    for (auto address : addresses)
+    {
+        REQUIRE(address == &record);
+    }
+    REQUIRE(obj::default_ctor == 0);
+    REQUIRE(obj::copy_ctor == 0);
+}
+
+namespace {
+
+void parse_first(pfs::impl::string_view, int& out)
+{
+    out = 1;
+}
+
+void parse_second(pfs::impl::string_view, int& out)
+{
+    out = 2;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Key table", "[parsers]")
+{
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < 12; ++i)
+    {
+        keys.push_back("key_" + std::to_string(i));
+    }
+
+    SECTION("Lookup")
+    {
+        kv_key_table<int> table = {
+            {"VmRSS", parse_first},
+            {"VmHWM", parse_second},
+        };
+        REQUIRE(table.size() == 2);
+
+        int out = 0;
+        auto index = table.find("VmHWM");
+        REQUIRE(index != kv_key_table<int>::npos);
+        table.parser(index)("", out);
+        REQUIRE(out == 2);
+
+        REQUIRE(table.find("VmRSS") != index);
+        REQUIRE(table.find("VmRS") == kv_key_table<int>::npos);
+        REQUIRE(table.find("VmRSSS") == kv_key_table<int>::npos);
+        REQUIRE(table.find("") == kv_key_table<int>::npos);
+    }
+
+    SECTION("Duplicate keys are rejected")
+    {
+        auto build = [] {
+            kv_key_table<int> table = {
+                {"VmRSS", parse_first},
+                {"VmHWM", parse_second},
+                {"VmRSS", parse_second},
+            };
+        };
+        REQUIRE_THROWS_AS(build(), std::logic_error);
+    }
+
+    SECTION("Every key gets its own slot")
+    {
+        kv_key_table<int> table = {
+            {keys[0].c_str(), parse_first},  {keys[1].c_str(), parse_first},
+            {keys[2].c_str(), parse_first},  {keys[3].c_str(), parse_first},
+            {keys[4].c_str(), parse_first},  {keys[5].c_str(), parse_first},
+            {keys[6].c_str(), parse_first},  {keys[7].c_str(), parse_first},
+            {keys[8].c_str(), parse_first},  {keys[9].c_str(), parse_first},
+            {keys[10].c_str(), parse_first}, {keys[11].c_str(), parse_first},
+        };
+
+        std::set<size_t> indices;
+        for (size_t i = 0; i < table.size(); ++i)
+        {
+            indices.insert(table.find(keys[i]));
+        }
+        REQUIRE(indices.size() == table.size());
+        REQUIRE(indices.count(kv_key_table<int>::npos) == 0);
+    }
+}
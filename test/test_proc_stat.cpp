@@ -39,6 +39,28 @@ TEST_CASE("Parse stat", "[procfs][proc_stat]")
     }
 }
 
+TEST_CASE("Parse cpu IDs", "[procfs][proc_stat]")
+{
+    // Offline cpus are omitted
+    std::vector<std::string> content = {
+        "cpu  30 0 30 300 0 0 0 0 0 0",
+        "cpu0 10 0 10 100 0 0 0 0 0 0",
+        "cpu1 10 0 10 100 0 0 0 0 0 0",
+        "cpu3 10 0 10 100 0 0 0 0 0 0",
+    };
+    std::string file = create_temp_file(content);
+    pfs::impl::defer unlink_temp_file([&file] { unlink(file.c_str()); });
+
+    auto stats = proc_stat_parser().parse(file);
+    REQUIRE(stats.cpus.total.id == -1);
+    REQUIRE(stats.cpus.total.user == 30);
+    REQUIRE(stats.cpus.per_item.size() == 3);
+    REQUIRE(stats.cpus.per_item[0].id == 0);
+    REQUIRE(stats.cpus.per_item[1].id == 1);
+    REQUIRE(stats.cpus.per_item[2].id == 3);
+    REQUIRE(stats.cpus.per_item[2].user == 10);
+}
+
 TEST_CASE("Parse errors", "[procfs][proc_stat][error]")
 {
     std::string field;
@@ -0,0 +1,312 @@
+#include <linux/cn_proc.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+#include "pfs/proc_connector.hpp"
+#include "pfs/process_events.hpp"
+
+namespace {
+
+void create_process(const temp_dir& root, int pid, char state = 'S',
+                    int threads = 1)
+{
+    root.create_file(std::to_string(pid) + "/stat",
+                     std::to_string(pid) + " (proc) " + state +
+                         " 1 1 1 0 -1 4194560 0 0 0 0 0 0 0 0 20 0 " +
+                         std::to_string(threads) +
+                         " 0 5000 "
+                         "0 0 18446744073709551615 0 0 0 0 0 0 0 0 0 0 0 0 "
+                         "17 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n");
+}
+
+void remove_process(const temp_dir& root, int pid)
+{
+    auto dir = root.get_root() + "/" + std::to_string(pid);
+    REQUIRE(std::system(("rm -rf " + dir).c_str()) == 0);
+}
+
+std::vector<int> ids_of(const std::vector<pfs::task_ref>& refs)
+{
+    std::vector<int> ids;
+    for (const auto& ref : refs)
+    {
+        ids.push_back(ref.id());
+    }
+    return ids;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Parse proc connector events", "[process_events]")
+{
+    using pfs::impl::proc_connector::parse_proc_event;
+
+    proc_event raw;
+    memset(&raw, 0, sizeof(raw));
+    pfs::process_event event;
+
+    SECTION("Process fork")
+    {
+        raw.what                        = proc_event::PROC_EVENT_FORK;
+        raw.event_data.fork.parent_pid  = 11;
+        raw.event_data.fork.parent_tgid = 10;
+        raw.event_data.fork.child_pid   = 20;
+        raw.event_data.fork.child_tgid  = 20;
+        REQUIRE(parse_proc_event(raw, event));
+        REQUIRE(event.what == pfs::process_event::type::fork);
+        REQUIRE(event.pid == 20);
+        REQUIRE(event.parent_pid == 10);
+        REQUIRE_FALSE(event.reconciled);
+    }
+
+    SECTION("Thread creation")
+    {
+        raw.what                       = proc_event::PROC_EVENT_FORK;
+        raw.event_data.fork.child_pid  = 21;
+        raw.event_data.fork.child_tgid = 20;
+        REQUIRE_FALSE(parse_proc_event(raw, event));
+    }
+
+    SECTION("Exec from a thread")
+    {
+        raw.what                         = proc_event::PROC_EVENT_EXEC;
+        raw.event_data.exec.process_pid  = 21;
+        raw.event_data.exec.process_tgid = 20;
+        REQUIRE(parse_proc_event(raw, event));
+        REQUIRE(event.what == pfs::process_event::type::exec);
+        REQUIRE(event.pid == 20);
+    }
+
+    SECTION("Process exit")
+    {
+        raw.what                         = proc_event::PROC_EVENT_EXIT;
+        raw.event_data.exit.process_pid  = 20;
+        raw.event_data.exit.process_tgid = 20;
+        raw.event_data.exit.exit_code    = 3 << 8;
+        REQUIRE(parse_proc_event(raw, event));
+        REQUIRE(event.what == pfs::process_event::type::exit);
+        REQUIRE(event.pid == 20);
+        REQUIRE(WEXITSTATUS(event.exit_code) == 3);
+    }
+
+    SECTION("Thread exit")
+    {
+        raw.what                         = proc_event::PROC_EVENT_EXIT;
+        raw.event_data.exit.process_pid  = 21;
+        raw.event_data.exit.process_tgid = 20;
+        REQUIRE_FALSE(parse_proc_event(raw, event));
+    }
+
+    SECTION("Other events")
+    {
+        raw.what = proc_event::PROC_EVENT_UID;
+        REQUIRE_FALSE(parse_proc_event(raw, event));
+    }
+}
+
+TEST_CASE("Reconcile the process table", "[process_events]")
+{
+    temp_dir root;
+    create_process(root, 1);
+    create_process(root, 20);
+    create_process(root, 30, 'Z');
+
+    pfs::process_events events(root.get_root());
+    REQUIRE(events.size() == 2);
+    REQUIRE(events.contains(1));
+    REQUIRE(events.contains(20));
+    REQUIRE_FALSE(events.contains(30));
+    REQUIRE(ids_of(events.list_processes()) == std::vector<int>{1, 20});
+
+    // Events carry host IDs, which a fake root doesn't reflect
+    REQUIRE_FALSE(events.subscribe());
+    REQUIRE(events.fd() == -1);
+    REQUIRE(events.poll(10) == 0);
+
+    std::vector<pfs::process_event> seen;
+    auto visit = [&seen](const pfs::process_event& event) {
+        seen.push_back(event);
+    };
+
+    REQUIRE(events.reconcile(visit) == 0);
+
+    remove_process(root, 20);
+    remove_process(root, 30);
+    create_process(root, 40);
+    create_process(root, 50, 'Z');
+
+    REQUIRE(events.reconcile(visit) == 2);
+    REQUIRE(seen.size() == 2);
+    REQUIRE(seen[0].what == pfs::process_event::type::exit);
+    REQUIRE(seen[0].pid == 20);
+    REQUIRE(seen[0].reconciled);
+    REQUIRE(seen[1].what == pfs::process_event::type::fork);
+    REQUIRE(seen[1].pid == 40);
+    REQUIRE(seen[1].parent_pid == 0);
+    REQUIRE(seen[1].reconciled);
+
+    REQUIRE(ids_of(events.list_processes()) == std::vector<int>{1, 40});
+    REQUIRE(events.list_processes()[1].get().get_stat().pid == 40);
+}
+
+TEST_CASE("Zombie main thread with live threads", "[process_events]")
+{
+    // The main thread called pthread_exit, but other threads are running
+    temp_dir root;
+    create_process(root, 1);
+    create_process(root, 20, 'Z', 3);
+
+    pfs::process_events events(root.get_root());
+    REQUIRE(events.contains(20));
+
+    // The exit of the main thread is reported as the exit of the process,
+    // so it's kept pending until the other threads exit
+    pfs::process_event exit;
+    exit.what      = pfs::process_event::type::exit;
+    exit.pid       = 20;
+    exit.exit_code = 3 << 8;
+    REQUIRE_FALSE(events.apply(exit));
+    REQUIRE(events.contains(20));
+    REQUIRE(events.reconcile() == 0);
+
+    std::vector<pfs::process_event> seen;
+    auto visit = [&seen](const pfs::process_event& event) {
+        seen.push_back(event);
+    };
+
+    SECTION("Last thread exits")
+    {
+        // Exits of threads other than the main one aren't reported
+        create_process(root, 20, 'Z', 1);
+        REQUIRE(events.reconcile(visit) == 1);
+        REQUIRE_FALSE(events.contains(20));
+
+        REQUIRE(seen.size() == 1);
+        REQUIRE(seen[0].what == pfs::process_event::type::exit);
+        REQUIRE(seen[0].pid == 20);
+        REQUIRE(seen[0].exit_code == 3 << 8);
+        REQUIRE_FALSE(seen[0].reconciled);
+
+        REQUIRE(events.reconcile() == 0);
+    }
+
+    SECTION("Reaped")
+    {
+        remove_process(root, 20);
+        REQUIRE(events.reconcile(visit) == 1);
+        REQUIRE_FALSE(events.contains(20));
+
+        REQUIRE(seen.size() == 1);
+        REQUIRE(seen[0].exit_code == 3 << 8);
+        REQUIRE_FALSE(seen[0].reconciled);
+    }
+
+    SECTION("Applied again")
+    {
+        create_process(root, 20, 'Z', 1);
+        REQUIRE(events.apply(exit));
+        REQUIRE_FALSE(events.contains(20));
+        REQUIRE(events.reconcile() == 0);
+    }
+
+    SECTION("Other thread calls exec")
+    {
+        // The thread takes over the ID of the process
+        pfs::process_event exec;
+        exec.what = pfs::process_event::type::exec;
+        exec.pid  = 20;
+        REQUIRE(events.apply(exec));
+
+        create_process(root, 20, 'S', 1);
+        REQUIRE(events.reconcile() == 0);
+        REQUIRE(events.contains(20));
+    }
+
+    SECTION("ID reused")
+    {
+        remove_process(root, 20);
+        create_process(root, 20);
+
+        pfs::process_event fork;
+        fork.what = pfs::process_event::type::fork;
+        fork.pid  = 20;
+        REQUIRE(events.apply(fork, visit));
+        REQUIRE(events.contains(20));
+
+        REQUIRE(seen.size() == 2);
+        REQUIRE(seen[0].what == pfs::process_event::type::exit);
+        REQUIRE(seen[1].what == pfs::process_event::type::fork);
+        REQUIRE(events.reconcile() == 0);
+    }
+
+    SECTION("Found by reconciliation")
+    {
+        create_process(root, 30, 'Z', 2);
+        REQUIRE(events.reconcile() == 1);
+        REQUIRE(events.contains(30));
+    }
+}
+
+TEST_CASE("Receive process events", "[process_events]")
+{
+    pfs::process_events events;
+    if (!events.subscribe())
+    {
+        WARN("Proc connector unavailable, requires CAP_NET_ADMIN");
+        return;
+    }
+    REQUIRE(events.fd() >= 0);
+    REQUIRE(events.contains(getpid()));
+
+    pid_t child = fork();
+    REQUIRE(child >= 0);
+    if (child == 0)
+    {
+        _exit(3);
+    }
+
+    int status;
+    REQUIRE(waitpid(child, &status, 0) == child);
+
+    bool forked = false;
+    bool exited = false;
+    bool lost   = false;
+    auto visit  = [&](const pfs::process_event& event) {
+        lost |= event.reconciled;
+        if (event.pid != child || event.reconciled)
+        {
+            return;
+        }
+
+        if (event.what == pfs::process_event::type::fork)
+        {
+            REQUIRE(event.parent_pid == getpid());
+            forked = true;
+        }
+        else if (event.what == pfs::process_event::type::exit)
+        {
+            REQUIRE(event.exit_code == status);
+            exited = true;
+        }
+    };
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!exited && !lost && std::chrono::steady_clock::now() < deadline)
+    {
+        events.poll(100, visit);
+    }
+
+    REQUIRE_FALSE(events.contains(child));
+    if (!lost)
+    {
+        REQUIRE(forked);
+        REQUIRE(exited);
+    }
+}
@@ -1,6 +1,7 @@
 #include <unistd.h>
 
 #include "catch.hpp"
+#include "test_utils.hpp"
 
 #include "pfs/procfs.hpp"
 
@@ -56,3 +57,258 @@ TEST_CASE("get_tasks with drop-all filter returns empty set", "[task][filter]")
     auto result   = pfs::procfs().get_task().get_tasks(drop_all);
     REQUIRE(result.empty());
 }
+
+TEST_CASE("list_processes and list_tasks return lightweight references", "[procfs][task]")
+{
+    temp_dir root;
+    for (auto file : {"20/comm", "3/comm", "100/comm", "1/task/1/comm",
+                      "1/task/7/comm", "self/comm", "meminfo"})
+    {
+        root.create_file(file, "x\n");
+    }
+
+    pfs::procfs procfs(root.get_root());
+
+    auto refs = procfs.list_processes();
+    REQUIRE(refs.size() == 4);
+
+    auto tasks = procfs.get_processes();
+    REQUIRE(tasks.size() == refs.size());
+    auto task = tasks.begin();
+    for (const auto& ref : refs)
+    {
+        REQUIRE(ref.id() == task->id());
+        REQUIRE(ref.dir() == task->dir());
+        REQUIRE(ref.get().dir() == task->dir());
+        ++task;
+    }
+    REQUIRE(refs[0] < refs[1]);
+    REQUIRE(refs[0] == procfs.list_processes()[0]);
+
+    auto threads = refs[0].get().list_tasks();
+    REQUIRE(threads.size() == 2);
+    REQUIRE(threads[1].id() == 7);
+    REQUIRE(threads[1].dir() == root.get_root() + "/1/task/7/");
+    REQUIRE(threads[1].get().get_comm() == "x");
+    REQUIRE_FALSE(threads[0] == refs[0]);
+}
+
+TEST_CASE("snapshot collects the requested fields", "[procfs][snapshot]")
+{
+    temp_dir test_dir{};
+    const std::string root_path{test_dir.get_root()};
+
+    for (int pid : {100, 200})
+    {
+        auto dir = std::to_string(pid) + "/";
+        test_dir.create_file(
+            dir + "stat",
+            std::to_string(pid) +
+                " (proc) S 1 1 1 0 -1 4194560 0 0 0 0 7 8 0 0 20 0 1 0 5000 "
+                "0 0 18446744073709551615 0 0 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 "
+                "0 0 0 0 0 0 0 0 0\n");
+        test_dir.create_file(dir + "status", "Name:\tproc\nPid:\t" +
+                                                 std::to_string(pid) + "\n");
+        test_dir.create_file(dir + "statm", "10 5 2 1 0 3 0\n");
+        test_dir.create_file(dir + "cmdline", std::string("proc\0--flag\0", 12));
+        test_dir.create_file(dir + "io", "rchar: 1\nwchar: 2\nsyscr: 3\n"
+                                         "syscw: 4\nread_bytes: 5\n"
+                                         "write_bytes: 6\n"
+                                         "cancelled_write_bytes: 7\n");
+        test_dir.create_file(
+            dir + "maps",
+            "00400000-00452000 r-xp 00000000 08:02 173521 /usr/bin/dbus\n"
+            "7f0000000000-7f0000001000 rw-p 00000000 00:00 0\n");
+    }
+
+    // Not a task, must be ignored
+    test_dir.create_file("self_test/stat", "");
+
+    pfs::procfs procfs(root_path);
+
+    SECTION("All fields")
+    {
+        auto snapshot = procfs.snapshot();
+        REQUIRE(snapshot.size() == 2);
+        REQUIRE(snapshot.ids == std::vector<int>{100, 200});
+        REQUIRE(snapshot.collected ==
+                std::vector<unsigned>(2, pfs::task_fields::all));
+
+        for (size_t i = 0; i < snapshot.size(); ++i)
+        {
+            REQUIRE(snapshot.stat[i].pid == snapshot.ids[i]);
+            REQUIRE(snapshot.stat[i].utime == 7);
+            REQUIRE(snapshot.stat[i].starttime == 5000);
+            REQUIRE(snapshot.status[i].name == "proc");
+            REQUIRE(snapshot.status[i].pid == snapshot.ids[i]);
+            REQUIRE(snapshot.io[i].cancelled_write_bytes == 7);
+            REQUIRE(snapshot.statm[i].resident == 5);
+            REQUIRE(snapshot.cmdline[i] ==
+                    std::vector<std::string>{"proc", "--flag"});
+        }
+    }
+
+    SECTION("Some fields")
+    {
+        auto snapshot =
+            procfs.snapshot(pfs::task_fields::stat | pfs::task_fields::statm);
+        REQUIRE(snapshot.size() == 2);
+        REQUIRE(snapshot.collected ==
+                std::vector<unsigned>(2, pfs::task_fields::stat |
+                                             pfs::task_fields::statm));
+        REQUIRE(snapshot.stat.size() == 2);
+        REQUIRE(snapshot.statm.size() == 2);
+        REQUIRE(snapshot.status.empty());
+        REQUIRE(snapshot.io.empty());
+        REQUIRE(snapshot.cmdline.empty());
+    }
+
+    SECTION("Maps")
+    {
+        auto snapshot = procfs.snapshot(pfs::task_fields::maps);
+        REQUIRE(snapshot.collected ==
+                std::vector<unsigned>(2, pfs::task_fields::maps));
+        REQUIRE(snapshot.maps.size() == 2);
+
+        for (const auto& maps : snapshot.maps)
+        {
+            REQUIRE(maps.size() == 2);
+            REQUIRE(maps[0].pathname == "/usr/bin/dbus");
+            REQUIRE(maps[1].pathname.empty());
+        }
+
+        // The pathnames are interned across the tasks
+        REQUIRE(snapshot.maps[0][0].pathname.shares_storage(
+            snapshot.maps[1][0].pathname));
+    }
+
+    SECTION("Dead tasks are omitted")
+    {
+        // A task whose files are gone looks exactly like a task that died
+        test_dir.create_file("300/stat", "");
+        REQUIRE(std::system(("rm " + root_path + "/300/stat").c_str()) == 0);
+
+        auto snapshot = procfs.snapshot(pfs::task_fields::stat);
+        REQUIRE(snapshot.ids == std::vector<int>{100, 200});
+    }
+
+    SECTION("Corrupted fields aren't collected")
+    {
+        test_dir.create_file("200/stat", "200 (proc) S garbage\n");
+        test_dir.create_file("200/status", "Name:\tproc\nPid:\tgarbage\n");
+
+        auto snapshot = procfs.snapshot();
+        REQUIRE(snapshot.ids == std::vector<int>{100, 200});
+        REQUIRE(snapshot.collected[0] == pfs::task_fields::all);
+        REQUIRE(snapshot.collected[1] ==
+                (pfs::task_fields::all & ~(pfs::task_fields::stat |
+                                           pfs::task_fields::status)));
+        REQUIRE(snapshot.stat[0].pid == 100);
+        REQUIRE(snapshot.statm[1].resident == 5);
+    }
+}
+
+TEST_CASE("get_processes in parallel", "[procfs][filter]")
+{
+    auto even = [](const pfs::task& t) {
+        return t.id() % 2 == 0 ? pfs::filter::action::keep
+                               : pfs::filter::action::drop;
+    };
+
+    pfs::procfs procfs;
+    auto sequential = procfs.get_processes(even);
+    auto parallel   = procfs.get_processes(even, 4);
+
+    // Tasks might come and go between the calls, compare the stable ones
+    auto self = procfs.get_task();
+    REQUIRE((getpid() % 2 != 0 || parallel.count(self) == 1));
+    for (const auto& t : parallel)
+    {
+        REQUIRE(t.id() % 2 == 0);
+    }
+    REQUIRE(sequential.count(procfs.get_task(2)) ==
+            parallel.count(procfs.get_task(2)));
+}
+
+TEST_CASE("get_processes with stop", "[procfs][filter]")
+{
+    temp_dir test_dir{};
+    for (int pid = 1; pid <= 20; ++pid)
+    {
+        test_dir.create_file(std::to_string(pid) + "/stat", "");
+    }
+
+    pfs::procfs procfs(test_dir.get_root());
+    auto threads = GENERATE(1, 4);
+
+    std::set<int> expected;
+    auto action = pfs::filter::action::stop;
+
+    SECTION("Stop")
+    {
+        expected = {1, 3, 5, 7, 9};
+    }
+
+    SECTION("Keep and stop")
+    {
+        action   = pfs::filter::action::keep_and_stop;
+        expected = {1, 3, 5, 7, 9, 10};
+    }
+
+    auto filter = [action](const pfs::task& t) {
+        if (t.id() == 10)
+        {
+            return action;
+        }
+        return t.id() % 2 ? pfs::filter::action::keep
+                          : pfs::filter::action::drop;
+    };
+
+    std::set<int> ids;
+    for (const auto& t : procfs.get_processes(filter, threads))
+    {
+        ids.insert(t.id());
+    }
+    REQUIRE(ids == expected);
+}
+
+TEST_CASE("snapshot in parallel", "[procfs][snapshot]")
+{
+    temp_dir test_dir{};
+    for (int pid = 1; pid <= 50; ++pid)
+    {
+        test_dir.create_file(
+            std::to_string(pid) + "/stat",
+            std::to_string(pid) +
+                " (proc) S 1 1 1 0 -1 4194560 0 0 0 0 7 8 0 0 20 0 1 0 5000 "
+                "0 0 18446744073709551615 0 0 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 "
+                "0 0 0 0 0 0 0 0 0\n");
+    }
+
+    pfs::procfs procfs(test_dir.get_root());
+    auto sequential = procfs.snapshot(pfs::task_fields::stat);
+    auto parallel   = procfs.snapshot(pfs::task_fields::stat, 4);
+
+    REQUIRE(parallel.size() == 50);
+    REQUIRE(parallel.ids == sequential.ids);
+    REQUIRE(parallel.collected == sequential.collected);
+    for (size_t i = 0; i < parallel.size(); ++i)
+    {
+        REQUIRE(parallel.stat[i].pid == parallel.ids[i]);
+    }
+}
+
+TEST_CASE("snapshot of the live system", "[procfs][snapshot]")
+{
+    pfs::procfs procfs;
+    auto snapshot = procfs.snapshot();
+
+    auto it = std::find(snapshot.ids.begin(), snapshot.ids.end(), getpid());
+    REQUIRE(it != snapshot.ids.end());
+
+    auto index = static_cast<size_t>(it - snapshot.ids.begin());
+    REQUIRE(snapshot.stat[index].pid == getpid());
+    REQUIRE(snapshot.status[index].pid == getpid());
+    REQUIRE(snapshot.cmdline[index] == procfs.get_task().get_cmdline());
+    REQUIRE((snapshot.collected[index] & pfs::task_fields::stat));
+}
@@ -0,0 +1,241 @@
+#include <chrono>
+
+#include "catch.hpp"
+
+#include "pfs/rates.hpp"
+
+using namespace std::chrono;
+
+namespace {
+
+pfs::proc_stat::cpu make_cpu(unsigned long long user, unsigned long long system,
+                             unsigned long long idle)
+{
+    pfs::proc_stat::cpu cpu;
+    cpu.user   = user;
+    cpu.system = system;
+    cpu.idle   = idle;
+    return cpu;
+}
+
+void add_task(pfs::task_snapshot& snapshot, int id,
+              unsigned long long starttime, unsigned long long utime,
+              unsigned long long stime, unsigned long rchar)
+{
+    pfs::task_stat stat;
+    stat.starttime = starttime;
+    stat.utime     = utime;
+    stat.stime     = stime;
+
+    pfs::io_stats io{};
+    io.rchar = rchar;
+
+    snapshot.ids.push_back(id);
+    snapshot.collected.push_back(pfs::task_fields::stat | pfs::task_fields::io);
+    snapshot.stat.push_back(stat);
+    snapshot.io.push_back(io);
+}
+
+} // anonymous namespace
+
+TEST_CASE("Counter delta", "[rates]")
+{
+    REQUIRE(pfs::impl::counter_delta(10, 25) == 15);
+    REQUIRE(pfs::impl::counter_delta(25, 25) == 0);
+    REQUIRE(pfs::impl::counter_delta(25, 10) == 0);
+}
+
+TEST_CASE("Sample table", "[rates]")
+{
+    pfs::impl::sample_table<int, int> table;
+    std::vector<std::pair<int, int>> deltas;
+    auto collect = [&](int key, int previous, int current) {
+        deltas.emplace_back(key, current - previous);
+    };
+
+    table.begin();
+    table.add(3, 30);
+    table.add(1, 10);
+    table.add(2, 20);
+    table.commit(collect);
+    REQUIRE(deltas.empty());
+
+    table.begin();
+    table.add(4, 40);
+    table.add(2, 25);
+    table.add(1, 11);
+    table.commit(collect);
+
+    REQUIRE(deltas == std::vector<std::pair<int, int>>{{1, 1}, {2, 5}});
+}
+
+TEST_CASE("CPU rates", "[rates]")
+{
+    pfs::cpu_rate_tracker tracker;
+
+    pfs::proc_stat stat;
+    stat.cpus.total = make_cpu(100, 100, 800);
+    stat.cpus.per_item.push_back(make_cpu(50, 50, 400));
+    stat.cpus.per_item.push_back(make_cpu(50, 50, 400));
+    REQUIRE_FALSE(tracker.update(stat));
+
+    stat.cpus.total = make_cpu(175, 125, 900);
+    stat.cpus.per_item[0] = make_cpu(125, 75, 400);
+    stat.cpus.per_item[1] = make_cpu(50, 50, 500);
+    REQUIRE(tracker.update(stat));
+
+    REQUIRE(tracker.total().user == Approx(0.375));
+    REQUIRE(tracker.total().system == Approx(0.125));
+    REQUIRE(tracker.total().idle == Approx(0.5));
+    REQUIRE(tracker.total().busy() == Approx(0.5));
+
+    REQUIRE(tracker.per_cpu().size() == 2);
+    REQUIRE(tracker.per_cpu()[0].cpu == 0);
+    REQUIRE(tracker.per_cpu()[1].cpu == 1);
+    REQUIRE(tracker.per_cpu()[0].user == Approx(0.75));
+    REQUIRE(tracker.per_cpu()[0].busy() == Approx(1));
+    REQUIRE(tracker.per_cpu()[1].idle == Approx(1));
+
+    SECTION("No time passed")
+    {
+        REQUIRE(tracker.update(stat));
+        REQUIRE(tracker.total().busy() == Approx(0));
+        REQUIRE(tracker.total().idle == Approx(0));
+    }
+}
+
+TEST_CASE("CPU rates across hotplug", "[rates]")
+{
+    pfs::cpu_rate_tracker tracker;
+
+    pfs::proc_stat stat;
+    for (int id : {0, 1, 2})
+    {
+        stat.cpus.per_item.push_back(make_cpu(0, 0, 100));
+        stat.cpus.per_item.back().id = id;
+    }
+    stat.cpus.per_item[2].user = 50;
+    REQUIRE_FALSE(tracker.update(stat));
+
+    // Cpu 1 went offline, so cpu 2 moved up in /proc/stat
+    stat.cpus.per_item.erase(stat.cpus.per_item.begin() + 1);
+    stat.cpus.per_item[0] = make_cpu(0, 0, 200);
+    stat.cpus.per_item[1] = make_cpu(150, 0, 100);
+    stat.cpus.per_item[1].id = 2;
+    REQUIRE(tracker.update(stat));
+
+    REQUIRE(tracker.per_cpu().size() == 2);
+    REQUIRE(tracker.per_cpu()[0].cpu == 0);
+    REQUIRE(tracker.per_cpu()[0].idle == Approx(1));
+    REQUIRE(tracker.per_cpu()[1].cpu == 2);
+    REQUIRE(tracker.per_cpu()[1].user == Approx(1));
+}
+
+TEST_CASE("Task rates", "[rates]")
+{
+    pfs::task_rate_tracker tracker(100);
+    auto start = pfs::rate_clock::time_point();
+
+    pfs::task_snapshot first;
+    add_task(first, 10, 1000, 100, 50, 4096);
+    add_task(first, 20, 2000, 0, 0, 0);
+    add_task(first, 30, 3000, 0, 0, 0);
+    REQUIRE_FALSE(tracker.update(first, start));
+    REQUIRE(tracker.rates().empty());
+
+    pfs::task_snapshot second;
+    add_task(second, 10, 1000, 300, 100, 4096 + 8192);
+    add_task(second, 20, 2500, 500, 500, 0); // ID was reused
+    add_task(second, 40, 4000, 0, 0, 0);     // A new task
+    REQUIRE(tracker.update(second, start + seconds(2)));
+
+    REQUIRE(tracker.rates().size() == 1);
+    auto& rates = tracker.rates()[0];
+    REQUIRE(rates.pid == 10);
+    REQUIRE(rates.starttime == 1000);
+    REQUIRE(rates.user_cpu == Approx(1));
+    REQUIRE(rates.system_cpu == Approx(0.25));
+    REQUIRE(rates.cpu() == Approx(1.25));
+    REQUIRE(rates.has_io);
+    REQUIRE(rates.rchar == Approx(4096));
+
+    SECTION("Without io")
+    {
+        pfs::task_snapshot third;
+        add_task(third, 10, 1000, 400, 100, 0);
+        third.collected[0] = pfs::task_fields::stat;
+        REQUIRE(tracker.update(third, start + seconds(3)));
+
+        REQUIRE(tracker.rates().size() == 1);
+        REQUIRE(tracker.rates()[0].user_cpu == Approx(1));
+        REQUIRE_FALSE(tracker.rates()[0].has_io);
+        REQUIRE(tracker.rates()[0].rchar == 0);
+    }
+
+    SECTION("Task without stat")
+    {
+        // The stat column of a task without the stat bit isn't valid
+        pfs::task_snapshot third;
+        add_task(third, 10, 1000, 400, 100, 0);
+        add_task(third, 20, 2500, 600, 600, 0);
+        third.collected[1] = pfs::task_fields::io;
+        REQUIRE(tracker.update(third, start + seconds(3)));
+
+        REQUIRE(tracker.rates().size() == 1);
+        REQUIRE(tracker.rates()[0].pid == 10);
+    }
+
+    SECTION("Inconsistent columns")
+    {
+        pfs::task_snapshot third;
+        add_task(third, 10, 1000, 400, 100, 0);
+        third.collected.push_back(pfs::task_fields::stat);
+        REQUIRE_THROWS_AS(tracker.update(third), std::invalid_argument);
+    }
+
+    SECTION("Without stat")
+    {
+        pfs::task_snapshot third;
+        third.ids.push_back(10);
+        third.collected.push_back(pfs::task_fields::io);
+        REQUIRE_THROWS_AS(tracker.update(third), std::invalid_argument);
+    }
+}
+
+TEST_CASE("Block rates", "[rates]")
+{
+    pfs::block_rate_tracker tracker;
+    auto start = pfs::rate_clock::time_point();
+
+    pfs::block_stat before{};
+    before.read_ios      = 100;
+    before.read_sectors  = 1000;
+    before.read_ticks    = 500;
+    before.write_ios     = 50;
+    before.io_ticks      = 1000;
+    before.time_in_queue = 2000;
+
+    pfs::block_stat after = before;
+    after.read_ios      += 200;
+    after.read_sectors  += 4096;
+    after.read_ticks    += 400;
+    after.io_ticks      += 1500;
+    after.time_in_queue += 3000;
+
+    std::vector<std::pair<dev_t, pfs::block_stat>> stats{{8, before}};
+    REQUIRE_FALSE(tracker.update(stats, start));
+
+    stats[0].second = after;
+    REQUIRE(tracker.update(stats, start + seconds(2)));
+
+    REQUIRE(tracker.rates().size() == 1);
+    auto& rates = tracker.rates()[0];
+    REQUIRE(rates.dev == 8);
+    REQUIRE(rates.read_ios == Approx(100));
+    REQUIRE(rates.write_ios == 0);
+    REQUIRE(rates.read_bytes == Approx(4096 * 512 / 2));
+    REQUIRE(rates.read_await == Approx(2));
+    REQUIRE(rates.write_await == 0);
+    REQUIRE(rates.utilization == Approx(0.75));
+    REQUIRE(rates.queue_depth == Approx(1.5));
+}
@@ -4,6 +4,17 @@
 #include "pfs/parsers/smaps.hpp"
 
 using namespace pfs::impl::parsers;
+using pfs::vm_flag;
+
+static pfs::vm_flags_mask make_vm_flags(std::initializer_list<vm_flag> flags)
+{
+    pfs::vm_flags_mask mask;
+    for (auto flag : flags)
+    {
+        mask.set(flag);
+    }
+    return mask;
+}
 
 TEST_CASE("Parse smaps", "[task][smaps]")
 {
@@ -99,7 +110,11 @@ TEST_CASE("Parse smaps", "[task][smaps]")
         REQUIRE(smaps[0].swap_pss == 65);
         REQUIRE(smaps[0].locked == 70);
         REQUIRE(smaps[0].thp_eligible == true);
-        REQUIRE(smaps[0].vm_flags == std::vector<std::string>{"rd", "ex", "mr", "mw"});
+        REQUIRE(smaps[0].vm_flags == make_vm_flags({vm_flag::readable,
+                                                    vm_flag::executable,
+                                                    vm_flag::may_read,
+                                                    vm_flag::may_write}));
+        REQUIRE(smaps[0].unknown_vm_flags.empty());
 
         REQUIRE(smaps[1].region.start_address == 0xfdef41c40000);
         REQUIRE(smaps[1].region.end_address == 0xfdef41c64000);
@@ -129,6 +144,164 @@ TEST_CASE("Parse smaps", "[task][smaps]")
         REQUIRE(smaps[1].swap_pss == 70);
         REQUIRE(smaps[1].locked == 75);
         REQUIRE(smaps[1].thp_eligible == false);
-        REQUIRE(smaps[1].vm_flags == std::vector<std::string>{"rd", "ex", "mr", "mw", "me"});
+        REQUIRE(smaps[1].vm_flags == make_vm_flags({vm_flag::readable,
+                                                    vm_flag::executable,
+                                                    vm_flag::may_read,
+                                                    vm_flag::may_write,
+                                                    vm_flag::may_execute}));
+        REQUIRE(smaps[1].unknown_vm_flags.empty());
+    }
+}
+
+TEST_CASE("Aggregate smaps", "[task][smaps]")
+{
+    // clang-format off
+    std::vector<std::string> content = {
+        "00400000-00401000 r-xp 00000000 fc:00 1750349    /usr/bin/app",
+        "Size:                  4 kB",
+        "Rss:                   4 kB",
+        "Pss:                   2 kB",
+        "Swap:                  1 kB",
+        "THPeligible:           1",
+        "VmFlags: rd ex",
+        "00401000-00403000 rw-p 00001000 fc:00 1750349    /usr/bin/app",
+        "Size:                  8 kB",
+        "Rss:                   8 kB",
+        "VmFlags: rd wr",
+        "7f0000000000-7f0000004000 rw-p 00000000 00:00 0",
+        "Size:                 16 kB",
+        "Pss:                  10 kB",
+    };
+    // clang-format on
+
+    std::string file = create_temp_file(content);
+    pfs::impl::defer unlink_temp_file([&file] { unlink(file.c_str()); });
+
+    SECTION("Regions don't inherit values from the previous region")
+    {
+        auto smaps = parse_smaps(file);
+        REQUIRE(smaps.size() == 3);
+
+        REQUIRE(smaps[1].pss == 0);
+        REQUIRE(smaps[1].swap == 0);
+        REQUIRE(smaps[1].thp_eligible == false);
+        REQUIRE(smaps[1].vm_flags ==
+                make_vm_flags({vm_flag::readable, vm_flag::writable}));
+
+        REQUIRE(smaps[2].rss == 0);
+        REQUIRE(smaps[2].vm_flags.raw == 0);
+    }
+
+    SECTION("Visit every region")
+    {
+        std::vector<uint64_t> sizes;
+        for_each_smaps(file,
+                       [&sizes](const pfs::mem_map& map) { sizes.push_back(map.size); });
+        REQUIRE(sizes == std::vector<uint64_t>{4, 8, 16});
+    }
+
+    SECTION("Sum all regions")
+    {
+        auto total = sum_smaps(file);
+        REQUIRE(total.region.start_address == 0x00400000);
+        REQUIRE(total.region.end_address == 0x7f0000004000);
+        REQUIRE(total.size == 28);
+        REQUIRE(total.rss == 12);
+        REQUIRE(total.pss == 12);
+        REQUIRE(total.swap == 1);
+    }
+
+    SECTION("Sum regions by pathname")
+    {
+        auto totals = sum_smaps_by_pathname(file);
+        REQUIRE(totals.size() == 2);
+
+        auto& app = totals.at("/usr/bin/app");
+        REQUIRE(app.region.pathname == "/usr/bin/app");
+        REQUIRE(app.region.start_address == 0x00400000);
+        REQUIRE(app.region.end_address == 0x00403000);
+        REQUIRE(app.size == 12);
+        REQUIRE(app.rss == 12);
+
+        auto& anonymous = totals.at("");
+        REQUIRE(anonymous.size == 16);
+        REQUIRE(anonymous.pss == 10);
+    }
+}
+
+TEST_CASE("Parse smaps VmFlags", "[task][smaps]")
+{
+    // clang-format off
+    std::vector<std::string> content = {
+        "00400000-00401000 r-xp 00000000 fc:00 1750349    /usr/bin/app",
+        "VmFlags: rd ex mr mw me lo dd hg ui zz x abc ",
+    };
+    // clang-format on
+
+    std::string file = create_temp_file(content);
+    pfs::impl::defer unlink_temp_file([&file] { unlink(file.c_str()); });
+
+    auto smaps = parse_smaps(file);
+    REQUIRE(smaps.size() == 1);
+
+    auto& flags = smaps[0].vm_flags;
+    REQUIRE(flags.is_set(vm_flag::readable));
+    REQUIRE(flags.is_set(vm_flag::executable));
+    REQUIRE(flags.is_set(vm_flag::locked));
+    REQUIRE(flags.is_set(vm_flag::dont_dump));
+    REQUIRE(flags.is_set(vm_flag::huge_page));
+    REQUIRE(flags.is_set(vm_flag::uffd_minor));
+    REQUIRE_FALSE(flags.is_set(vm_flag::writable));
+    REQUIRE_FALSE(flags.is_set(vm_flag::no_huge_page));
+
+    REQUIRE(smaps[0].unknown_vm_flags ==
+            std::vector<std::string>{"zz", "x", "abc"});
+}
+
+TEST_CASE("Parse smaps rollup", "[task][smaps]")
+{
+    SECTION("Rollup")
+    {
+        // clang-format off
+        std::vector<std::string> content = {
+            "aaaad5e30000-ffffe7dff000 ---p 00000000 00:00 0                          [rollup]",
+            "Rss:                 12024 kB",
+            "Pss:                  4569 kB",
+            "Pss_Dirty:            3128 kB",
+            "Pss_Anon:             3112 kB",
+            "Pss_File:             1440 kB",
+            "Pss_Shmem:              16 kB",
+            "Shared_Clean:         8096 kB",
+            "Private_Dirty:        3128 kB",
+            "Swap:                    0 kB",
+            "Locked:                  0 kB",
+        };
+        // clang-format on
+
+        std::string file = create_temp_file(content);
+        pfs::impl::defer unlink_temp_file([&file] { unlink(file.c_str()); });
+
+        auto rollup = parse_smaps_rollup(file);
+        REQUIRE(rollup.region.start_address == 0xaaaad5e30000);
+        REQUIRE(rollup.region.end_address == 0xffffe7dff000);
+        REQUIRE(rollup.region.pathname == "[rollup]");
+        REQUIRE(rollup.rss == 12024);
+        REQUIRE(rollup.pss == 4569);
+        REQUIRE(rollup.pss_dirty == 3128);
+        REQUIRE(rollup.pss_anon == 3112);
+        REQUIRE(rollup.pss_file == 1440);
+        REQUIRE(rollup.pss_shmem == 16);
+        REQUIRE(rollup.shared_clean == 8096);
+        REQUIRE(rollup.private_dirty == 3128);
+    }
+
+    SECTION("Empty rollup")
+    {
+        std::string file = create_temp_file({});
+        pfs::impl::defer unlink_temp_file([&file] { unlink(file.c_str()); });
+
+        auto rollup = parse_smaps_rollup(file);
+        REQUIRE(rollup.region.end_address == 0);
+        REQUIRE(rollup.rss == 0);
     }
 }
@@ -0,0 +1,83 @@
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+#include "pfs/defer.hpp"
+#include "pfs/procfs.hpp"
+#include "pfs/socket_owner_index.hpp"
+
+TEST_CASE("Socket owner index update", "[procfs][socket_owners]")
+{
+    using owners = std::vector<pfs::socket_owner>;
+
+    pfs::socket_owner_index index;
+    REQUIRE(index.find(100).empty());
+
+    REQUIRE(index.update(1, {{4, 100}, {3, 200}}));
+    REQUIRE(index.update(2, {{5, 100}}));
+    REQUIRE(index.processes() == 2);
+    REQUIRE(index.sockets() == 2);
+    REQUIRE(index.find(100) == owners{{1, 4}, {2, 5}});
+    REQUIRE(index.find(200) == owners{{1, 3}});
+
+    SECTION("Unchanged")
+    {
+        REQUIRE_FALSE(index.update(1, {{3, 200}, {4, 100}}));
+    }
+
+    SECTION("Fds opened, closed and reused")
+    {
+        REQUIRE(index.update(1, {{3, 300}, {6, 100}}));
+        REQUIRE(index.find(100) == owners{{1, 6}, {2, 5}});
+        REQUIRE(index.find(200).empty());
+        REQUIRE(index.find(300) == owners{{1, 3}});
+        REQUIRE(index.sockets() == 2);
+    }
+
+    SECTION("Remove")
+    {
+        REQUIRE(index.remove(1));
+        REQUIRE_FALSE(index.remove(1));
+        REQUIRE(index.find(100) == owners{{2, 5}});
+        REQUIRE(index.find(200).empty());
+    }
+
+    SECTION("Retain")
+    {
+        REQUIRE_FALSE(index.retain({1, 2, 3}));
+        REQUIRE(index.retain({2}));
+        REQUIRE(index.processes() == 1);
+        REQUIRE(index.find(100) == owners{{2, 5}});
+    }
+}
+
+TEST_CASE("Socket owners of the current process", "[procfs][socket_owners]")
+{
+    int fds[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    pfs::impl::defer close_second([&fds] { close(fds[1]); });
+
+    auto inode_of = [](int fd) {
+        struct stat st;
+        REQUIRE(fstat(fd, &st) == 0);
+        return static_cast<ino64_t>(st.st_ino);
+    };
+    auto first  = inode_of(fds[0]);
+    auto second = inode_of(fds[1]);
+
+    pfs::procfs pfs;
+    auto index = pfs.get_socket_owners(GENERATE(1, 4));
+    using owners = std::vector<pfs::socket_owner>;
+    REQUIRE(index.find(first) == owners{{getpid(), fds[0]}});
+    REQUIRE(index.find(second) == owners{{getpid(), fds[1]}});
+
+    close(fds[0]);
+    REQUIRE(pfs.rescan_socket_owners(index, {getpid()}));
+    REQUIRE(index.find(first).empty());
+    REQUIRE(index.find(second).size() == 1);
+
+    REQUIRE_FALSE(pfs.rescan_socket_owners(index, {getpid()}));
+}
@@ -0,0 +1,83 @@
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "pfs/string_pool.hpp"
+
+TEST_CASE("Shared string", "[string_pool]")
+{
+    pfs::shared_string empty;
+    REQUIRE(empty.empty());
+    REQUIRE(empty == "");
+    REQUIRE(empty.str() == std::string());
+
+    pfs::shared_string str("/usr/lib/libc.so.6");
+    REQUIRE(str.size() == 18);
+    REQUIRE(str == "/usr/lib/libc.so.6");
+    REQUIRE(str == std::string("/usr/lib/libc.so.6"));
+    REQUIRE(str != "/usr/lib/libm.so.6");
+
+    auto copy = str;
+    REQUIRE(copy.shares_storage(str));
+
+    pfs::shared_string other(std::string("/usr/lib/libc.so.6"));
+    REQUIRE(other == str);
+    REQUIRE_FALSE(other.shares_storage(str));
+}
+
+TEST_CASE("String pool", "[string_pool]")
+{
+    pfs::string_pool pool;
+
+    SECTION("Equal strings share storage")
+    {
+        auto first  = pool.intern("/usr/lib/libc.so.6");
+        auto second = pool.intern(std::string("/usr/lib/libc.so.6"));
+        auto third  = pool.intern("/usr/lib/libm.so.6");
+
+        REQUIRE(first == "/usr/lib/libc.so.6");
+        REQUIRE(first.shares_storage(second));
+        REQUIRE_FALSE(first.shares_storage(third));
+        REQUIRE(pool.size() == 2);
+    }
+
+    SECTION("Empty strings aren't pooled")
+    {
+        auto empty = pool.intern("");
+        REQUIRE(empty.empty());
+        REQUIRE(pool.size() == 0);
+    }
+
+    SECTION("Strings outlive the pool")
+    {
+        auto str = pool.intern("[heap]");
+        pool.clear();
+        REQUIRE(pool.size() == 0);
+        REQUIRE(str == "[heap]");
+    }
+
+    SECTION("Concurrent interning")
+    {
+        static const size_t THREADS = 4;
+
+        std::vector<pfs::shared_string> results(THREADS);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < THREADS; ++i)
+        {
+            threads.emplace_back([&pool, &results, i] {
+                results[i] = pool.intern("/usr/lib/libc.so.6");
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        REQUIRE(pool.size() == 1);
+        for (const auto& result : results)
+        {
+            REQUIRE(result.shares_storage(results[0]));
+        }
+    }
+}
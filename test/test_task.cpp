@@ -0,0 +1,180 @@
+#include <signal.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <set>
+#include <system_error>
+
+#include "catch.hpp"
+#include "test_utils.hpp"
+
+#include "pfs/procfs.hpp"
+
+namespace {
+
+std::string build_stat(int pid, unsigned long long starttime)
+{
+    return std::to_string(pid) +
+           " (test) S 1 1 1 0 -1 4194560 0 0 0 0 0 0 0 0 20 0 1 0 " +
+           std::to_string(starttime) +
+           " 0 0 18446744073709551615 0 0 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 0 "
+           "0 0 0 0 0 0 0 0\n";
+}
+
+} // anonymous namespace
+
+TEST_CASE("Pinned task reads the same directory", "[task][pin]")
+{
+    temp_dir test_dir{};
+    const std::string root_path{test_dir.get_root()};
+
+    test_dir.create_file("1234/stat", build_stat(1234, 100));
+    test_dir.create_file("1234/comm", "original\n");
+    test_dir.create_file("1234/statm", "1 2 3 4 0 5 0\n");
+
+    static const std::string TCP_HEADER =
+        "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when "
+        "retrnsmt   uid  timeout inode\n";
+    static const std::string TCP_LINE =
+        "   0: 00000000:006F 00000000:0000 0A 00000000:00000000 00:00000000 "
+        "00000000     0        0 15734 1 ffff9f55b1421800 100 0 0 10 0\n";
+    test_dir.create_file("1234/net/tcp", TCP_HEADER + TCP_LINE);
+
+    test_dir.create_file("original_target", "");
+    test_dir.create_file("recycled_target", "");
+    auto target_inode = [&root_path](const std::string& name) {
+        struct stat st;
+        REQUIRE(stat((root_path + "/" + name).c_str(), &st) == 0);
+        return static_cast<ino64_t>(st.st_ino);
+    };
+    test_dir.create_file("1234/fd/.keep", "");
+    REQUIRE(symlink((root_path + "/original_target").c_str(),
+                    (root_path + "/1234/fd/3").c_str()) == 0);
+
+    auto unpinned = pfs::procfs(root_path).get_task(1234);
+    auto pinned   = unpinned.pin();
+    REQUIRE_FALSE(unpinned.is_pinned());
+    REQUIRE(pinned.is_pinned());
+    REQUIRE(pinned.id() == 1234);
+    REQUIRE(pinned.dir() == unpinned.dir());
+
+    REQUIRE(pinned.get_comm() == "original");
+    REQUIRE(pinned.get_statm().resident == 2);
+
+    // Simulate the task dying and its ID being recycled
+    const std::string task_dir = root_path + "/1234";
+    REQUIRE(rename(task_dir.c_str(), (task_dir + ".old").c_str()) == 0);
+    test_dir.create_file("1234/stat", build_stat(1234, 200));
+    test_dir.create_file("1234/comm", "recycled\n");
+
+    test_dir.create_file("1234/net/tcp", TCP_HEADER + TCP_LINE + TCP_LINE);
+    test_dir.create_file("1234/fd/.keep", "");
+    REQUIRE(symlink((root_path + "/recycled_target").c_str(),
+                    (root_path + "/1234/fd/3").c_str()) == 0);
+
+    REQUIRE(unpinned.get_comm() == "recycled");
+    REQUIRE(pinned.get_comm() == "original");
+
+    // Objects derived from the pinned task access the same directory
+    auto fds = pinned.get_fds();
+    REQUIRE(fds.size() == 1);
+    REQUIRE(fds.at(3).get_target() == root_path + "/original_target");
+    REQUIRE(fds.at(3).get_target_stat().st_ino ==
+            target_inode("original_target"));
+    REQUIRE(fds.at(3).link() == root_path + "/1234/fd/3");
+    REQUIRE(pinned.get_fds_inodes() ==
+            std::set<ino64_t>{target_inode("original_target")});
+    REQUIRE(unpinned.get_fds_inodes() ==
+            std::set<ino64_t>{target_inode("recycled_target")});
+    REQUIRE(pinned.get_net().get_tcp().size() == 1);
+    REQUIRE(unpinned.get_net().get_tcp().size() == 2);
+
+    // Copies share the same pinned directory
+    auto copy = pinned;
+    REQUIRE(copy.is_pinned());
+    REQUIRE(copy.get_comm() == "original");
+
+    // Pinning again doesn't go back through the recycled path
+    auto repinned = pinned.pin();
+    REQUIRE(repinned.is_pinned());
+    REQUIRE(repinned.get_comm() == "original");
+    REQUIRE(repinned.get_stat().starttime == 100);
+
+    REQUIRE(pinned.same_process(copy));
+    REQUIRE_FALSE(pinned.same_process(unpinned));
+    REQUIRE(pinned.is_alive());
+
+    // Simulate the original task being reaped
+    REQUIRE(std::system(("rm -rf " + task_dir + ".old").c_str()) == 0);
+    REQUIRE_FALSE(pinned.is_alive());
+    REQUIRE(unpinned.is_alive());
+}
+
+TEST_CASE("Pinning a missing task throws", "[task][pin]")
+{
+    temp_dir test_dir{};
+    test_dir.create_file("1/comm", "init\n");
+
+    auto task = pfs::procfs(test_dir.get_root()).get_task(4321);
+    REQUIRE_THROWS_AS(task.pin(), std::system_error);
+    REQUIRE_FALSE(task.is_alive());
+}
+
+TEST_CASE("Pinned process detects exit", "[task][pin]")
+{
+    pid_t child = fork();
+    REQUIRE(child >= 0);
+    if (child == 0)
+    {
+        pause();
+        _exit(0);
+    }
+    bool reaped = false;
+    pfs::impl::defer reap_child([child, &reaped] {
+        if (!reaped)
+        {
+            kill(child, SIGKILL);
+            waitpid(child, nullptr, 0);
+        }
+    });
+
+    pfs::procfs procfs;
+    auto pinned  = procfs.get_task(child).pin();
+    auto another = procfs.get_task(child).pin();
+    REQUIRE(pinned.is_alive());
+    REQUIRE(pinned.same_process(another));
+    REQUIRE(pinned.same_process(procfs.get_task(child)));
+    REQUIRE_FALSE(pinned.same_process(procfs.get_task()));
+
+    REQUIRE(kill(child, SIGKILL) == 0);
+    REQUIRE(waitpid(child, nullptr, 0) == child);
+    reaped = true;
+
+    REQUIRE_FALSE(pinned.is_alive());
+    REQUIRE_FALSE(pinned.same_process(procfs.get_task(child)));
+    REQUIRE_FALSE(pinned.same_process(another));
+    REQUIRE_FALSE(pinned.same_process(pinned));
+}
+
+TEST_CASE("Pinned task matches unpinned task", "[task][pin]")
+{
+    auto unpinned = pfs::procfs().get_task();
+    auto pinned   = unpinned.pin();
+
+    REQUIRE(pinned.get_stat().pid == getpid());
+    REQUIRE(pinned.get_stat().starttime == unpinned.get_stat().starttime);
+    REQUIRE(pinned.get_comm() == unpinned.get_comm());
+    REQUIRE(pinned.get_exe() == unpinned.get_exe());
+    REQUIRE(pinned.get_exe(false) == unpinned.get_exe(false));
+    REQUIRE(pinned.get_cmdline() == unpinned.get_cmdline());
+    REQUIRE(pinned.get_status().pid == getpid());
+    REQUIRE(pinned.get_maps().size() > 0);
+    REQUIRE(pinned.get_ns() == unpinned.get_ns());
+    REQUIRE(pinned.get_ns("net") == unpinned.get_ns("net"));
+    REQUIRE(pinned.get_fds().count(STDIN_FILENO) ==
+            unpinned.get_fds().count(STDIN_FILENO));
+    REQUIRE(pinned.count_fds() > 0);
+    REQUIRE(pinned.get_tasks().size() == unpinned.get_tasks().size());
+}
@@ -1,6 +1,8 @@
 #include "catch.hpp"
 #include "test_utils.hpp"
 
+#include "pfs/defer.hpp"
+#include "pfs/parser_error.hpp"
 #include "pfs/parsers/task_status.hpp"
 
 using namespace pfs::impl::parsers;
@@ -192,3 +194,34 @@ TEST_CASE("Parse status", "[task][status]")
         REQUIRE(status.nonvoluntary_ctxt_switches == 0);
     }
 }
+
+TEST_CASE("Parse status stops once the requested keys are found", "[task][status]")
+{
+    // The corrupted line is only reached if the parser reads past the
+    // requested keys
+    std::vector<std::string> content = {
+        "Name:   bash",
+        "Pid:    4481",
+        "VmRSS:      4488 kB",
+        "Threads:        corrupted",
+        "SigQ:   0/62793",
+    };
+
+    std::string file = create_temp_file(content);
+    pfs::impl::defer unlink_temp_file([&file] { unlink(file.c_str()); });
+
+    task_status_parser parser;
+
+    auto status = parser.parse(file, {"Pid", "VmRSS"});
+    REQUIRE(status.pid == 4481);
+    REQUIRE(status.vm_rss == 4488);
+    REQUIRE(status.name.empty());
+
+    REQUIRE_THROWS_AS(parser.parse(file, {"Pid", "Threads"}),
+                      pfs::parser_error);
+    REQUIRE_THROWS_AS(parser.parse(file), pfs::parser_error);
+
+    // Unknown keys are never found, and don't require reading the file
+    status = parser.parse(file, {"NoSuchKey"});
+    REQUIRE(status.pid == pfs::INVALID_PID);
+}
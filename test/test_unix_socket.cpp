@@ -113,3 +113,22 @@ TEST_CASE("Parse unix socket", "[net][unix_socket]")
     REQUIRE(socket.inode == expected.inode);
     REQUIRE(socket.path == expected.path);
 }
+
+TEST_CASE("Parse unix socket into an existing object", "[net][unix_socket]")
+{
+    pfs::unix_socket socket;
+
+    parse_unix_socket_line_into("ffff8db2f3d35c00: 00000003 00000000 00000000 "
+                                "0001 03 17525 /var/run/dbus/system_bus_socket",
+                                socket);
+    REQUIRE(socket.inode == 17525);
+    REQUIRE(socket.path == "/var/run/dbus/system_bus_socket");
+
+    // A socket without a path must not inherit the previous one
+    parse_unix_socket_line_into(
+        "ffff8db2fd23a400: 00000003 00000000 00000000 0002 01 16757", socket);
+    REQUIRE(socket.inode == 16757);
+    REQUIRE(socket.socket_type == pfs::unix_socket::type::datagram);
+    REQUIRE(socket.socket_state == pfs::unix_socket::state::unconnected);
+    REQUIRE(socket.path.empty());
+}
@@ -1,7 +1,10 @@
+#include <atomic>
+
 #include "test_utils.hpp"
 #include "catch.hpp"
 
 #include "pfs/defer.hpp"
+#include "pfs/parser_error.hpp"
 #include "pfs/utils.hpp"
 
 using namespace pfs::impl::utils;
@@ -215,6 +218,156 @@ TEST_CASE("Split", "[utils]")
     REQUIRE(split(input, delim, keep_empty) == tokens);
 }
 
+TEST_CASE("Tokenizer", "[utils]")
+{
+    std::string input;
+    std::vector<std::string> tokens;
+    char delim      = ' ';
+    bool keep_empty = false;
+
+    SECTION("Single word tokens")
+    {
+        input  = "raid456,async_raid6_recov,async_memcpy,async_pq,";
+        tokens = {"raid456", "async_raid6_recov", "async_memcpy", "async_pq"};
+        delim  = ',';
+    }
+
+    SECTION("Multiple delimiters")
+    {
+        input  = "  7f0b476b6000-7f0b476b7000    r--p  00000000 ";
+        tokens = {"7f0b476b6000-7f0b476b7000", "r--p", "00000000"};
+    }
+
+    SECTION("Keep empty")
+    {
+        input      = "::key:value:";
+        tokens     = {"", "", "key", "value"};
+        delim      = ':';
+        keep_empty = true;
+    }
+
+    SECTION("Empty buffer")
+    {
+        input  = "";
+        tokens = {};
+    }
+
+    std::vector<std::string> actual;
+    tokenizer tok(input, delim, keep_empty);
+    pfs::impl::string_view token;
+    while (tok.next(token))
+    {
+        // Tokens must point into the original buffer
+        REQUIRE(token.data() >= input.data());
+        REQUIRE(token.data() + token.size() <= input.data() + input.size());
+        actual.emplace_back(token);
+    }
+
+    REQUIRE(actual == tokens);
+    REQUIRE(actual == split(input, delim, keep_empty));
+}
+
+TEST_CASE("Split into fixed tokens", "[utils]")
+{
+    std::array<pfs::impl::string_view, 3> tokens;
+
+    SECTION("Exact count")
+    {
+        REQUIRE(split("a b c", tokens) == 3);
+        REQUIRE(tokens[0] == "a");
+        REQUIRE(tokens[1] == "b");
+        REQUIRE(tokens[2] == "c");
+    }
+
+    SECTION("Less tokens")
+    {
+        REQUIRE(split("a:b", tokens, ':') == 2);
+        REQUIRE(tokens[0] == "a");
+        REQUIRE(tokens[1] == "b");
+    }
+
+    SECTION("More tokens")
+    {
+        REQUIRE(split("a b c d e", tokens) == 5);
+        REQUIRE(tokens[0] == "a");
+        REQUIRE(tokens[1] == "b");
+        REQUIRE(tokens[2] == "c");
+    }
+}
+
+TEST_CASE("Split once into views", "[utils]")
+{
+    pfs::impl::string_view first;
+    pfs::impl::string_view second;
+
+    std::tie(first, second) =
+        split_once(pfs::impl::string_view("Groups: 4 24 27"), ':');
+    REQUIRE(first == "Groups");
+    REQUIRE(second == " 4 24 27");
+
+    std::tie(first, second) = split_once(pfs::impl::string_view("Groups"));
+    REQUIRE(first == "Groups");
+    REQUIRE(second.empty());
+}
+
+TEST_CASE("Trimming views", "[utils]")
+{
+    pfs::impl::string_view view("  \tword \t ");
+
+    SECTION("ltrim")
+    {
+        ltrim(view);
+        REQUIRE(view == "word \t ");
+    }
+
+    SECTION("rtrim")
+    {
+        rtrim(view);
+        REQUIRE(view == "  \tword");
+    }
+
+    SECTION("trim")
+    {
+        trim(view);
+        REQUIRE(view == "word");
+    }
+
+    SECTION("all spaces")
+    {
+        view = "    ";
+        trim(view);
+        REQUIRE(view.empty());
+    }
+}
+
+TEST_CASE("Convert views to numbers", "[utils]")
+{
+    std::string buffer = "1234 ffff -1 99999999999999999999";
+    std::array<pfs::impl::string_view, 4> tokens;
+    REQUIRE(split(buffer, tokens) == tokens.size());
+
+    unsigned decimal;
+    stot(tokens[0], decimal);
+    REQUIRE(decimal == 1234);
+
+    uint16_t hex;
+    stot(tokens[1], hex, base::hex);
+    REQUIRE(hex == 0xffff);
+
+    int negative;
+    stot(tokens[2], negative);
+    REQUIRE(negative == -1);
+
+    uint8_t narrow;
+    REQUIRE_THROWS_AS(stot(tokens[0], narrow), std::out_of_range);
+
+    uint64_t huge;
+    REQUIRE_THROWS_AS(stot(tokens[3], huge), std::out_of_range);
+
+    REQUIRE_THROWS_AS(stot(pfs::impl::string_view("xyz"), decimal),
+                      std::invalid_argument);
+}
+
 TEST_CASE("Readline", "[utils]")
 {
     std::vector<std::string> content;
@@ -294,3 +447,384 @@ TEST_CASE("Readfile", "[utils]")
     file = create_temp_file(content);
     REQUIRE(readfile(file, max, trim) == expected);
 }
+
+TEST_CASE("Readline long line", "[utils]")
+{
+    // Longer than a single read chunk
+    std::vector<std::string> content = {std::string(1000, 'x'), "second"};
+
+    std::string file = create_temp_file(content);
+    pfs::impl::defer unlink_temp_file([&file] { unlink(file.c_str()); });
+
+    REQUIRE(readline(file) == content[0]);
+}
+
+TEST_CASE("Readline empty file", "[utils]")
+{
+    std::string file = create_temp_file({});
+    pfs::impl::defer unlink_temp_file([&file] { unlink(file.c_str()); });
+
+    REQUIRE_THROWS_AS(readline(file), pfs::parser_error);
+    REQUIRE_THROWS_WITH(readline(file),
+                        Catch::StartsWith("Couldn't read line from file"));
+}
+
+TEST_CASE("Read buffer", "[utils]")
+{
+    temp_dir dir;
+    const std::string file = dir.get_root() + "/content";
+
+    read_buffer buffer;
+
+    SECTION("Empty file")
+    {
+        dir.create_file("content", "");
+        REQUIRE(buffer.read(file).empty());
+    }
+
+    SECTION("Grows to fit large files")
+    {
+        std::string content;
+        for (size_t i = 0; content.size() < 10 * read_buffer::INITIAL_SIZE; ++i)
+        {
+            content += "line " + std::to_string(i) + "\n";
+        }
+        dir.create_file("content", content);
+
+        REQUIRE(buffer.read(file) == content);
+        REQUIRE(buffer.capacity() >= content.size());
+
+        // Reading again reuses the storage
+        size_t capacity = buffer.capacity();
+        REQUIRE(buffer.read(file) == content);
+        REQUIRE(buffer.capacity() == capacity);
+    }
+
+    SECTION("Limited size")
+    {
+        dir.create_file("content", std::string(3 * read_buffer::INITIAL_SIZE, 'x'));
+        REQUIRE(buffer.read(file, AT_FDCWD, 5) == "xxxxx");
+
+        size_t limit = read_buffer::INITIAL_SIZE + 1;
+        REQUIRE(buffer.read(file, AT_FDCWD, limit).size() == limit);
+    }
+
+    SECTION("Missing file")
+    {
+        REQUIRE_THROWS_AS(buffer.read(file), std::system_error);
+    }
+}
+
+TEST_CASE("Read buffer lease", "[utils]")
+{
+    read_buffer* outer_buffer;
+    {
+        read_buffer_lease outer;
+        outer_buffer = &*outer;
+
+        // Nested leases must never share a buffer
+        read_buffer_lease inner;
+        REQUIRE(&*inner != outer_buffer);
+    }
+
+    // Released buffers are reused by the same thread
+    read_buffer_lease again;
+    read_buffer_lease another;
+    REQUIRE((&*again == outer_buffer || &*another == outer_buffer));
+}
+
+TEST_CASE("Line reader", "[utils]")
+{
+    temp_dir dir;
+    dir.create_file("lines", "first\n\nthird\nno-newline");
+
+    int dirfd = open(dir.get_root().c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+    REQUIRE(dirfd >= 0);
+    pfs::impl::defer close_dirfd([dirfd] { close(dirfd); });
+
+    std::vector<std::string> lines;
+
+    SECTION("Absolute path")
+    {
+        line_reader reader(dir.get_root() + "/lines");
+        std::string line;
+        while (reader.next(line))
+        {
+            lines.push_back(line);
+        }
+    }
+
+    SECTION("Relative to dirfd")
+    {
+        line_reader reader("lines", dirfd);
+        std::string line;
+        while (reader.next(line))
+        {
+            lines.push_back(line);
+        }
+    }
+
+    REQUIRE(lines == std::vector<std::string>{"first", "", "third", "no-newline"});
+    REQUIRE(readline("lines", dirfd) == "first");
+    REQUIRE_THROWS_AS(line_reader("missing", dirfd), std::system_error);
+}
+
+TEST_CASE("From chars", "[utils]")
+{
+    std::string input;
+    base b = base::decimal;
+    std::errc expected_ec{};
+    size_t expected_consumed = 0;
+    int64_t expected = 0;
+
+    SECTION("Decimal")
+    {
+        input             = "1234";
+        expected          = 1234;
+        expected_consumed = input.size();
+    }
+
+    SECTION("Negative")
+    {
+        input             = "-1234";
+        expected          = -1234;
+        expected_consumed = input.size();
+    }
+
+    SECTION("Minimum")
+    {
+        input             = "-9223372036854775808";
+        expected          = std::numeric_limits<int64_t>::min();
+        expected_consumed = input.size();
+    }
+
+    SECTION("Hex out of range with trailing chars")
+    {
+        input             = "ffff8db2fd23a400:";
+        b                 = base::hex;
+        expected_ec       = std::errc::result_out_of_range;
+        expected_consumed = input.size() - 1;
+    }
+
+    SECTION("Octal")
+    {
+        input             = "0755";
+        b                 = base::octal;
+        expected          = 0755;
+        expected_consumed = input.size();
+    }
+
+    SECTION("Stop at first invalid digit")
+    {
+        input             = "12a";
+        expected          = 12;
+        expected_consumed = 2;
+    }
+
+    SECTION("No digits")
+    {
+        input       = "x12";
+        expected_ec = std::errc::invalid_argument;
+    }
+
+    SECTION("Leading whitespace")
+    {
+        input       = " 12";
+        expected_ec = std::errc::invalid_argument;
+    }
+
+    SECTION("Out of range")
+    {
+        input             = "9223372036854775808";
+        expected_ec       = std::errc::result_out_of_range;
+        expected_consumed = input.size();
+    }
+
+    int64_t out = 0;
+    auto result = from_chars(input.data(), input.data() + input.size(), out, b);
+    REQUIRE(result.ec == expected_ec);
+    REQUIRE(static_cast<size_t>(result.ptr - input.data()) == expected_consumed);
+    if (expected_ec == std::errc())
+    {
+        REQUIRE(out == expected);
+    }
+    else
+    {
+        REQUIRE(out == 0);
+    }
+}
+
+TEST_CASE("From chars unsigned", "[utils]")
+{
+    std::string input = "ffff8db2fd23a400:";
+    uint64_t out;
+    auto result = from_chars(input.data(), input.data() + input.size(), out,
+                             base::hex);
+    REQUIRE(result.ec == std::errc());
+    REQUIRE(*result.ptr == ':');
+    REQUIRE(out == 0xffff8db2fd23a400);
+
+    input = "-1";
+    result = from_chars(input.data(), input.data() + input.size(), out);
+    REQUIRE(result.ec == std::errc::invalid_argument);
+
+    uint8_t narrow;
+    input = "256";
+    result = from_chars(input.data(), input.data() + input.size(), narrow);
+    REQUIRE(result.ec == std::errc::result_out_of_range);
+}
+
+TEST_CASE("Convert odd strings to numbers", "[utils]")
+{
+    // These are handled by the slow path and must keep std::sto* semantics
+    unsigned value;
+
+    stot(std::string("0x1"), value, base::hex);
+    REQUIRE(value == 1);
+
+    stot(std::string("  42"), value);
+    REQUIRE(value == 42);
+
+    stot(std::string("+42"), value);
+    REQUIRE(value == 42);
+
+    int negative;
+    stot(std::string("-0x10"), negative, base::hex);
+    REQUIRE(negative == -16);
+
+    REQUIRE_THROWS_AS(stot(std::string(""), value), std::invalid_argument);
+    REQUIRE_THROWS_AS(stot(std::string("-"), negative), std::invalid_argument);
+}
+
+TEST_CASE("Parse fixed width hex", "[utils]")
+{
+    uint32_t out = 0;
+
+    SECTION("Mixed case")
+    {
+        REQUIRE(parse_hex32("0100007F", out));
+        REQUIRE(out == 0x0100007F);
+
+        REQUIRE(parse_hex32("deadBEEF", out));
+        REQUIRE(out == 0xdeadbeef);
+    }
+
+    SECTION("Invalid chars")
+    {
+        REQUIRE_FALSE(parse_hex32("0100007G", out));
+        REQUIRE_FALSE(parse_hex32("0100:07F", out));
+        REQUIRE_FALSE(parse_hex32("0100 07F", out));
+        REQUIRE_FALSE(parse_hex32("\x80\x30\x30\x30\x30\x30\x30\x30", out));
+        REQUIRE(out == 0);
+    }
+
+    SECTION("Matches stot")
+    {
+        for (int i = 0; i < 1000; ++i)
+        {
+            char buffer[9];
+            snprintf(buffer, sizeof(buffer), "%08X", generate_random<uint32_t>());
+
+            uint32_t expected;
+            stot(std::string(buffer), expected, base::hex);
+
+            REQUIRE(parse_hex32(buffer, out));
+            REQUIRE(out == expected);
+        }
+    }
+}
+
+TEST_CASE("Parallel for", "[utils]")
+{
+    size_t threads = GENERATE(1, 2, 8);
+
+    SECTION("Visits every index once")
+    {
+        const size_t count = 1000;
+        std::vector<std::atomic<int>> visits(count);
+
+        parallel_for(count, threads, [&visits](size_t i) { ++visits[i]; });
+
+        for (const auto& v : visits)
+        {
+            REQUIRE(v == 1);
+        }
+    }
+
+    SECTION("Empty range")
+    {
+        bool called = false;
+        parallel_for(0, threads, [&called](size_t) { called = true; });
+        REQUIRE_FALSE(called);
+    }
+
+    SECTION("Rethrows exceptions")
+    {
+        REQUIRE_THROWS_WITH(parallel_for(100, threads,
+                                         [](size_t i) {
+                                             if (i == 42)
+                                             {
+                                                 throw std::runtime_error("42");
+                                             }
+                                         }),
+                            "42");
+    }
+}
+
+TEST_CASE("Enumerate files", "[utils]")
+{
+    temp_dir dir;
+    for (auto name : {"10", "2", "1", "007", "abc", "12a", "-3", ".5"})
+    {
+        dir.create_file(name, "");
+    }
+
+    REQUIRE(enumerate_numeric_files(dir.get_root()) ==
+            std::vector<int>{1, 2, 7, 10});
+
+    REQUIRE(count_files(dir.get_root()) == 7);
+    REQUIRE(count_files(dir.get_root(), true /* include_dots */) == 10);
+
+    std::set<std::string> names;
+    REQUIRE(iterate_files(dir.get_root(), false,
+                          [&names](const char* name) { names.insert(name); }) ==
+            7);
+    REQUIRE(names == enumerate_files(dir.get_root()));
+    REQUIRE(names.count("abc") == 1);
+
+    REQUIRE_THROWS_AS(count_files(dir.get_root() + "/missing"),
+                      std::system_error);
+}
+
+TEST_CASE("Enumerate a large directory", "[utils]")
+{
+    // More entries than fit in a single getdents64 call
+    const int count = 5000;
+
+    temp_dir dir;
+    for (int i = count - 1; i >= 0; --i)
+    {
+        dir.create_file(std::to_string(i), "");
+    }
+
+    std::vector<int> expected(count);
+    for (int i = 0; i < count; ++i)
+    {
+        expected[i] = i;
+    }
+    REQUIRE(enumerate_numeric_files(dir.get_root()) == expected);
+}
+
+TEST_CASE("Parse numeric file names", "[utils]")
+{
+    int num = -1;
+    REQUIRE(parse_numeric_file_name("1234", num));
+    REQUIRE(num == 1234);
+
+    REQUIRE_FALSE(parse_numeric_file_name("", num));
+    REQUIRE_FALSE(parse_numeric_file_name("self", num));
+    REQUIRE_FALSE(parse_numeric_file_name("12a", num));
+    REQUIRE_FALSE(parse_numeric_file_name("-1", num));
+    REQUIRE_FALSE(parse_numeric_file_name("99999999999", num));
+    REQUIRE(num == 1234);
+}
@@ -1,9 +1,11 @@
 #ifndef PFS_TEST_UTILS_HPP
 #define PFS_TEST_UTILS_HPP
 
+#include <errno.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 
 #include <linux/kdev_t.h>
@@ -94,13 +96,8 @@ public:
                      const std::string& content) const
     {
         const std::string file_path = _sandbox_root + '/' + relative_path;
-        const std::string dir       = file_path.substr(0, file_path.rfind("/"));
-        const int result =
-            std::system((std::string{"mkdir -p "} + dir).c_str());
-        if (result != 0)
-        {
-            throw std::runtime_error("Cannot create temp directory");
-        }
+        create_dirs(file_path.substr(0, file_path.rfind("/")));
+
         std::ofstream file(file_path);
         if (!file)
         {
@@ -111,6 +108,25 @@ public:
     }
 
 private:
+    // Like 'mkdir -p', without forking a shell for every file, which
+    // matters when building large fake trees
+    static void create_dirs(const std::string& dir)
+    {
+        for (size_t pos = dir.find('/', 1);; pos = dir.find('/', pos + 1))
+        {
+            std::string current = dir.substr(0, pos);
+            if (mkdir(current.c_str(), 0755) != 0 && errno != EEXIST)
+            {
+                throw std::runtime_error("Cannot create temp directory");
+            }
+
+            if (pos == std::string::npos)
+            {
+                break;
+            }
+        }
+    }
+
     void cleanup_temp_dir() noexcept
     {
         const int result =